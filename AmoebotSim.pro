@@ -1,4 +1,4 @@
-QT      += core gui qml quick
+QT      += core gui qml quick concurrent
 CONFIG  += c++11
 TARGET    = AmoebotSim
 TEMPLATE  = app
@@ -23,21 +23,38 @@ HEADERS += \
     alg/shortcutbridging.h \
     core/amoebotparticle.h \
     core/amoebotsystem.h \
+    core/configuration.h \
+    core/livestatepublisher.h \
     core/localparticle.h \
     core/metric.h \
+    core/metrichistory.h \
+    core/metricssummary.h \
+    core/metricswriter.h \
+    core/moverecorder.h \
     core/node.h \
     core/object.h \
+    core/occupancygrid.h \
+    core/shapeanalysis.h \
     core/particle.h \
+    core/performancegovernor.h \
+    core/replaysystem.h \
     core/simulator.h \
+    core/snapshotwriter.h \
     core/system.h \
+    helper/cowvector.h \
+    helper/parallelreduce.h \
     helper/randomnumbergenerator.h \
     main/application.h \
+    main/headlessapplication.h \
     script/scriptengine.h \
     script/scriptinterface.h \
     ui/algorithm.h \
+    ui/filmwriter.h \
     ui/glitem.h \
     ui/parameterlistmodel.h \
+    ui/rasterizer.h \
     ui/view.h \
+    ui/vispreferences.h \
     ui/visitem.h \
     alg/leaderelection.h
 
@@ -56,20 +73,33 @@ SOURCES += \
     alg/shortcutbridging.cpp \
     core/amoebotparticle.cpp \
     core/amoebotsystem.cpp \
+    core/configuration.cpp \
+    core/livestatepublisher.cpp \
     core/localparticle.cpp \
     core/metric.cpp \
+    core/metricssummary.cpp \
+    core/metricswriter.cpp \
+    core/moverecorder.cpp \
     core/object.cpp \
+    core/occupancygrid.cpp \
+    core/shapeanalysis.cpp \
     core/particle.cpp \
+    core/performancegovernor.cpp \
+    core/replaysystem.cpp \
     core/simulator.cpp \
+    core/snapshotwriter.cpp \
     core/system.cpp \
     helper/randomnumbergenerator.cpp \
     main/application.cpp \
+    main/headlessapplication.cpp \
     main/main.cpp\
     script/scriptengine.cpp \
     script/scriptinterface.cpp \
     ui/algorithm.cpp \
+    ui/filmwriter.cpp \
     ui/glitem.cpp \
     ui/parameterlistmodel.cpp \
+    ui/rasterizer.cpp \
     ui/view.cpp \
     ui/visitem.cpp \
     alg/leaderelection.cpp
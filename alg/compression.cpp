@@ -10,6 +10,9 @@
 
 #include <QtGlobal>
 
+#include "core/occupancygrid.h"
+#include "core/shapeanalysis.h"
+
 CompressionParticle::CompressionParticle(const Node head,
                                          const int globalTailDir,
                                          const int orientation,
@@ -21,6 +24,14 @@ CompressionParticle::CompressionParticle(const Node head,
     numNbrsBefore(0),
     flag(false) {}
 
+CompressionParticle::CompressionParticle(const CompressionParticle& other,
+                                         AmoebotSystem& system)
+  : AmoebotParticle(other, system),
+    lambda(other.lambda),
+    q(other.q),
+    numNbrsBefore(other.numNbrsBefore),
+    flag(other.flag) {}
+
 void CompressionParticle::activate() {
   if (isContracted()) {
     int expandDir = randDir();  // Select a random neighboring location.
@@ -82,6 +93,21 @@ QString CompressionParticle::inspectionText() const {
   return text;
 }
 
+bool CompressionParticle::serialize(QDataStream& out) const {
+  out << q << static_cast<qint32>(numNbrsBefore) << flag;
+  return true;
+}
+
+void CompressionParticle::deserialize(QDataStream& in) {
+  qint32 nbrs;
+  in >> q >> nbrs >> flag;
+  numNbrsBefore = nbrs;
+}
+
+AmoebotParticle* CompressionParticle::fork(AmoebotSystem& system) const {
+  return new CompressionParticle(*this, system);
+}
+
 CompressionParticle& CompressionParticle::nbrAtLabel(int label) const {
   return AmoebotParticle::nbrAtLabel<CompressionParticle>(label);
 }
@@ -256,8 +282,24 @@ CompressionSystem::CompressionSystem(int numParticles, double lambda) {
     }
   }
 
-  // Set up metrics.
-  _measures.push_back(new PerimeterMeasure("Perimeter", 1, *this));
+  setUpMeasures();
+}
+
+CompressionSystem::CompressionSystem(const Configuration& config,
+                                     double lambda) {
+  Q_ASSERT(lambda > 1);
+
+  insert(config, [&](const Node& head, int globalTailDir, size_t) {
+    return new CompressionParticle(head, globalTailDir, randDir(), *this,
+                                   lambda);
+  });
+
+  setUpMeasures();
+}
+
+CompressionSystem::CompressionSystem(const CompressionSystem& other)
+  : AmoebotSystem(other) {
+  setUpMeasures();
 }
 
 bool CompressionSystem::hasTerminated() const {
@@ -270,23 +312,41 @@ bool CompressionSystem::hasTerminated() const {
   return false;
 }
 
+std::shared_ptr<System> CompressionSystem::fork() {
+  syncMeasures();
+  std::shared_ptr<CompressionSystem> forked(new CompressionSystem(*this));
+  if (!forked->forkState(*this)) {
+    return nullptr;
+  }
+
+  return forked;
+}
+
+void CompressionSystem::setUpMeasures() {
+  _measures.push_back(new PerimeterMeasure("Perimeter", 1, *this));
+  _measures.push_back(new HoleMeasure("Holes", 1, *this));
+}
+
 PerimeterMeasure::PerimeterMeasure(const QString name, const unsigned int freq,
                                    CompressionSystem& system)
     : Measure(name, freq),
       _system(system) {}
 
 double PerimeterMeasure::calculate() const {
-  int numEdges = 0;
+  return capture()();
+}
+
+std::function<double()> PerimeterMeasure::capture() const {
+  std::vector<Node> tails;
+  tails.reserve(_system.particles.size());
   for (const auto& p : _system.particles) {
-    auto comp_p = dynamic_cast<CompressionParticle*>(p);
-    auto tailLabels = comp_p->isContracted() ? comp_p->uniqueLabels()
-                                             : comp_p->tailLabels();
-    for (const int label : tailLabels) {
-      if (comp_p->hasNbrAtLabel(label) && !comp_p->hasExpHeadAtLabel(label)) {
-        ++numEdges;
-      }
-    }
+    tails.push_back(p->isExpanded() ? p->tail() : p->head);
   }
 
-  return (3 * _system.size()) - (numEdges / 2) - 3;
+  return [tails]() {
+    const OccupancyGrid grid = OccupancyGrid::ofNodes(tails);
+    const quint64 numEdges = OccupancyGrid::edgeCount(grid, grid);
+
+    return (3.0 * tails.size()) - numEdges - 3;
+  };
 }
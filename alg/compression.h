@@ -36,6 +36,11 @@ class CompressionParticle : public AmoebotParticle {
   virtual QString inspectionText() const;
 
 protected:
+  // Checkpoint and fork hooks; see AmoebotParticle.
+  bool serialize(QDataStream& out) const override;
+  void deserialize(QDataStream& in) override;
+  AmoebotParticle* fork(AmoebotSystem& system) const override;
+
   // Particle memory.
   const double lambda;
   double q;
@@ -43,6 +48,9 @@ protected:
   bool flag;
 
 private:
+  // Constructs a copy of the given particle for a forked system.
+  CompressionParticle(const CompressionParticle& other, AmoebotSystem& system);
+
   // Gets a reference to the neighboring particle incident to the specified port
   // label. Crashes if no such particle exists at this label; consider using
   // hasNbrAtLabel() first if unsure.
@@ -73,8 +81,22 @@ class CompressionSystem : public AmoebotSystem {
   // yield compression; a bias below 2.17 will provably yield expansion.
   CompressionSystem(int numParticles = 100, double lambda = 4.0);
 
+  // Constructs a system of CompressionParticles at the positions of the given
+  // configuration (see core/configuration.h) with the given bias parameter.
+  CompressionSystem(const Configuration& config, double lambda);
+
   // Because this algorithm never terminates, this simply returns false.
   virtual bool hasTerminated() const;
+
+  // Returns an independent copy of this system; see System::fork.
+  std::shared_ptr<System> fork() override;
+
+ private:
+  // Fork constructor; see AmoebotSystem.
+  CompressionSystem(const CompressionSystem& other);
+
+  // Registers the measures of this algorithm.
+  void setUpMeasures();
 };
 
 class PerimeterMeasure : public Measure {
@@ -86,8 +108,12 @@ class PerimeterMeasure : public Measure {
 
   // Calculates the perimeter of the system, i.e., the number of edges on the
   // walk around the unique external boundary of the system. Uses the fact
-  // that perimeter = (3 * #particles) - (#nearest neighbor pairs) - 3.
+  // that perimeter = (3 * #particles) - (#nearest neighbor pairs) - 3, where
+  // the neighbor pairs are counted on a bit-packed occupancy grid. capture
+  // copies the particles' positions so the grid is built and counted off the
+  // simulation thread.
   double calculate() const final;
+  std::function<double()> capture() const final;
 
  protected:
   CompressionSystem& _system;
@@ -6,6 +6,9 @@
 
 #include <algorithm>  // for std::max
 #include <cmath>      // for std::sqrt, std::pow
+#include <vector>
+
+#include "helper/parallelreduce.h"
 
 MetricsDemoParticle::MetricsDemoParticle(const Node& head,
                                          const int globalTailDir,
@@ -136,16 +139,14 @@ PercentRedMeasure::PercentRedMeasure(const QString name,
       _system(system) {}
 
 double PercentRedMeasure::calculate() const {
-  int numRed = 0;
-
-  // Loop through all particles of the system.
-  for (const auto& p : _system.particles) {
-    // Convert the pointer to a MetricsDemoParticle so its color can be checked.
-    auto metr_p = dynamic_cast<MetricsDemoParticle*>(p);
-    if (metr_p->_state == MetricsDemoParticle::State::Red) {
-      numRed++;
-    }
-  }
+  // Count the particles of the system that are red, converting each pointer to
+  // a MetricsDemoParticle so its color can be checked.
+  const int numRed = reduceParticles(_system.particles, 0,
+    [](const AmoebotParticle* p) {
+      auto metr_p = dynamic_cast<const MetricsDemoParticle*>(p);
+      return (metr_p->_state == MetricsDemoParticle::State::Red) ? 1 : 0;
+    },
+    [](int a, int b) { return a + b; });
 
   return numRed / static_cast<double>(_system.size()) * 100;
 }
@@ -157,17 +158,32 @@ MaxDistanceMeasure::MaxDistanceMeasure(const QString name,
       _system(system) {}
 
 double MaxDistanceMeasure::calculate() const {
-  double maxDist = 0.0;
-  for (const auto& p1 : _system.particles) {
-    double x1 = p1->head.x + p1->head.y / 2.0;
-    double y1 = std::sqrt(3.0) / 2 * p1->head.y;
-    for (const auto& p2 : _system.particles) {
-      double x2 = p2->head.x + p2->head.y / 2.0;
-      double y2 = std::sqrt(3.0) / 2 * p2->head.y;
-      maxDist = std::max(std::sqrt(std::pow(x2 - x1, 2) + std::pow(y2 - y1, 2)),
-                         maxDist);
-    }
+  return capture()();
+}
+
+std::function<double()> MaxDistanceMeasure::capture() const {
+  std::vector<Node> heads;
+  heads.reserve(_system.particles.size());
+  for (const auto& p : _system.particles) {
+    heads.push_back(p->head);
   }
 
-  return maxDist;
+  return [heads]() {
+    // Each particle finds its farthest particle; the maximum over all of them
+    // is reduced in parallel.
+    return reduceParticles(heads, 0.0,
+      [&heads](const Node& h1) {
+        double x1 = h1.x + h1.y / 2.0;
+        double y1 = std::sqrt(3.0) / 2 * h1.y;
+        double maxDist = 0.0;
+        for (const auto& h2 : heads) {
+          double x2 = h2.x + h2.y / 2.0;
+          double y2 = std::sqrt(3.0) / 2 * h2.y;
+          maxDist = std::max(std::sqrt(std::pow(x2 - x1, 2) +
+                                       std::pow(y2 - y1, 2)), maxDist);
+        }
+        return maxDist;
+      },
+      [](double a, double b) { return std::max(a, b); }, 64);
+  };
 }
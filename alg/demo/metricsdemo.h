@@ -11,6 +11,8 @@
 #ifndef AMOEBOTSIM_ALG_DEMO_METRICSDEMO_H_
 #define AMOEBOTSIM_ALG_DEMO_METRICSDEMO_H_
 
+#include <functional>
+
 #include <QString>
 
 #include "core/amoebotparticle.h"
@@ -97,8 +99,10 @@ class MaxDistanceMeasure : public Measure {
                      MetricsDemoSystem& system);
 
   // Calculates the largest Cartesian distance between any pair of particles in
-  // the system.
+  // the system. capture copies the particles' positions so the quadratic
+  // comparison can be evaluated asynchronously.
   double calculate() const final;
+  std::function<double()> capture() const final;
 
  protected:
   MetricsDemoSystem& _system;
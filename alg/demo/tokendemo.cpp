@@ -84,6 +84,42 @@ TokenDemoParticle& TokenDemoParticle::nbrAtLabel(int label) const {
   return AmoebotParticle::nbrAtLabel<TokenDemoParticle>(label);
 }
 
+bool TokenDemoParticle::serialize(QDataStream&) const {
+  return true;
+}
+
+bool TokenDemoParticle::serializeToken(QDataStream& out,
+                                       const Token& token) const {
+  const DemoToken* demoToken = dynamic_cast<const DemoToken*>(&token);
+  if (demoToken == nullptr) {
+    return false;
+  }
+  const bool isRed = dynamic_cast<const RedToken*>(&token) != nullptr;
+  out << isRed << static_cast<qint32>(demoToken->_passedFrom)
+      << static_cast<qint32>(demoToken->_lifetime);
+  return true;
+}
+
+std::shared_ptr<AmoebotParticle::Token> TokenDemoParticle::deserializeToken(
+    QDataStream& in) {
+  bool isRed;
+  qint32 passedFrom, lifetime;
+  in >> isRed >> passedFrom >> lifetime;
+  if (in.status() != QDataStream::Ok) {
+    return nullptr;
+  }
+
+  std::shared_ptr<DemoToken> token;
+  if (isRed) {
+    token = std::make_shared<RedToken>();
+  } else {
+    token = std::make_shared<BlueToken>();
+  }
+  token->_passedFrom = passedFrom;
+  token->_lifetime = lifetime;
+  return token;
+}
+
 TokenDemoSystem::TokenDemoSystem(int numParticles, int lifetime) {
   Q_ASSERT(numParticles >= 6);
 
@@ -48,6 +48,13 @@ class TokenDemoParticle : public AmoebotParticle {
   struct RedToken : public DemoToken {};
   struct BlueToken : public DemoToken {};
 
+  // Checkpoint hooks; see AmoebotParticle. The particles have no memory other
+  // than their tokens, which are written as their color followed by their
+  // data members.
+  bool serialize(QDataStream& out) const override;
+  bool serializeToken(QDataStream& out, const Token& token) const override;
+  std::shared_ptr<Token> deserializeToken(QDataStream& in) override;
+
  private:
   friend class TokenDemoSystem;
 };
@@ -420,13 +420,39 @@ EnergyShapeSystem::EnergyShapeSystem(const int numParticles,
     }
   }
 
-  // Choose particles at random to make energy ditribution roots.
   // BUG: If holeProb is large (e.g., > 0.7), then not all n particles will be
-  // instantiated in the system. That will cause the particles[large index] call
-  // to seg-fault and AmoebotSim to crash. This is an issue with all system
-  // constructors that use the random tree algorithm.
+  // instantiated in the system, and there may be fewer particles than energy
+  // distribution roots. That will cause chooseEnergyRoots to seg-fault and
+  // AmoebotSim to crash. This is an issue with all system constructors that
+  // use the random tree algorithm.
+  chooseEnergyRoots(numEnergyRoots);
+}
+
+EnergyShapeSystem::EnergyShapeSystem(const Configuration& config,
+                                     const int numEnergyRoots,
+                                     const double capacity,
+                                     const double demand,
+                                     const double transferRate) {
+  Q_ASSERT(0 < numEnergyRoots
+           && numEnergyRoots <= static_cast<int>(config.particles.size()));
+
+  _counts.push_back(new Count("# Actions"));
+
+  insert(config, [&](const Node& head, int globalTailDir, size_t index) {
+    return new EnergyShapeParticle(
+        head, globalTailDir, randDir(), *this, capacity, demand, transferRate,
+        EnergyShapeParticle::EnergyState::Idle,
+        (index == 0) ? EnergyShapeParticle::ShapeState::Seed
+                     : EnergyShapeParticle::ShapeState::Idle);
+  });
+
+  chooseEnergyRoots(numEnergyRoots);
+}
+
+void EnergyShapeSystem::chooseEnergyRoots(const int numEnergyRoots) {
+  // Choose particles at random to make energy ditribution roots.
   std::vector<int> indices;
-  for (int i = 0; i < numParticles; ++i) {
+  for (size_t i = 0; i < particles.size(); ++i) {
     indices.push_back(i);
   }
   shuffle(indices.begin(), indices.end());
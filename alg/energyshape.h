@@ -145,9 +145,22 @@ class EnergyShapeSystem : public AmoebotSystem {
                     const double holeProb, const double capacity,
                     const double demand, const double transferRate);
 
+  // Constructs a system of EnergyShapeParticles at the positions of the given
+  // configuration (see core/configuration.h), which must contain at least
+  // numEnergyRoots particles, with the remaining parameters as above. The
+  // first particle of the configuration is the shape formation seed.
+  EnergyShapeSystem(const Configuration& config, const int numEnergyRoots,
+                    const double capacity, const double demand,
+                    const double transferRate);
+
   // Checks whether the system has completed forming the desired shape (i.e.,
   // all particles are in shape state Finish).
   bool hasTerminated() const override;
+
+ private:
+  // Makes the given number of randomly chosen particles energy distribution
+  // roots.
+  void chooseEnergyRoots(const int numEnergyRoots);
 };
 
 #endif  // ALG_ENERGYSHAPE_H_
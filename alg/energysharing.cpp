@@ -252,9 +252,34 @@ EnergySharingSystem::EnergySharingSystem(int numParticles,
                                      EnergySharingParticle::State::Idle));
   }
 
+  chooseEnergyRoots(numEnergyRoots);
+}
+
+EnergySharingSystem::EnergySharingSystem(const Configuration& config,
+                                         const int numEnergyRoots,
+                                         const int usage,
+                                         const double capacity,
+                                         const double demand,
+                                         const double transferRate) {
+  Q_ASSERT(0 < numEnergyRoots
+           && numEnergyRoots <= static_cast<int>(config.particles.size()));
+
+  _counts.push_back(new Count("# Actions"));
+
+  insert(config, [&](const Node& head, int globalTailDir, size_t) {
+    return new EnergySharingParticle(
+        head, globalTailDir, randDir(), *this, capacity, demand, transferRate,
+        static_cast<EnergySharingParticle::Usage>(usage),
+        EnergySharingParticle::State::Idle);
+  });
+
+  chooseEnergyRoots(numEnergyRoots);
+}
+
+void EnergySharingSystem::chooseEnergyRoots(const int numEnergyRoots) {
   // Choose particles at random to make energy ditribution roots.
   std::vector<int> indices;
-  for (int i = 0; i < numParticles; ++i) {
+  for (size_t i = 0; i < particles.size(); ++i) {
     indices.push_back(i);
   }
   shuffle(indices.begin(), indices.end());
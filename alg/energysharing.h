@@ -99,6 +99,17 @@ class EnergySharingSystem : public AmoebotSystem {
   EnergySharingSystem(int numParticles, const int numEnergyRoots,
                       const int usage, const double capacity,
                       const double demand, const double transferRate);
+
+  // Constructs a system of EnergySharingParticles at the positions of the
+  // given configuration (see core/configuration.h), which must contain at
+  // least numEnergyRoots particles, with the remaining parameters as above.
+  EnergySharingSystem(const Configuration& config, const int numEnergyRoots,
+                      const int usage, const double capacity,
+                      const double demand, const double transferRate);
+
+ private:
+  // Makes the given number of randomly chosen particles energy roots.
+  void chooseEnergyRoots(const int numEnergyRoots);
 };
 
 #endif  // ALG_ENERGYSHARING_H_
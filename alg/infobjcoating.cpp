@@ -252,6 +252,13 @@ InfObjCoatingSystem::InfObjCoatingSystem(uint numParticles, double holeProb) {
   }
 }
 
+InfObjCoatingSystem::InfObjCoatingSystem(const Configuration& config) {
+  insert(config, [&](const Node& head, int globalTailDir, size_t) {
+    return new InfObjCoatingParticle(head, globalTailDir, randDir(), *this,
+                                     InfObjCoatingParticle::State::Inactive);
+  });
+}
+
 bool InfObjCoatingSystem::hasTerminated() const {
   // Algorithm is terminated if all particles are on the surface (leaders) and
   // have contracted.
@@ -92,6 +92,11 @@ class InfObjCoatingSystem : public AmoebotSystem {
   // expanded.
   InfObjCoatingSystem(uint numParticles = 100, double holeProb = 0.2);
 
+  // Constructs a system of InfObjCoatingParticles and objects at the positions
+  // of the given configuration (see core/configuration.h). The objects should
+  // form a surface the particles are connected to.
+  explicit InfObjCoatingSystem(const Configuration& config);
+
   // Checks whether or not the system has completed infinite object coating (all
   // particles contracted and on the object.
   bool hasTerminated() const override;
@@ -228,7 +228,7 @@ LeaderElectionParticle::LeaderElectionAgent::LeaderElectionAgent() :
   candidateParticle(nullptr) {}
 
 void LeaderElectionParticle::LeaderElectionAgent::activate() {
-  passTokensDir = randInt(0, 2);
+  passTokensDir = candidateParticle->randInt(0, 2);
   if (agentState == State::Candidate) {
     // Segment Comparison
     if (hasAgentToken<ActiveSegmentCleanToken>(nextAgentDir)) {
@@ -379,7 +379,7 @@ void LeaderElectionParticle::LeaderElectionAgent::activate() {
         waitingForTransferAck = false;
         gotAnnounceBeforeAck = false;
         return;
-      } else if (!waitingForTransferAck && passTokensDir == 0 && randBool()) {
+      } else if (!waitingForTransferAck && passTokensDir == 0 && candidateParticle->randBool()) {
         passAgentToken<CandidacyAnnounceToken>
             (nextAgentDir, std::make_shared<CandidacyAnnounceToken>());
         paintFrontSegment(0xffa500);
@@ -1074,6 +1074,13 @@ LeaderElectionSystem::LeaderElectionSystem(int numParticles, double holeProb) {
   }
 }
 
+LeaderElectionSystem::LeaderElectionSystem(const Configuration& config) {
+  insert(config, [&](const Node& head, int globalTailDir, size_t) {
+    return new LeaderElectionParticle(head, globalTailDir, randDir(), *this,
+                                      LeaderElectionParticle::State::Idle);
+  });
+}
+
 bool LeaderElectionSystem::hasTerminated() const {
   #ifdef QT_DEBUG
     if (!isConnected(particles)) {
@@ -382,6 +382,10 @@ class LeaderElectionSystem : public AmoebotSystem {
   // more expanded.
   LeaderElectionSystem(int numParticles = 100, double holeProb = 0.2);
 
+  // Constructs a system of LeaderElectionParticles at the positions of the
+  // given configuration (see core/configuration.h).
+  explicit LeaderElectionSystem(const Configuration& config);
+
   // Checks whether or not the system's run of the Leader Election algorithm has
   // terminated (all particles in state Finished or Leader).
   bool hasTerminated() const override;
@@ -1 +1,59 @@
 #include "optimalshortcut.h"
+
+#include "alg/shortcutbridging.h"
+
+OptimalShortcutPerimeterMeasure::OptimalShortcutPerimeterMeasure(const QString name, const unsigned int freq, OptimalShortcut& system)
+    : Measure(name, freq)
+    , _system(system)
+{
+}
+
+double OptimalShortcutPerimeterMeasure::calculate() const
+{
+    return capture()();
+}
+
+std::function<double()> OptimalShortcutPerimeterMeasure::capture() const
+{
+    return ShortcutPerimeterMeasure::capturePerimeter(_system.particles);
+}
+
+OptimalShortcutGapPerimeterMeasure::OptimalShortcutGapPerimeterMeasure(const QString name, const unsigned int freq, OptimalShortcut& system)
+    : Measure(name, freq)
+    , _system(system)
+{
+}
+
+double OptimalShortcutGapPerimeterMeasure::calculate() const
+{
+    return capture()();
+}
+
+std::function<double()> OptimalShortcutGapPerimeterMeasure::capture() const
+{
+    return ShortcutGapPerimeterMeasure::captureGapPerimeter(_system.particles,
+        _system.objectOccupancy(), _system.c);
+}
+
+OptimalWeightedPerimeterMeasure::OptimalWeightedPerimeterMeasure(const QString name, const unsigned int freq, OptimalShortcut& system)
+    : Measure(name, freq)
+    , _system(system)
+{
+}
+
+double OptimalWeightedPerimeterMeasure::calculate() const
+{
+    return capture()();
+}
+
+std::function<double()> OptimalWeightedPerimeterMeasure::capture() const
+{
+    const std::function<double()> perimeter = ShortcutPerimeterMeasure::capturePerimeter(_system.particles);
+    const std::function<double()> gapPerimeter = ShortcutGapPerimeterMeasure::captureGapPerimeter(_system.particles,
+        _system.objectOccupancy(), _system.c);
+    const double c = _system.c;
+
+    return [perimeter, gapPerimeter, c]() {
+        return perimeter() + (c - 1) * gapPerimeter();
+    };
+}
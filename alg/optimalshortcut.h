@@ -1,7 +1,9 @@
 #ifndef OPTIMALSHORTCUT_H
 #define OPTIMALSHORTCUT_H
 
-#include <Qstring>
+#include <functional>
+
+#include <QString>
 
 #include "core/amoebotparticle.h"
 #include "core/amoebotsystem.h"
@@ -42,8 +44,10 @@ public:
 
     // Calculates the perimeter of the system, i.e., the number of edges on the
     // walk around the unique external boundary of the system. Uses the fact
-    // that perimeter = (3 * #particles) - (#nearest neighbor pairs) - 3.
+    // that perimeter = (3 * #particles) - (#nearest neighbor pairs) - 3. As for
+    // ShortcutPerimeterMeasure, capture only copies the particles' positions.
     double calculate() const final;
+    std::function<double()> capture() const final;
 
 protected:
     OptimalShortcut& _system;
@@ -57,6 +61,7 @@ public:
         OptimalShortcut& system);
 
     double calculate() const final;
+    std::function<double()> capture() const final;
 
 protected:
     OptimalShortcut& _system;
@@ -67,7 +72,10 @@ public:
     OptimalWeightedPerimeterMeasure(const QString name, const unsigned int freq,
         OptimalShortcut& system);
 
+    // Combines the perimeter and the gap perimeter, computing both off the
+    // simulation thread when captured.
     double calculate() const final;
+    std::function<double()> capture() const final;
 
 protected:
     OptimalShortcut& _system;
@@ -1,5 +1,7 @@
 #include "separation.h"
 
+#include "core/occupancygrid.h"
+
 SeparationParticle::SeparationParticle(const Node head, const int globalTailDir, const int orientation, AmoebotSystem& system, const double lambda, const double kappa, Team team)
     : AmoebotParticle(head, globalTailDir, orientation, system)
     , lambda(lambda)
@@ -41,6 +43,13 @@ void SeparationParticle::activate()
             int QnumNrbOther = neighbour->nbrCountTeam(uniqueLabels(), team) - 1;
 
             if (q < pow(kappa, QnumNrbOther - PnumNbr + PnumNrbOther - QnumNrb)) {
+                // This particle's edges to its team become edges to the other
+                // team and vice versa; the same holds for the neighbor, while
+                // the edge between the two stays heterogeneous.
+                static_cast<SeparationSystem&>(system).recordEdgeChanges(team,
+                    QnumNrbOther - PnumNbr, PnumNrbOther - QnumNrb,
+                    PnumNbr - PnumNrbOther + QnumNrb - QnumNrbOther);
+
                 neighbour->team = team;
                 team = otherTeam;
             }
@@ -63,6 +72,11 @@ void SeparationParticle::activate()
             // otherwise, contract back to the original one.
             if ((q < pow(lambda, numNbrsAfter - numNbrsBefore) * pow(kappa, numNbrsTeamAfter - numNbrsTeamBefore))
                 && (checkProp1(S) || checkProp2(S))) {
+                // This particle's position moves from its tail to its head.
+                const Team otherTeam = (team == Red) ? Blue : Red;
+                static_cast<SeparationSystem&>(system).recordEdgeChanges(team,
+                    numNbrsTeamAfter - nbrCountTeam(tailLabels(), team), 0,
+                    nbrCountTeam(headLabels(), otherTeam) - nbrCountTeam(tailLabels(), otherTeam));
                 contractTail();
             } else {
                 contractHead();
@@ -114,6 +128,24 @@ int SeparationParticle::tailMarkColor() const
     return headMarkColor();
 }
 
+bool SeparationParticle::serialize(QDataStream& out) const
+{
+    out << static_cast<qint32>(team) << q << static_cast<qint32>(numNbrsBefore)
+        << static_cast<qint32>(numNbrsTeamBefore) << flag
+        << static_cast<qint32>(nodeBefore.x) << static_cast<qint32>(nodeBefore.y);
+    return true;
+}
+
+void SeparationParticle::deserialize(QDataStream& in)
+{
+    qint32 restoredTeam, nbrs, nbrsTeam, x, y;
+    in >> restoredTeam >> q >> nbrs >> nbrsTeam >> flag >> x >> y;
+    team = (restoredTeam == Blue) ? Blue : Red;
+    numNbrsBefore = nbrs;
+    numNbrsTeamBefore = nbrsTeam;
+    nodeBefore = Node(x, y);
+}
+
 SeparationParticle& SeparationParticle::nbrAtLabel(int label) const
 {
     return AmoebotParticle::nbrAtLabel<SeparationParticle>(label);
@@ -298,9 +330,113 @@ SeparationSystem::SeparationSystem(int numParticles, double lambda, double kappa
             }
         }
     }
+
+    setUp();
+}
+
+SeparationSystem::SeparationSystem(const Configuration& config, double lambda,
+    double kappa)
+{
+    insert(config, [&](const Node& head, int globalTailDir, size_t) {
+        return new SeparationParticle(head, globalTailDir, randDir(), *this,
+            lambda, kappa, static_cast<Team>(rand() % 2));
+    });
+
+    setUp();
+}
+
+void SeparationSystem::setUp()
+{
+    // Count the initial edges on bit-packed occupancy grids of the teams; from
+    // here on, the particles keep the counts up to date.
+    const OccupancyGrid redGrid = OccupancyGrid::ofTails(particles,
+        [](const AmoebotParticle* p) {
+            return static_cast<const SeparationParticle*>(p)->team == Red;
+        });
+    const OccupancyGrid blueGrid = OccupancyGrid::ofTails(particles,
+        [](const AmoebotParticle* p) {
+            return static_cast<const SeparationParticle*>(p)->team == Blue;
+        });
+    homogeneousEdges[Red] = OccupancyGrid::edgeCount(redGrid, redGrid);
+    homogeneousEdges[Blue] = OccupancyGrid::edgeCount(blueGrid, blueGrid);
+    heterogeneousEdges = OccupancyGrid::edgeCount(redGrid, blueGrid)
+        + OccupancyGrid::edgeCount(blueGrid, redGrid);
+
+    // Set up metrics.
+    _measures.push_back(new HomogeneousEdgeMeasure("Red Edges", 1, *this, Red));
+    _measures.push_back(new HomogeneousEdgeMeasure("Blue Edges", 1, *this, Blue));
+    _measures.push_back(new HeterogeneousEdgeMeasure("Red-Blue Edges", 1, *this));
+    _measures.push_back(new SeparationPerimeterMeasure("Perimeter", 1, *this));
 }
 
 bool SeparationSystem::hasTerminated() const
 {
     return false;
 }
+
+void SeparationSystem::serialize(QDataStream& out) const
+{
+    out << static_cast<qint32>(homogeneousEdges[Red])
+        << static_cast<qint32>(homogeneousEdges[Blue])
+        << static_cast<qint32>(heterogeneousEdges);
+}
+
+void SeparationSystem::deserialize(QDataStream& in)
+{
+    qint32 red, blue, heterogeneous;
+    in >> red >> blue >> heterogeneous;
+    homogeneousEdges[Red] = red;
+    homogeneousEdges[Blue] = blue;
+    heterogeneousEdges = heterogeneous;
+}
+
+void SeparationSystem::recordEdgeChanges(Team team, int teamDelta,
+    int otherDelta, int heterogeneousDelta)
+{
+    homogeneousEdges[team] += teamDelta;
+    homogeneousEdges[(team == Red) ? Blue : Red] += otherDelta;
+    heterogeneousEdges += heterogeneousDelta;
+
+    Q_ASSERT(homogeneousEdges[Red] >= 0 && homogeneousEdges[Blue] >= 0
+        && heterogeneousEdges >= 0);
+}
+
+HomogeneousEdgeMeasure::HomogeneousEdgeMeasure(const QString name,
+    const unsigned int freq, SeparationSystem& system, Team team)
+    : Measure(name, freq)
+    , _system(system)
+    , _team(team)
+{
+}
+
+double HomogeneousEdgeMeasure::calculate() const
+{
+    return _system.homogeneousEdges[_team];
+}
+
+HeterogeneousEdgeMeasure::HeterogeneousEdgeMeasure(const QString name,
+    const unsigned int freq, SeparationSystem& system)
+    : Measure(name, freq)
+    , _system(system)
+{
+}
+
+double HeterogeneousEdgeMeasure::calculate() const
+{
+    return _system.heterogeneousEdges;
+}
+
+SeparationPerimeterMeasure::SeparationPerimeterMeasure(const QString name,
+    const unsigned int freq, SeparationSystem& system)
+    : Measure(name, freq)
+    , _system(system)
+{
+}
+
+double SeparationPerimeterMeasure::calculate() const
+{
+    const int numEdges = _system.homogeneousEdges[Red]
+        + _system.homogeneousEdges[Blue] + _system.heterogeneousEdges;
+
+    return (3.0 * _system.size()) - numEdges - 3;
+}
@@ -13,6 +13,9 @@ enum Team {
 
 class SeparationParticle : public AmoebotParticle {
     friend class SeparationSystem;
+    friend class HomogeneousEdgeMeasure;
+    friend class HeterogeneousEdgeMeasure;
+    friend class SeparationPerimeterMeasure;
 
 public:
     // Constructs a new particle with a node position for its head, a global
@@ -33,6 +36,10 @@ public:
     int tailMarkColor() const override;
 
 protected:
+    // Checkpoint hooks; see AmoebotParticle.
+    bool serialize(QDataStream& out) const override;
+    void deserialize(QDataStream& in) override;
+
     // Particle memory.
     const double lambda;
     const double kappa;
@@ -68,12 +75,90 @@ private:
 };
 
 class SeparationSystem : public AmoebotSystem {
+    friend class SeparationParticle;
+    friend class HomogeneousEdgeMeasure;
+    friend class HeterogeneousEdgeMeasure;
+    friend class SeparationPerimeterMeasure;
 
 public:
     SeparationSystem(int numParticles = 100, double lambda = 4.0, double kappa = 4.0);
 
+    // Constructs a system of SeparationParticles at the positions of the given
+    // configuration (see core/configuration.h), each in a random team.
+    SeparationSystem(const Configuration& config, double lambda, double kappa);
+
     // Because this algorithm never terminates, this simply returns false.
     virtual bool hasTerminated() const;
+
+protected:
+    // Checkpoint hooks for the edge counts; see AmoebotSystem.
+    void serialize(QDataStream& out) const override;
+    void deserialize(QDataStream& in) override;
+
+private:
+    // Counts the initial edges between the teams and registers the measures;
+    // called by the constructors once all particles are inserted.
+    void setUp();
+
+    // Adds the given changes to the numbers of edges between particles of the
+    // given team, between particles of the other team, and between particles
+    // of different teams. Edges are counted between the positions of particles,
+    // i.e., their tails if they are expanded and their heads otherwise.
+    // Particles report these changes whenever they contract to their heads or
+    // swap teams, so the measures below never have to inspect all particles.
+    void recordEdgeChanges(Team team, int teamDelta, int otherDelta,
+        int heterogeneousDelta);
+
+    int homogeneousEdges[2];
+    int heterogeneousEdges;
+};
+
+class HomogeneousEdgeMeasure : public Measure {
+public:
+    // Constructs a HomogeneousEdgeMeasure by using the parent constructor and
+    // adding a reference to the SeparationSystem being measured and the team
+    // whose edges are counted.
+    HomogeneousEdgeMeasure(const QString name, const unsigned int freq,
+        SeparationSystem& system, Team team);
+
+    // Returns the number of nearest neighbor pairs in which both particles
+    // belong to the measured team, as maintained by the system.
+    double calculate() const final;
+
+protected:
+    SeparationSystem& _system;
+    const Team _team;
+};
+
+class HeterogeneousEdgeMeasure : public Measure {
+public:
+    // Constructs a HeterogeneousEdgeMeasure by using the parent constructor and
+    // adding a reference to the SeparationSystem being measured.
+    HeterogeneousEdgeMeasure(const QString name, const unsigned int freq,
+        SeparationSystem& system);
+
+    // Returns the number of nearest neighbor pairs in which the particles
+    // belong to different teams, as maintained by the system.
+    double calculate() const final;
+
+protected:
+    SeparationSystem& _system;
+};
+
+class SeparationPerimeterMeasure : public Measure {
+public:
+    // Constructs a SeparationPerimeterMeasure by using the parent constructor
+    // and adding a reference to the SeparationSystem being measured.
+    SeparationPerimeterMeasure(const QString name, const unsigned int freq,
+        SeparationSystem& system);
+
+    // Returns the perimeter of the system computed as in PerimeterMeasure, i.e.,
+    // (3 * #particles) - (#nearest neighbor pairs) - 3, where the neighbor pairs
+    // are the homogeneous and heterogeneous edges maintained by the system.
+    double calculate() const final;
+
+protected:
+    SeparationSystem& _system;
 };
 
 #endif // AMOEBOTSIM_ALG_SEPARATION_H_
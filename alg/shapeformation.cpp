@@ -6,6 +6,8 @@
 
 #include <QtGlobal>
 
+#include "core/shapeanalysis.h"
+
 ShapeFormationParticle::ShapeFormationParticle(const Node head,
                                                const int globalTailDir,
                                                const int orientation,
@@ -44,16 +46,19 @@ void ShapeFormationParticle::activate() {
     } else if (state == State::Idle) {
       if (hasNbrInState({State::Seed, State::Finish})) {
         state = State::Lead;
+        recordState(static_cast<int>(state));
         updateMoveDir();
         return;
       } else if (hasNbrInState({State::Lead, State::Follow})) {
         state = State::Follow;
+        recordState(static_cast<int>(state));
         followDir = labelOfFirstNbrInState({State::Lead, State::Follow});
         return;
       }
     } else if (state == State::Follow) {
       if (hasNbrInState({State::Seed, State::Finish})) {
         state = State::Lead;
+        recordState(static_cast<int>(state));
         updateMoveDir();
         return;
       } else if (hasTailAtLabel(followDir)) {
@@ -66,6 +71,7 @@ void ShapeFormationParticle::activate() {
     } else if (state == State::Lead) {
       if (canFinish()) {
         state = State::Finish;
+        recordState(static_cast<int>(state));
         updateConstructionDir();
         return;
       } else {
@@ -350,6 +356,24 @@ ShapeFormationSystem::ShapeFormationSystem(int numParticles, double holeProb,
       }
     }
   }
+
+  setUpMeasures();
+}
+
+ShapeFormationSystem::ShapeFormationSystem(const Configuration& config,
+                                           QString mode) {
+  Q_ASSERT(getAcceptedModes().count(mode) == 1);
+  Q_ASSERT(!config.particles.empty());
+
+  insert(config, [&](const Node& head, int globalTailDir, size_t index) {
+    return new ShapeFormationParticle(
+        head, globalTailDir, randDir(), *this,
+        (index == 0) ? ShapeFormationParticle::State::Seed
+                     : ShapeFormationParticle::State::Idle,
+        mode);
+  });
+
+  setUpMeasures();
 }
 
 bool ShapeFormationSystem::hasTerminated() const {
@@ -374,3 +398,9 @@ std::set<QString> ShapeFormationSystem::getAcceptedModes() {
   std::set<QString> set = {"h", "t1", "t2", "s", "l"};
   return set;
 }
+
+void ShapeFormationSystem::setUpMeasures() {
+  _measures.push_back(new ComponentMeasure("Components", 1, *this));
+  _measures.push_back(new HoleMeasure("Holes", 1, *this));
+  _measures.push_back(new OuterBoundaryMeasure("Outer Boundary", 1, *this));
+}
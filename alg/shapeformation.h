@@ -117,6 +117,12 @@ class ShapeFormationSystem : public AmoebotSystem  {
   ShapeFormationSystem(int numParticles = 200, double holeProb = 0.2,
                        QString mode = "h");
 
+  // Constructs a system of ShapeFormationParticles at the positions of the
+  // given configuration (see core/configuration.h), which must contain at
+  // least one particle, to form the given shape. The first particle of the
+  // configuration is the seed.
+  ShapeFormationSystem(const Configuration& config, QString mode);
+
   // Checks whether or not the system's run of the ShapeFormation formation
   // algorithm has terminated (all particles in state Finish).
   bool hasTerminated() const override;
@@ -124,6 +130,10 @@ class ShapeFormationSystem : public AmoebotSystem  {
   // Returns a set of strings containing the current accepted modes of
   // Shapeformation.
   static std::set<QString> getAcceptedModes();
+
+ private:
+  // Registers the measures of this algorithm.
+  void setUpMeasures();
 };
 
 #endif  // AMOEBOTSIM_ALG_SHAPEFORMATION_H_
@@ -1,5 +1,7 @@
 #include "alg/shortcutbridging.h"
 
+#include "core/occupancygrid.h"
+
 int east = 0;
 int northEast = 1;
 int northWest = 2;
@@ -24,6 +26,18 @@ ShortcutBridgingParticle::ShortcutBridgingParticle(const Node head,
 {
 }
 
+ShortcutBridgingParticle::ShortcutBridgingParticle(
+    const ShortcutBridgingParticle& other, AmoebotSystem& system)
+    : AmoebotParticle(other, system)
+    , lambda(other.lambda)
+    , q(other.q)
+    , numNbrsBefore(other.numNbrsBefore)
+    , flag(other.flag)
+    , nodeBefore(other.nodeBefore)
+    , c(other.c)
+{
+}
+
 void ShortcutBridgingParticle::activate()
 {
     //return;
@@ -203,6 +217,26 @@ QString ShortcutBridgingParticle::inspectionText() const
     return text;
 }
 
+bool ShortcutBridgingParticle::serialize(QDataStream& out) const
+{
+    out << q << static_cast<qint32>(numNbrsBefore) << flag
+        << static_cast<qint32>(nodeBefore.x) << static_cast<qint32>(nodeBefore.y);
+    return true;
+}
+
+void ShortcutBridgingParticle::deserialize(QDataStream& in)
+{
+    qint32 nbrs, x, y;
+    in >> q >> nbrs >> flag >> x >> y;
+    numNbrsBefore = nbrs;
+    nodeBefore = Node(x, y);
+}
+
+AmoebotParticle* ShortcutBridgingParticle::fork(AmoebotSystem& system) const
+{
+    return new ShortcutBridgingParticle(*this, system);
+}
+
 ShortcutBridgingParticle& ShortcutBridgingParticle::nbrAtLabel(int label) const
 {
     return AmoebotParticle::nbrAtLabel<ShortcutBridgingParticle>(label);
@@ -500,10 +534,7 @@ ShortcutBridgingSystem::ShortcutBridgingSystem(int numParticles, double lambda,
 {
     Q_ASSERT(lambda >= 0);
 
-    // Set up metrics.
-    _measures.push_back(new ShortcutPerimeterMeasure("Perimeter", 1, *this));
-    _measures.push_back(new ShortcutGapPerimeterMeasure("Gap Perimeter", 1, *this));
-    _measures.push_back(new WeightedPerimeterMeasure("Weighted measure", 1, *this));
+    setUpMeasures();
 
     switch (shape) {
     case Shape::V:
@@ -539,6 +570,27 @@ ShortcutBridgingSystem::ShortcutBridgingSystem(int numParticles, double lambda,
     }
 }
 
+ShortcutBridgingSystem::ShortcutBridgingSystem(const Configuration& config, double lambda, double c)
+    : c(c)
+{
+    Q_ASSERT(lambda >= 0);
+
+    setUpMeasures();
+
+    insert(config, [&](const Node& head, int globalTailDir, size_t) {
+        return new ShortcutBridgingParticle(head, globalTailDir, randDir(), *this, lambda, c);
+    });
+}
+
+ShortcutBridgingSystem::ShortcutBridgingSystem(const ShortcutBridgingSystem& other)
+    : AmoebotSystem(other)
+    , c(other.c)
+    , optimalWeightedPerimeter(other.optimalWeightedPerimeter)
+    , terminateEveryXActivations(other.terminateEveryXActivations)
+{
+    setUpMeasures();
+}
+
 bool ShortcutBridgingSystem::hasTerminated() const
 {
     if (terminateEveryXActivations > 0) {
@@ -548,11 +600,10 @@ bool ShortcutBridgingSystem::hasTerminated() const
         }
     }
 
-    size_t size = getMeasure("Weighted measure")._history.size();
-    if (size < 1) {
+    if (getMeasure("Weighted measure")._history.empty()) {
         return false;
     }
-    double measure = getMeasure("Weighted measure")._history[size - 1];
+    double measure = getMeasure("Weighted measure")._value;
 
     // alpha values
     // for V: 1.08
@@ -564,6 +615,24 @@ bool ShortcutBridgingSystem::hasTerminated() const
     return false;
 }
 
+std::shared_ptr<System> ShortcutBridgingSystem::fork()
+{
+    syncMeasures();
+    std::shared_ptr<ShortcutBridgingSystem> forked(new ShortcutBridgingSystem(*this));
+    if (!forked->forkState(*this)) {
+        return nullptr;
+    }
+
+    return forked;
+}
+
+void ShortcutBridgingSystem::setUpMeasures()
+{
+    _measures.push_back(new ShortcutPerimeterMeasure("Perimeter", 1, *this));
+    _measures.push_back(new ShortcutGapPerimeterMeasure("Gap Perimeter", 1, *this));
+    _measures.push_back(new WeightedPerimeterMeasure("Weighted measure", 1, *this));
+}
+
 void ShortcutBridgingSystem::drawVGeneric(int numParticles, double lambda, double c, bool smallIslands, bool bigIslands, bool obstacle)
 {
     // Draw v on its head.
@@ -791,19 +860,28 @@ ShortcutPerimeterMeasure::ShortcutPerimeterMeasure(const QString name, const uns
 
 double ShortcutPerimeterMeasure::calculate() const
 {
-    int numEdges = 0;
-    for (const auto& p : _system.particles) {
-        auto comp_p = dynamic_cast<ShortcutBridgingParticle*>(p);
-        auto tailLabels = comp_p->isContracted() ? comp_p->uniqueLabels()
-                                                 : comp_p->tailLabels();
-        for (const int label : tailLabels) {
-            if (comp_p->hasNbrAtLabel(label) && !comp_p->hasExpHeadAtLabel(label)) {
-                ++numEdges;
-            }
-        }
+    return capture()();
+}
+
+std::function<double()> ShortcutPerimeterMeasure::capture() const
+{
+    return capturePerimeter(_system.particles);
+}
+
+std::function<double()> ShortcutPerimeterMeasure::capturePerimeter(const std::vector<AmoebotParticle*>& particles)
+{
+    std::vector<Node> tails;
+    tails.reserve(particles.size());
+    for (const auto& p : particles) {
+        tails.push_back(p->isExpanded() ? p->tail() : p->head);
     }
 
-    return (3 * _system.size()) - (numEdges / 2) - 3;
+    return [tails]() {
+        const OccupancyGrid grid = OccupancyGrid::ofNodes(tails);
+        const quint64 numEdges = OccupancyGrid::edgeCount(grid, grid);
+
+        return (3.0 * tails.size()) - numEdges - 3;
+    };
 }
 
 ShortcutGapPerimeterMeasure::ShortcutGapPerimeterMeasure(const QString name, const unsigned int freq, ShortcutBridgingSystem& system)
@@ -814,48 +892,36 @@ ShortcutGapPerimeterMeasure::ShortcutGapPerimeterMeasure(const QString name, con
 
 double ShortcutGapPerimeterMeasure::calculate() const
 {
-    int gapEdges = 0;
-
-    for (const auto& p : _system.particles) {
-        auto comp_p = dynamic_cast<ShortcutBridgingParticle*>(p);
-        auto tailLabels = comp_p->isContracted() ? comp_p->uniqueLabels()
-                                                 : comp_p->tailLabels();
-        Node positionNode = comp_p->isContracted() ? comp_p->head
-                                                   : comp_p->tail();
-        auto particlePair = _system.objectMap.find(positionNode);
-
-        for (const int label : tailLabels) {
-            if (comp_p->hasNbrAtLabel(label) && !comp_p->hasExpHeadAtLabel(label)) {
-                Node nodeNeighbour = comp_p->nbrAtLabel(label).isContracted()
-                    ? comp_p->nbrAtLabel(label).head
-                    : comp_p->nbrAtLabel(label).tail();
-                auto neighbourPair = _system.objectMap.find(nodeNeighbour);
-                // Land
-                if (particlePair != _system.objectMap.end()) {
-                    // Land-Land: do nothing
-                    if (neighbourPair != _system.objectMap.end()) {
-                    }
-                    // Land-Gap: Add 1
-                    else {
-                        gapEdges++;
-                    }
-                }
-                // Gap
-                else {
-                    // Gap-Land: Add 1
-                    if (neighbourPair != _system.objectMap.end()) {
-                        gapEdges++;
-                    }
-                    // Gap-Gap: add 2
-                    else {
-                        gapEdges += 2;
-                    }
-                }
-            }
-        }
+    return capture()();
+}
+
+std::function<double()> ShortcutGapPerimeterMeasure::capture() const
+{
+    return captureGapPerimeter(_system.particles,
+        _system.objectOccupancy(), _system.c);
+}
+
+std::function<double()> ShortcutGapPerimeterMeasure::captureGapPerimeter(const std::vector<AmoebotParticle*>& particles,
+    std::shared_ptr<const OccupancyGrid> objectGrid, double c)
+{
+    std::vector<Node> tails;
+    tails.reserve(particles.size());
+    for (const auto& p : particles) {
+        tails.push_back(p->isExpanded() ? p->tail() : p->head);
     }
-    auto res = gapEdges * _system.c / 4;
-    return res;
+
+    // Each nearest neighbor pair is seen from both of its particles, and each
+    // time it counts 1 per endpoint over a gap: Land-Land adds 0, Land-Gap adds
+    // 2, and Gap-Gap adds 4 in total.
+    return [tails, objectGrid, c]() {
+        const OccupancyGrid particleGrid = OccupancyGrid::ofNodes(tails);
+        const OccupancyGrid gapGrid = particleGrid.andNot(*objectGrid);
+        const quint64 gapEndpoints = OccupancyGrid::edgeCount(gapGrid, particleGrid)
+            + OccupancyGrid::edgeCount(particleGrid, gapGrid);
+        const quint64 gapEdges = 2 * gapEndpoints;
+
+        return gapEdges * c / 4;
+    };
 }
 
 WeightedPerimeterMeasure::WeightedPerimeterMeasure(const QString name, const unsigned int freq, ShortcutBridgingSystem& system)
@@ -866,15 +932,23 @@ WeightedPerimeterMeasure::WeightedPerimeterMeasure(const QString name, const uns
 
 double WeightedPerimeterMeasure::calculate() const
 {
-    size_t size = _system.getMeasure("Perimeter")._history.size();
-    double perimeter = _system.getMeasure("Perimeter")._history[size - 1];
-
-    size = _system.getMeasure("Gap Perimeter")._history.size();
-    double gapPerimeter = _system.getMeasure("Gap Perimeter")._history[size - 1];
+    double perimeter = _system.getMeasure("Perimeter")._value;
+    double gapPerimeter = _system.getMeasure("Gap Perimeter")._value;
 
     return perimeter + (_system.c - 1) * gapPerimeter;
 }
 
+std::function<double()> WeightedPerimeterMeasure::capture() const
+{
+    const std::function<double()> perimeter = _system.getMeasure("Perimeter").capture();
+    const std::function<double()> gapPerimeter = _system.getMeasure("Gap Perimeter").capture();
+    const double c = _system.c;
+
+    return [perimeter, gapPerimeter, c]() {
+        return perimeter() + (c - 1) * gapPerimeter();
+    };
+}
+
 void ShortcutBridgingSystem::moveParticle(const Node& startNode, const Node& endNode)
 {
     auto p = getParticleAt(startNode);
@@ -1,6 +1,10 @@
 #ifndef AMOEBOTSIM_ALG_SHORTCUTBRIDGING_H_
 #define AMOEBOTSIM_ALG_SHORTCUTBRIDGING_H_
 
+#include <functional>
+#include <memory>
+#include <vector>
+
 #include <QString>
 
 #include "core/amoebotparticle.h"
@@ -28,6 +32,11 @@ public:
     virtual QString inspectionText() const;
 
 protected:
+    // Checkpoint and fork hooks; see AmoebotParticle.
+    bool serialize(QDataStream& out) const override;
+    void deserialize(QDataStream& in) override;
+    AmoebotParticle* fork(AmoebotSystem& system) const override;
+
     // Particle memory.
     const double lambda;
     double q;
@@ -37,6 +46,10 @@ protected:
     const double c;
 
 private:
+    // Constructs a copy of the given particle for a forked system.
+    ShortcutBridgingParticle(const ShortcutBridgingParticle& other,
+        AmoebotSystem& system);
+
     // Gets a reference to the neighboring particle incident to the specified port
     // label. Crashes if no such particle exists at this label; consider using
     // hasNbrAtLabel() first if unsure.
@@ -79,12 +92,27 @@ public:
     // yield compression; a bias below 2.17 will provably yield expansion.
     ShortcutBridgingSystem(int numParticles = 100, double lambda = 4.0, double c = 3 / 2, Shape shape = Shape::V);
 
+    // Constructs a system of ShortcutBridgingParticles and objects at the
+    // positions of the given configuration (see core/configuration.h). The
+    // optimal weighted perimeter of an arbitrary configuration is unknown, so
+    // this system does not terminate.
+    ShortcutBridgingSystem(const Configuration& config, double lambda, double c);
+
     // Because this algorithm never terminates, this simply returns false.
     virtual bool hasTerminated() const;
 
+    // Returns an independent copy of this system; see System::fork.
+    std::shared_ptr<System> fork() override;
+
     double c;
 
 private:
+    // Fork constructor; see AmoebotSystem.
+    ShortcutBridgingSystem(const ShortcutBridgingSystem& other);
+
+    // Registers the measures of this algorithm.
+    void setUpMeasures();
+
     void drawZ(int numParticles, double lambda, double c);
 
     void drawHexagon(int numParticles, double lambda, double c);
@@ -122,8 +150,16 @@ public:
 
     // Calculates the perimeter of the system, i.e., the number of edges on the
     // walk around the unique external boundary of the system. Uses the fact
-    // that perimeter = (3 * #particles) - (#nearest neighbor pairs) - 3.
+    // that perimeter = (3 * #particles) - (#nearest neighbor pairs) - 3, where
+    // the neighbor pairs are counted on a bit-packed occupancy grid. capture
+    // only copies the particles' positions and counts in the returned function.
     double calculate() const final;
+    std::function<double()> capture() const final;
+
+    // Returns the captured perimeter computation for the given particles, which
+    // the measures of OptimalShortcut share.
+    static std::function<double()> capturePerimeter(
+        const std::vector<AmoebotParticle*>& particles);
 
 protected:
     ShortcutBridgingSystem& _system;
@@ -136,7 +172,18 @@ public:
     ShortcutGapPerimeterMeasure(const QString name, const unsigned int freq,
         ShortcutBridgingSystem& system);
 
+    // Calculates c/2 times the number of endpoints of nearest neighbor pairs
+    // that do not lie on an object (i.e., that lie over a gap), counted on
+    // bit-packed occupancy grids of the particles and the objects. capture only
+    // copies the particles' positions and shares the cached object grid.
     double calculate() const final;
+    std::function<double()> capture() const final;
+
+    // As ShortcutPerimeterMeasure::capturePerimeter, for the given particles,
+    // objects, and c.
+    static std::function<double()> captureGapPerimeter(
+        const std::vector<AmoebotParticle*>& particles,
+        std::shared_ptr<const OccupancyGrid> objectGrid, double c);
 
 protected:
     ShortcutBridgingSystem& _system;
@@ -147,7 +194,11 @@ public:
     WeightedPerimeterMeasure(const QString name, const unsigned int freq,
         ShortcutBridgingSystem& system);
 
+    // calculate combines the latest values of the perimeter and gap perimeter
+    // measures. Those may still be pending when measures are evaluated
+    // asynchronously, so capture combines their captures instead.
     double calculate() const final;
+    std::function<double()> capture() const final;
 
 protected:
     ShortcutBridgingSystem& _system;
@@ -7,6 +7,15 @@
 AmoebotParticle::AmoebotParticle(const Node& head, int globalTailDir,
     const int orientation, AmoebotSystem& system)
     : LocalParticle(head, globalTailDir, orientation)
+    , RandomNumberGenerator(system, ShareEngine())
+    , system(system)
+{
+}
+
+AmoebotParticle::AmoebotParticle(const AmoebotParticle& other,
+    AmoebotSystem& system)
+    : LocalParticle(other)
+    , RandomNumberGenerator(system, ShareEngine())
     , system(system)
 {
 }
@@ -55,6 +64,9 @@ void AmoebotParticle::expand(int label)
     globalTailDir = (globalExpansionDir + 3) % 6;
     system.particleMap[head] = this;
 
+    if (system.moveRecorder) {
+        system.moveRecorder->record(this, MoveRecorder::Op::Expand, globalExpansionDir);
+    }
     system.registerMovement();
 }
 
@@ -81,7 +93,12 @@ void AmoebotParticle::push(int label)
         neighbor.head = neighbor.tail();
     }
     neighbor.globalTailDir = -1;
+    neighbor.invalidateRenderAttributes();
 
+    if (system.moveRecorder) {
+        system.moveRecorder->recordHandover(this, &neighbor,
+            MoveRecorder::Op::Push, globalExpansionDir);
+    }
     system.registerMovement(2);
     system.registerActivation(&neighbor);
 }
@@ -98,6 +115,10 @@ void AmoebotParticle::contractHead()
 {
     Q_ASSERT(isExpanded());
 
+    if (system.moveRecorder) {
+        system.moveRecorder->record(this, MoveRecorder::Op::ContractHead, globalTailDir);
+    }
+    system.invalidateNbrs(head);
     system.particleMap.erase(head);
     head = tail();
     globalTailDir = -1;
@@ -109,6 +130,10 @@ void AmoebotParticle::contractTail()
 {
     Q_ASSERT(isExpanded());
 
+    if (system.moveRecorder) {
+        system.moveRecorder->record(this, MoveRecorder::Op::ContractTail, globalTailDir);
+    }
+    system.invalidateNbrs(tail());
     system.particleMap.erase(tail());
     globalTailDir = -1;
 
@@ -138,11 +163,24 @@ void AmoebotParticle::pull(int label)
     neighbor.head = handoverNode;
     neighbor.globalTailDir = globalPullDir;
     system.particleMap[handoverNode] = &neighbor;
+    neighbor.invalidateRenderAttributes();
 
+    if (system.moveRecorder) {
+        system.moveRecorder->recordHandover(this, &neighbor,
+            MoveRecorder::Op::Pull, globalPullDir);
+    }
     system.registerMovement(2);
     system.registerActivation(&neighbor);
 }
 
+void AmoebotParticle::recordState(int state)
+{
+    if (system.moveRecorder) {
+        system.moveRecorder->record(this, MoveRecorder::Op::StateChange, -1,
+            static_cast<quint32>(state));
+    }
+}
+
 bool AmoebotParticle::hasNbrAtLabel(int label) const
 {
     const Node neighboringNode = nbrNodeReachedViaLabel(label);
@@ -238,7 +276,31 @@ int AmoebotParticle::labelOfFirstObjectNbr(int startLabel) const
     return -1;
 }
 
+bool AmoebotParticle::serialize(QDataStream&) const
+{
+    return false;
+}
+
+void AmoebotParticle::deserialize(QDataStream&) { }
+
+bool AmoebotParticle::serializeToken(QDataStream&, const Token&) const
+{
+    return false;
+}
+
+std::shared_ptr<AmoebotParticle::Token> AmoebotParticle::deserializeToken(
+    QDataStream&)
+{
+    return nullptr;
+}
+
+AmoebotParticle* AmoebotParticle::fork(AmoebotSystem&) const
+{
+    return nullptr;
+}
+
 void AmoebotParticle::putToken(std::shared_ptr<Token> token)
 {
     tokens.push_back(token);
+    invalidateRenderAttributes();
 }
@@ -18,12 +18,16 @@
 #include <map>
 #include <memory>
 
+#include <QDataStream>
+
 #include "core/amoebotsystem.h"
 #include "core/localparticle.h"
 #include "core/node.h"
 #include "helper/randomnumbergenerator.h"
 
 class AmoebotParticle : public LocalParticle, public RandomNumberGenerator {
+    friend class AmoebotSystem;
+
 public:
     // Constructs a new particle with a node position for its head, a global
     // compass direction from its head to its tail (-1 if contracted), an offset
@@ -31,6 +35,11 @@ public:
     AmoebotParticle(const Node& head, int globalTailDir, const int orientation,
         AmoebotSystem& system);
 
+    // Constructs a copy of the given particle that belongs to the given
+    // (forked) system; see fork below. The copy holds no tokens, as
+    // AmoebotSystem copies them afterwards.
+    AmoebotParticle(const AmoebotParticle& other, AmoebotSystem& system);
+
     // Deletes the tokens this particle holds before destructing the particle.
     // These deletions are handled by the shared_ptrs.
     virtual ~AmoebotParticle();
@@ -77,6 +86,11 @@ protected:
     bool canPull(int label) const;
     void pull(int label);
 
+    // Reports a change of this particle's algorithm-defined state (e.g., the
+    // value of a state enum) to the move log of its system, if moves are being
+    // recorded; see core/moverecorder.h.
+    void recordState(int state);
+
     // Gets a reference to the neighboring particle incident to the specified port
     // label. Crashes if no such particle exists at this label; consider using
     // hasNbrAtLabel() first if unsure.
@@ -126,7 +140,8 @@ protected:
     // takeToken does the same thing as peekAtToken, but additionally removes the
     // returned reference from this particle's collection. Note that peekAtToken
     // and takeToken both fail when no token of the given type exists in the
-    // collection; consider using hasToken() first if unsure.
+    // collection; consider using hasToken() first if unsure. Putting or taking
+    // a token marks this particle's appearance as changed.
     void putToken(std::shared_ptr<Token> token);
     template <class TokenType>
     std::shared_ptr<TokenType> peekAtToken() const;
@@ -159,6 +174,29 @@ protected:
     bool hasToken(std::function<bool(const std::shared_ptr<TokenType>)>
             propertyCheck) const;
 
+    /* CHECKPOINT HOOKS */
+
+    // Functions called by AmoebotSystem when writing and restoring checkpoints.
+    // The system itself stores the head, tail, and orientation of a particle;
+    // serialize writes everything else in this particle's memory to the stream
+    // and returns true, and deserialize reads it back in the same order. The
+    // default serialize returns false, meaning the particle's algorithm does
+    // not support checkpoints. Likewise, serializeToken writes a token held by
+    // this particle, including whatever identifies its type, and returns
+    // whether it could; deserializeToken reads such a token back (nullptr
+    // marks an invalid stream). By default, tokens are not supported.
+    virtual bool serialize(QDataStream& out) const;
+    virtual void deserialize(QDataStream& in);
+    virtual bool serializeToken(QDataStream& out, const Token& token) const;
+    virtual std::shared_ptr<Token> deserializeToken(QDataStream& in);
+
+    // Returns a copy of this particle, including its algorithm-specific memory,
+    // that belongs to the given system; called by AmoebotSystem when forking.
+    // The default returns nullptr, meaning the particle's algorithm does not
+    // support forks. Tokens are copied by the system through the checkpoint
+    // hooks above, since they may be modified in place.
+    virtual AmoebotParticle* fork(AmoebotSystem& system) const;
+
     AmoebotSystem& system;
 
 private:
@@ -237,6 +275,7 @@ std::shared_ptr<TokenType> AmoebotParticle::takeToken()
         if (token != nullptr) {
             std::swap(tokens[0], tokens[i]);
             tokens.pop_front();
+            invalidateRenderAttributes();
             return token;
         }
     }
@@ -252,6 +291,7 @@ std::shared_ptr<TokenType> AmoebotParticle::takeToken(
         if (token != nullptr && propertyCheck(token)) {
             std::swap(tokens[0], tokens[i]);
             tokens.pop_front();
+            invalidateRenderAttributes();
             return token;
         }
     }
@@ -4,21 +4,137 @@
 
 #include "core/amoebotsystem.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <typeinfo>
+#include <unordered_map>
+
 #include <QDebug>
 #include <QDateTime>
+#include <QFile>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QtConcurrent>
+#include <QtEndian>
 #include <QtGlobal>
 
 #include "core/amoebotparticle.h"
 
+namespace {
+
+// The number of asynchronously evaluated measures that may be pending before
+// the simulation waits for the oldest one.
+const size_t maxPendingMeasures = 256;
+
+// Checkpoints start with this magic string and format version. The positions
+// and orientations of all particles follow as one block of fixed-size records:
+// qint32 head x and y, qint8 global tail direction, and quint8 orientation.
+const char checkpointMagic[] = "AMBC";
+const quint32 checkpointVersion = 2;
+const int particleRecordSize = 10;
+
+// Writes the history of a count or measure as JSON. Histories that do not keep
+// every value also give the index of their first entry and the number of
+// values per entry, and bucketed histories give the minima and maxima of their
+// buckets in addition to the means.
+template <class T>
+void writeHistoryJSON(QTextStream& out, const MetricHistory<T>& history)
+{
+    out << "\"history\" : [";
+    for (size_t i = 0; i < history.size(); ++i) {
+        out << (i == 0 ? "" : ", ") << history[i];
+    }
+    out << "]";
+    if (history.retention() == Retention::Full) {
+        return;
+    }
+
+    out << ", \"firstIndex\" : " << history.index(0);
+    out << ", \"stride\" : " << history.stride();
+    if (history.retention() == Retention::Bucket) {
+        out << ", \"min\" : [";
+        for (size_t i = 0; i < history.size(); ++i) {
+            out << (i == 0 ? "" : ", ") << history.bucket(i).min;
+        }
+        out << "], \"max\" : [";
+        for (size_t i = 0; i < history.size(); ++i) {
+            out << (i == 0 ? "" : ", ") << history.bucket(i).max;
+        }
+        out << "]";
+    }
+}
+
+// Calls visit for the entries of the given node map whose nodes (x, y) satisfy
+// minY <= y <= maxY and minX <= x + y / 2 <= maxX. Since the map is sorted by x
+// and then by y, the nodes of a column in this region are consecutive, and
+// columns without any nodes are skipped.
+template <class T, class Visit>
+void visitRegion(const std::map<Node, T*>& map, int minY, int maxY, double minX,
+    double maxX, Visit visit)
+{
+    if (map.empty() || minY > maxY) {
+        return;
+    }
+
+    const int firstX = std::max(static_cast<int>(std::ceil(minX - 0.5 * maxY)),
+        map.begin()->first.x);
+    const int lastX = std::min(static_cast<int>(std::floor(maxX - 0.5 * minY)),
+        map.rbegin()->first.x);
+    for (int x = firstX; x <= lastX; ++x) {
+        const int lowY = std::max(minY, static_cast<int>(std::ceil(2 * (minX - x))));
+        const int highY = std::min(maxY, static_cast<int>(std::floor(2 * (maxX - x))));
+        auto it = map.lower_bound(Node(x, lowY));
+        if (it == map.end()) {
+            return;
+        } else if (it->first.x > x) {
+            x = it->first.x - 1;
+            continue;
+        }
+        for (; it != map.end() && it->first.x == x && it->first.y <= highY; ++it) {
+            visit(it->first, it->second);
+        }
+    }
+}
+
+} // namespace
+
 AmoebotSystem::AmoebotSystem()
+    : asyncMeasures(false)
+    , snapshotInterval(1)
+    , publishInterval(1)
 {
     _counts.push_back(new Count("# Rounds"));
     _counts.push_back(new Count("# Activations"));
     _counts.push_back(new Count("# Moves"));
 }
 
+AmoebotSystem::AmoebotSystem(const AmoebotSystem& other)
+    : System()
+    , RandomNumberGenerator(other)
+    , objectGrid(other.objectGrid)
+    , particleGrid(other.particleGrid)
+    , asyncMeasures(other.asyncMeasures)
+    , snapshotInterval(1)
+    , publishInterval(1)
+{
+    Q_ASSERT(other.pendingMeasures.empty());
+
+    for (const auto& o : other.objects) {
+        objects.push_back(new Object(*o));
+        objectMap[o->_node] = objects.back();
+    }
+    for (const auto& c : other._counts) {
+        _counts.push_back(new Count(*c));
+    }
+}
+
 AmoebotSystem::~AmoebotSystem()
 {
+    for (auto& pending : pendingMeasures) {
+        pending.second.waitForFinished();
+    }
+
     for (auto p : particles) {
         delete p;
     }
@@ -88,6 +204,9 @@ bool AmoebotSystem::changeLocation(const Node& startNode)
 
     particleMap.erase(it);
     particleMap[p->head] = p;
+    particleGrid.reset();
+    reportChange(startNode);
+    reportChange(p->head);
 
     return true;
 }
@@ -97,6 +216,70 @@ const std::deque<Object*>& AmoebotSystem::getObjects() const
     return objects;
 }
 
+const Particle* AmoebotSystem::particleAt(const Node& node) const
+{
+    auto it = particleMap.find(node);
+    return (it != particleMap.end()) ? it->second : nullptr;
+}
+
+void AmoebotSystem::particlesInRegion(int minY, int maxY, double minX,
+    double maxX, std::vector<const Particle*>& result) const
+{
+    visitRegion(particleMap, minY, maxY, minX, maxX,
+        [&result](const Node& node, const AmoebotParticle* p) {
+            // Expanded particles are also mapped from their tails.
+            if (node == p->head) {
+                result.push_back(p);
+            }
+        });
+}
+
+void AmoebotSystem::objectsInRegion(int minY, int maxY, double minX,
+    double maxX, std::vector<const Object*>& result) const
+{
+    visitRegion(objectMap, minY, maxY, minX, maxX,
+        [&result](const Node&, const Object* o) { result.push_back(o); });
+}
+
+std::shared_ptr<const OccupancyGrid> AmoebotSystem::objectOccupancy() const
+{
+    if (!objectGrid) {
+        std::vector<Node> nodes;
+        nodes.reserve(objects.size());
+        for (const auto& t : objects) {
+            nodes.push_back(t->_node);
+        }
+        objectGrid = std::make_shared<OccupancyGrid>(OccupancyGrid::ofNodes(nodes));
+    }
+
+    return objectGrid;
+}
+
+std::shared_ptr<const OccupancyGrid> AmoebotSystem::particleOccupancy() const
+{
+    if (!particleGrid) {
+        std::shared_ptr<OccupancyGrid> grid = std::make_shared<OccupancyGrid>();
+        if (!particleMap.empty()) {
+            // As for objects, particleMap bounds the x-coordinates of all
+            // occupied nodes; it holds both the head and the tail of every
+            // expanded particle.
+            int minY = particleMap.begin()->first.y, maxY = minY;
+            for (const auto& entry : particleMap) {
+                minY = std::min(minY, entry.first.y);
+                maxY = std::max(maxY, entry.first.y);
+            }
+            *grid = OccupancyGrid(particleMap.begin()->first.x, minY,
+                particleMap.rbegin()->first.x, maxY);
+            for (const auto& entry : particleMap) {
+                grid->set(entry.first);
+            }
+        }
+        particleGrid = grid;
+    }
+
+    return particleGrid;
+}
+
 void AmoebotSystem::insert(AmoebotParticle* particle)
 {
     if(particleMap.find(particle->head) != particleMap.end()){
@@ -115,10 +298,15 @@ void AmoebotSystem::insert(AmoebotParticle* particle)
         Q_ASSERT(!particle->isExpanded() || particleMap.find(particle->tail()) == particleMap.end());
 
         particles.push_back(particle);
+        if (moveRecorder) {
+            moveRecorder->addParticle(particle);
+        }
         particleMap[particle->head] = particle;
         if (particle->isExpanded()) {
             particleMap[particle->tail()] = particle;
         }
+        particleGrid.reset();
+        reportAllChanged();
     }
 }
 
@@ -129,6 +317,66 @@ void AmoebotSystem::insert(Object* object)
 
     objects.push_back(object);
     objectMap[object->_node] = object;
+    objectGrid.reset();
+    reportAllChanged();
+    reportObjectsChanged();
+    if (moveRecorder) {
+        moveRecorder->addObject(*object);
+    }
+}
+
+void AmoebotSystem::insert(const Configuration& config,
+    std::function<AmoebotParticle*(const Node& head, int globalTailDir, size_t index)> newParticle)
+{
+    Q_ASSERT(particles.empty() && objects.empty());
+
+    // Inserting the nodes in sorted order with a hint at the end of each map
+    // takes amortized constant time per node.
+    auto byNode = [](const std::pair<Node, void*>& a, const std::pair<Node, void*>& b) {
+        return a.first < b.first;
+    };
+
+    std::vector<std::pair<Node, void*>> nodes;
+    nodes.reserve(config.objects.size());
+    for (const auto& o : config.objects) {
+        Object* object = new Object(o);
+        objects.push_back(object);
+        nodes.push_back(std::make_pair(object->_node, object));
+        if (moveRecorder) {
+            moveRecorder->addObject(*object);
+        }
+    }
+    std::sort(nodes.begin(), nodes.end(), byNode);
+    for (const auto& n : nodes) {
+        objectMap.emplace_hint(objectMap.end(), n.first, static_cast<Object*>(n.second));
+    }
+    objectGrid.reset();
+    if (!config.objects.empty()) {
+        reportObjectsChanged();
+    }
+
+    nodes.clear();
+    nodes.reserve(2 * config.particles.size());
+    particles.reserve(config.particles.size());
+    for (size_t i = 0; i < config.particles.size(); ++i) {
+        const auto& entry = config.particles[i];
+        AmoebotParticle* particle = newParticle(entry.head, entry.globalTailDir, i);
+        particles.push_back(particle);
+        nodes.push_back(std::make_pair(particle->head, particle));
+        if (particle->isExpanded()) {
+            nodes.push_back(std::make_pair(particle->tail(), particle));
+        }
+        if (moveRecorder) {
+            moveRecorder->addParticle(particle);
+        }
+    }
+    std::sort(nodes.begin(), nodes.end(), byNode);
+    for (const auto& n : nodes) {
+        particleMap.emplace_hint(particleMap.end(), n.first,
+            static_cast<AmoebotParticle*>(n.second));
+    }
+    particleGrid.reset();
+    reportAllChanged();
 }
 
 void AmoebotSystem::removeParticles(bool removeObjects)
@@ -138,6 +386,11 @@ void AmoebotSystem::removeParticles(bool removeObjects)
     }
     particles.clear();
     particleMap.clear();
+    particleGrid.reset();
+    reportAllChanged();
+    if (moveRecorder) {
+        moveRecorder->removeParticles(removeObjects);
+    }
 
     if (removeObjects) {
         for (auto t : objects) {
@@ -145,17 +398,31 @@ void AmoebotSystem::removeParticles(bool removeObjects)
         }
         objects.clear();
         objectMap.clear();
+        objectGrid.reset();
+        reportObjectsChanged();
     }
 }
 
 void AmoebotSystem::registerMovement(unsigned int numMoves)
 {
     getCount("# Moves").record(numMoves);
+    particleGrid.reset();
 }
 
 void AmoebotSystem::registerActivation(AmoebotParticle* particle)
 {
     getCount("# Activations").record();
+
+    // An activation can change the particle and, through nbrAtLabel, its
+    // neighbors; neighbors it had before contracting were marked when it
+    // contracted.
+    particle->invalidateRenderAttributes();
+    invalidateNbrs(particle->head);
+    reportChange(particle->head);
+    if (particle->isExpanded()) {
+        invalidateNbrs(particle->tail());
+        reportChange(particle->tail());
+    }
     activatedParticles.insert(particle);
     if (activatedParticles.size() == particles.size()) {
         registerRound();
@@ -163,19 +430,481 @@ void AmoebotSystem::registerActivation(AmoebotParticle* particle)
     }
 }
 
+void AmoebotSystem::invalidateNbrs(const Node& node)
+{
+    for (int dir = 0; dir < 6; ++dir) {
+        auto it = particleMap.find(node.nodeInDir(dir));
+        if (it != particleMap.end()) {
+            it->second->invalidateRenderAttributes();
+        }
+    }
+}
+
 void AmoebotSystem::registerRound()
 {
-    for (const auto& c : _counts) {
-        c->_history.push_back(c->_value);
+    for (size_t i = 0; i < _counts.size(); ++i) {
+        _counts[i]->_history.push_back(_counts[i]->_value);
+        if (metricsWriter) {
+            metricsWriter->appendCount(i, _counts[i]->_value);
+        }
     }
-    for (const auto& m : _measures) {
+    for (size_t i = 0; i < _measures.size(); ++i) {
+        Measure* m = _measures[i];
         if (getCount("# Rounds")._value % m->_freq == 0) {
-            m->_history.push_back(m->calculate());
+            if (asyncMeasures) {
+                pendingMeasures.push_back(std::make_pair(i,
+                    QtConcurrent::run(m->capture())));
+            } else {
+                recordMeasure(i, m->calculate());
+            }
         }
     }
     getCount("# Rounds").record();
+    if (snapshotWriter && getCount("# Rounds")._value % snapshotInterval == 0) {
+        snapshotWriter->append(getCount("# Rounds")._value, configuration());
+    }
+    if (liveStatePublisher && getCount("# Rounds")._value % publishInterval == 0) {
+        liveStatePublisher->publish(*this, getCount("# Rounds")._value);
+    }
+
+    if (!pendingMeasures.empty()) {
+        commitMeasures(false);
+    }
 }
 
+void AmoebotSystem::setAsyncMeasures(bool async)
+{
+    if (!async) {
+        syncMeasures();
+    }
+    asyncMeasures = async;
+}
+
+void AmoebotSystem::syncMeasures()
+{
+    commitMeasures(true);
+}
+
+void AmoebotSystem::commitMeasures(bool wait)
+{
+    while (!pendingMeasures.empty()) {
+        auto& pending = pendingMeasures.front();
+        if (!wait && !pending.second.isFinished()
+            && pendingMeasures.size() <= maxPendingMeasures) {
+            break;
+        }
+        recordMeasure(pending.first, pending.second.result());
+        pendingMeasures.pop_front();
+    }
+}
+
+void AmoebotSystem::recordMeasure(size_t index, double value)
+{
+    _measures[index]->_value = value;
+    _measures[index]->_history.push_back(value);
+    if (metricsWriter) {
+        metricsWriter->appendMeasure(index, value);
+    }
+}
+
+Configuration AmoebotSystem::configuration() const
+{
+    Configuration config;
+    config.particles.reserve(particles.size());
+    for (const auto& p : particles) {
+        config.particles.push_back({p->head, p->globalTailDir});
+    }
+    config.objects.reserve(objects.size());
+    for (const auto& o : objects) {
+        config.objects.push_back(*o);
+    }
+
+    return config;
+}
+
+bool AmoebotSystem::streamMetrics(const QString filePath)
+{
+    // Values still being calculated belong to the previous stream.
+    syncMeasures();
+    metricsWriter.reset();
+    if (!filePath.isEmpty()) {
+        metricsWriter.reset(new MetricsWriter(filePath, _counts, _measures));
+        if (!metricsWriter->isOpen()) {
+            metricsWriter.reset();
+        }
+    }
+
+    return metricsWriter != nullptr;
+}
+
+bool AmoebotSystem::recordMoves(const QString filePath)
+{
+    moveRecorder.reset();
+    if (!filePath.isEmpty()) {
+        moveRecorder.reset(new MoveRecorder(filePath, getCount("# Activations")));
+        if (!moveRecorder->isOpen()) {
+            moveRecorder.reset();
+        } else {
+            for (const auto& o : objects) {
+                moveRecorder->addObject(*o);
+            }
+            for (const auto& p : particles) {
+                moveRecorder->addParticle(p);
+            }
+        }
+    }
+
+    return moveRecorder != nullptr;
+}
+
+bool AmoebotSystem::recordSnapshots(const QString filePath, int everyRounds)
+{
+    snapshotWriter.reset();
+    if (!filePath.isEmpty() && everyRounds > 0) {
+        snapshotWriter.reset(new SnapshotWriter(filePath));
+        if (!snapshotWriter->isOpen()) {
+            snapshotWriter.reset();
+        } else {
+            snapshotInterval = static_cast<quint64>(everyRounds);
+            snapshotWriter->append(getCount("# Rounds")._value, configuration());
+        }
+    }
+
+    return snapshotWriter != nullptr;
+}
+
+bool AmoebotSystem::publishLiveState(const QString filePath, int everyRounds)
+{
+    liveStatePublisher.reset();
+    if (!filePath.isEmpty() && everyRounds > 0) {
+        liveStatePublisher.reset(new LiveStatePublisher(filePath, *this, particles.size()));
+        if (!liveStatePublisher->isOpen()) {
+            liveStatePublisher.reset();
+        } else {
+            publishInterval = static_cast<quint64>(everyRounds);
+            liveStatePublisher->publish(*this, getCount("# Rounds")._value);
+        }
+    }
+
+    return liveStatePublisher != nullptr;
+}
+
+bool AmoebotSystem::saveConfiguration(const QString filePath) const
+{
+    return configuration().save(filePath);
+}
+
+bool AmoebotSystem::saveCheckpoint(const QString filePath)
+{
+    // Results of pending measures belong to the saved histories.
+    syncMeasures();
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::LittleEndian);
+
+    const std::string rng = rngState();
+    out.writeRawData(checkpointMagic, 4);
+    out << checkpointVersion << QByteArray(typeid(*this).name())
+        << QByteArray(rng.data(), static_cast<int>(rng.size()));
+
+    if (!writeState(out) || out.status() != QDataStream::Ok) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+bool AmoebotSystem::loadCheckpoint(const QString filePath)
+{
+    // Results of pending measures would be appended to restored histories.
+    syncMeasures();
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QDataStream in(&file);
+    in.setByteOrder(QDataStream::LittleEndian);
+
+    char magic[4];
+    quint32 version;
+    QByteArray type, rng;
+    if (in.readRawData(magic, 4) != 4
+        || std::memcmp(magic, checkpointMagic, 4) != 0) {
+        return false;
+    }
+    in >> version >> type >> rng;
+    if (in.status() != QDataStream::Ok || version != checkpointVersion
+        || type != QByteArray(typeid(*this).name())) {
+        return false;
+    }
+
+    // The state is replaced piece by piece, and a corrupt checkpoint may only
+    // be noticed late, so the current state is saved first and restored if
+    // reading fails; the system is then exactly as before, up to new object
+    // and token instances.
+    QByteArray backup;
+    QDataStream backupOut(&backup, QIODevice::WriteOnly);
+    backupOut.setByteOrder(QDataStream::LittleEndian);
+    const std::string backupRng = rngState();
+    if (!writeState(backupOut) || !setRngState(rng.toStdString())) {
+        return false;
+    }
+    if (!readState(in)) {
+        QDataStream backupIn(backup);
+        backupIn.setByteOrder(QDataStream::LittleEndian);
+        const bool restored = readState(backupIn) && setRngState(backupRng);
+        Q_ASSERT(restored);
+        Q_UNUSED(restored);
+        return false;
+    }
+
+    // A move log cannot express the jump to the restored state.
+    moveRecorder.reset();
+
+    return true;
+}
+
+void AmoebotSystem::setSeed(const quint32 seed)
+{
+    RandomNumberGenerator::setSeed(seed);
+}
+
+bool AmoebotSystem::writeState(QDataStream& out) const
+{
+    out << static_cast<quint32>(objects.size());
+    for (const auto& o : objects) {
+        out << static_cast<qint32>(o->_node.x) << static_cast<qint32>(o->_node.y)
+            << o->_isTraversable << o->_anchor;
+    }
+
+    // Positions are written as one block, as they make up most of a
+    // checkpoint of a large system without per-particle memory.
+    QByteArray records(static_cast<int>(particles.size()) * particleRecordSize, 0);
+    char* record = records.data();
+    for (const auto& p : particles) {
+        qToLittleEndian<qint32>(p->head.x, record);
+        qToLittleEndian<qint32>(p->head.y, record + 4);
+        record[8] = static_cast<char>(p->globalTailDir);
+        record[9] = static_cast<char>(p->orientation);
+        record += particleRecordSize;
+    }
+    out << static_cast<quint32>(particles.size());
+    out.writeRawData(records.constData(), records.size());
+
+    for (const auto& p : particles) {
+        if (!p->serialize(out)) {
+            return false;
+        }
+        out << static_cast<quint32>(p->tokens.size());
+        for (const auto& token : p->tokens) {
+            if (!p->serializeToken(out, *token)) {
+                return false;
+            }
+        }
+    }
+
+    out << static_cast<quint32>(activatedParticles.size());
+    for (size_t i = 0; i < particles.size(); ++i) {
+        if (activatedParticles.find(particles[i]) != activatedParticles.end()) {
+            out << static_cast<quint32>(i);
+        }
+    }
+
+    serialize(out);
+
+    out << static_cast<quint32>(_counts.size());
+    for (const auto& c : _counts) {
+        out << c->_name.toUtf8() << c->_value << c->_history;
+    }
+    out << static_cast<quint32>(_measures.size());
+    for (const auto& m : _measures) {
+        out << m->_name.toUtf8() << m->_value << m->_history;
+    }
+
+    return out.status() == QDataStream::Ok;
+}
+
+bool AmoebotSystem::readState(QDataStream& in)
+{
+    // Read and validate everything that replaces existing state wholesale
+    // before changing the system.
+    quint32 numObjects;
+    in >> numObjects;
+    std::vector<Object> restoredObjects;
+    for (quint32 i = 0; i < numObjects && in.status() == QDataStream::Ok; ++i) {
+        qint32 x, y;
+        bool isTraversable, anchor;
+        in >> x >> y >> isTraversable >> anchor;
+        restoredObjects.push_back(Object(Node(x, y), isTraversable, anchor));
+    }
+
+    quint32 numParticles;
+    in >> numParticles;
+    if (in.status() != QDataStream::Ok || numParticles != particles.size()) {
+        return false;
+    }
+    QByteArray records(static_cast<int>(numParticles) * particleRecordSize, 0);
+    if (in.readRawData(records.data(), records.size()) != records.size()) {
+        return false;
+    }
+    for (int i = 0; i < records.size(); i += particleRecordSize) {
+        const int globalTailDir = static_cast<qint8>(records[i + 8]);
+        const int orientation = static_cast<qint8>(records[i + 9]);
+        if (globalTailDir < -1 || globalTailDir >= 6 || orientation < 0
+            || orientation >= 6) {
+            return false;
+        }
+    }
+
+    for (auto o : objects) {
+        delete o;
+    }
+    objects.clear();
+    objectMap.clear();
+    for (const auto& o : restoredObjects) {
+        objects.push_back(new Object(o));
+        objectMap[o._node] = objects.back();
+    }
+    objectGrid.reset();
+    reportObjectsChanged();
+
+    particleMap.clear();
+    const char* record = records.constData();
+    for (const auto& p : particles) {
+        p->head = Node(qFromLittleEndian<qint32>(record),
+            qFromLittleEndian<qint32>(record + 4));
+        p->globalTailDir = static_cast<qint8>(record[8]);
+        p->orientation = static_cast<qint8>(record[9]);
+        particleMap[p->head] = p;
+        if (p->isExpanded()) {
+            particleMap[p->tail()] = p;
+        }
+        record += particleRecordSize;
+    }
+    particleGrid.reset();
+    reportAllChanged();
+
+    for (const auto& p : particles) {
+        p->deserialize(in);
+        quint32 numTokens;
+        in >> numTokens;
+        p->tokens.clear();
+        for (quint32 i = 0; i < numTokens && in.status() == QDataStream::Ok; ++i) {
+            std::shared_ptr<AmoebotParticle::Token> token = p->deserializeToken(in);
+            if (!token) {
+                return false;
+            }
+            p->tokens.push_back(token);
+        }
+        if (in.status() != QDataStream::Ok) {
+            return false;
+        }
+    }
+
+    quint32 numActivated;
+    in >> numActivated;
+    activatedParticles.clear();
+    for (quint32 i = 0; i < numActivated && in.status() == QDataStream::Ok; ++i) {
+        quint32 index;
+        in >> index;
+        if (index >= particles.size()) {
+            return false;
+        }
+        activatedParticles.insert(particles[index]);
+    }
+
+    deserialize(in);
+
+    quint32 numCounts, numMeasures;
+    QByteArray name;
+    in >> numCounts;
+    if (numCounts != _counts.size()) {
+        return false;
+    }
+    for (const auto& c : _counts) {
+        in >> name >> c->_value >> c->_history;
+        if (name != c->_name.toUtf8()) {
+            return false;
+        }
+    }
+    in >> numMeasures;
+    if (numMeasures != _measures.size()) {
+        return false;
+    }
+    for (const auto& m : _measures) {
+        in >> name >> m->_value >> m->_history;
+        if (name != m->_name.toUtf8()) {
+            return false;
+        }
+    }
+
+    return in.status() == QDataStream::Ok;
+}
+
+bool AmoebotSystem::forkState(const AmoebotSystem& other)
+{
+    Q_ASSERT(particles.empty() && _measures.size() == other._measures.size());
+
+    // Maps the particles of the other system to their copies.
+    std::unordered_map<const AmoebotParticle*, AmoebotParticle*> copies;
+    copies.reserve(other.particles.size());
+    particles.reserve(other.particles.size());
+    for (const auto& p : other.particles) {
+        AmoebotParticle* copy = p->fork(*this);
+        if (copy == nullptr) {
+            return false;
+        }
+        particles.push_back(copy);
+        copies[p] = copy;
+
+        // Tokens are copied through their checkpoint hooks, as a particle may
+        // modify a token it holds.
+        if (!p->tokens.empty()) {
+            QByteArray bytes;
+            QDataStream out(&bytes, QIODevice::WriteOnly);
+            for (const auto& token : p->tokens) {
+                if (!p->serializeToken(out, *token)) {
+                    return false;
+                }
+            }
+            QDataStream in(bytes);
+            for (size_t i = 0; i < p->tokens.size(); ++i) {
+                std::shared_ptr<AmoebotParticle::Token> token = copy->deserializeToken(in);
+                if (!token) {
+                    return false;
+                }
+                copy->tokens.push_back(token);
+            }
+        }
+    }
+
+    // Copying the map and replacing its values avoids rebalancing it.
+    particleMap = other.particleMap;
+    for (auto& entry : particleMap) {
+        entry.second = copies[entry.second];
+    }
+    for (const auto& p : other.activatedParticles) {
+        activatedParticles.insert(copies[p]);
+    }
+
+    for (size_t i = 0; i < _measures.size(); ++i) {
+        Q_ASSERT(_measures[i]->_name == other._measures[i]->_name);
+        _measures[i]->_value = other._measures[i]->_value;
+        _measures[i]->_history = other._measures[i]->_history;
+    }
+
+    return true;
+}
+
+void AmoebotSystem::serialize(QDataStream&) const { }
+
+void AmoebotSystem::deserialize(QDataStream&) { }
+
 const std::vector<Count*>& AmoebotSystem::getCounts() const
 {
     return _counts;
@@ -208,40 +937,32 @@ Measure& AmoebotSystem::getMeasure(QString name) const
 
 const QString AmoebotSystem::metricsAsJSON() const
 {
-    QString json = "{\"title\" : \"AmoebotSim Metrics JSON\", ";
-    json += "\"datetime\" : \"" + QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss") + "\", ";
-    json += "\"algorithm\" : \"???\", ";
-    json += "\"counts\" : [";
-    for (const auto& c : _counts) {
-        json += "{\"name\" : \"" + c->_name + "\", ";
-        json += "\"history\" : [";
-        for (auto val : c->_history) {
-            json += QString::number(val) += ", ";
-        }
-        if (!c->_history.empty()) {
-            json.chop(2); // Remove the last ", ".
-        }
-        json += "]}, ";
-    }
-    if (!_counts.empty()) {
-        json.chop(2); // Remove the last ", ".
-    }
-    json += "], \"measures\" : [";
-    for (const auto& m : _measures) {
-        json += "{\"name\" : \"" + m->_name + "\", ";
-        json += "\"frequency\" : " + QString::number(m->_freq) + ", ";
-        json += "\"history\" : [";
-        for (auto val : m->_history) {
-            json += QString::number(val) += ", ";
-        }
-        if (!m->_history.empty()) {
-            json.chop(2); // Remove the last ", ".
-        }
-        json += "]}, ";
+    QString json;
+    QTextStream out(&json);
+    writeMetricsJSON(out);
+    out.flush();
+    return json;
+}
+
+void AmoebotSystem::writeMetricsJSON(QTextStream& out) const
+{
+    out << "{\"title\" : \"AmoebotSim Metrics JSON\", ";
+    out << "\"datetime\" : \"" << QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss") << "\", ";
+    out << "\"algorithm\" : \"???\", ";
+    out << "\"counts\" : [";
+    for (size_t i = 0; i < _counts.size(); ++i) {
+        const Count* c = _counts[i];
+        out << (i == 0 ? "" : ", ") << "{\"name\" : \"" << c->_name << "\", ";
+        writeHistoryJSON(out, c->_history);
+        out << "}";
     }
-    if (!_measures.empty()) {
-        json.chop(2); // Remove the last ", ".
+    out << "], \"measures\" : [";
+    for (size_t i = 0; i < _measures.size(); ++i) {
+        const Measure* m = _measures[i];
+        out << (i == 0 ? "" : ", ") << "{\"name\" : \"" << m->_name << "\", ";
+        out << "\"frequency\" : " << m->_freq << ", ";
+        writeHistoryJSON(out, m->_history);
+        out << "}";
     }
-    json += "]}";
-    return json;
+    out << "]}";
 }
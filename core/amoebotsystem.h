@@ -9,14 +9,25 @@
 #define AMOEBOTSIM_CORE_AMOEBOTSYSTEM_H_
 
 #include <deque>
+#include <functional>
 #include <map>
+#include <memory>
 #include <set>
+#include <utility>
 #include <vector>
 
+#include <QDataStream>
+#include <QFuture>
 #include <QString>
 
+#include "core/configuration.h"
+#include "core/livestatepublisher.h"
 #include "core/metric.h"
+#include "core/metricswriter.h"
+#include "core/moverecorder.h"
 #include "core/object.h"
+#include "core/occupancygrid.h"
+#include "core/snapshotwriter.h"
 #include "core/system.h"
 #include "helper/randomnumbergenerator.h"
 
@@ -58,6 +69,29 @@ public:
     // Returns a reference to the object list.
     virtual const std::deque<Object*>& getObjects() const final;
 
+    // Spatial queries through the node maps of the particles and objects; see
+    // System::particleAt. The region queries look up the nodes of each column
+    // crossing the region, so they take time logarithmic in the number of
+    // particles (resp., objects) per column plus linear in the result.
+    const Particle* particleAt(const Node& node) const final;
+    void particlesInRegion(int minY, int maxY, double minX, double maxX,
+        std::vector<const Particle*>& result) const final;
+    void objectsInRegion(int minY, int maxY, double minX, double maxX,
+        std::vector<const Object*>& result) const final;
+
+    // Returns an occupancy grid covering exactly the nodes occupied by objects,
+    // which is sparse if the objects are spread out. Since objects do not move,
+    // the grid is cached and only replaced after objects have been inserted or
+    // removed, so measures can capture it like the particle grid below.
+    std::shared_ptr<const OccupancyGrid> objectOccupancy() const;
+
+    // Returns a bit-packed occupancy grid covering exactly the nodes occupied by
+    // particles, counting both the head and the tail of expanded particles. The
+    // grid is cached until the next movement, so measures of the same round
+    // share it; since a movement replaces the cached grid rather than modifying
+    // it, a captured grid remains a valid snapshot of its round.
+    std::shared_ptr<const OccupancyGrid> particleOccupancy() const;
+
     // Inserts a particle or an object, respectively, into the system. A particle
     // can be contracted or expanded. Fails if the respective node(s) are already
     // occupied.
@@ -76,6 +110,17 @@ public:
     void registerActivation(AmoebotParticle* particle);
     void registerRound();
 
+    // Functions for asynchronous measure evaluation. When enabled, registerRound
+    // only captures each due measure (see Measure::capture) and hands the
+    // computation to the global thread pool. Results are appended to the
+    // histories in the order the measures were captured, as soon as they (and
+    // all earlier ones) are finished; this is checked at every round, and the
+    // simulation waits for the oldest result only if too many are pending.
+    // syncMeasures waits for all pending results. Disabling asynchronous
+    // evaluation first synchronizes the measures.
+    void setAsyncMeasures(bool async) final;
+    void syncMeasures() final;
+
     // Various access functions for metrics (counts and measures). getCounts
     // (resp., getMeasures) returns a reference to the count (resp., measure)
     // list. getCount (resp., getMeasure) returns a reference to the named count
@@ -86,18 +131,133 @@ public:
     Count& getCount(QString name) const final;
     Measure& getMeasure(QString name) const final;
 
-    // Formats the count and measure histories as a JSON string. The structure of
-    // this JSON string can be found in the Usage documentation.
+    // Formats the count and measure histories as JSON, either as a string or
+    // written piece by piece to the given stream. The structure of this JSON
+    // can be found in the Usage documentation.
     const QString metricsAsJSON() const final;
+    void writeMetricsJSON(QTextStream& out) const final;
+
+    // Streams every value appended to a count or measure history to the given
+    // file; see System::streamMetrics.
+    bool streamMetrics(const QString filePath) final;
+
+    // Records every movement of the particles (and the state changes reported
+    // by their algorithm, see AmoebotParticle::recordState) to the given file,
+    // starting with the current objects and particles; see System::recordMoves
+    // and core/moverecorder.h. Loading a checkpoint stops recording.
+    bool recordMoves(const QString filePath) final;
+
+    // Writes a snapshot of the positions of the particles and objects to the
+    // given file right away and then after every round whose number is a
+    // multiple of everyRounds; see System::recordSnapshots and
+    // core/snapshotwriter.h.
+    bool recordSnapshots(const QString filePath, int everyRounds) final;
+
+    // Publishes the live state right away and then after every round whose
+    // number is a multiple of everyRounds, with room for as many particles as
+    // the system has now; see System::publishLiveState and
+    // core/livestatepublisher.h.
+    bool publishLiveState(const QString filePath, int everyRounds) final;
+
+    // Saves the positions of the particles, in order, and of the objects; see
+    // System::saveConfiguration.
+    bool saveConfiguration(const QString filePath) const final;
+
+    // Writes the complete state of this system to a checkpoint file, or
+    // restores it from one. A checkpoint holds the objects, the position,
+    // orientation, memory, and tokens of every particle (see the checkpoint
+    // hooks of AmoebotParticle), which particles were activated in the current
+    // round, the state of algorithm-specific subclasses (see serialize), all
+    // counts and measures with their histories, and the state of the random
+    // number generator, so a restored system continues exactly as the saved
+    // one would have. Checkpoints can only be restored into a system of the
+    // same algorithm with as many particles as the saved one, e.g., one that
+    // was constructed with the same parameters; the particles are overwritten
+    // in order. Saving fails if the algorithm does not support checkpoints,
+    // and restoring fails without changing the system if the file does not
+    // match it or is corrupt.
+    bool saveCheckpoint(const QString filePath) final;
+    bool loadCheckpoint(const QString filePath) final;
+
+    // Reseeds the generator that this system and its particles draw from. Each
+    // system has its own generator, and a fork starts with a copy of its
+    // original's, so reseeding one does not affect the other.
+    void setSeed(const quint32 seed) final;
 
 protected:
+    // Support for forking (see System::fork). Subclasses that support forks
+    // override fork by synchronizing their measures, constructing a copy with
+    // their own fork constructor, and calling forkState on it. The subclass's
+    // fork constructor calls this fork constructor, which copies the objects,
+    // counts, cached occupancy grids, and random number generator state of the
+    // given system, but neither its particles nor its measures, and then
+    // registers the same measures as the subclass's regular constructor.
+    AmoebotSystem(const AmoebotSystem& other);
+
+    // Completes a fork of the given system into this one by copying its
+    // particles (see AmoebotParticle::fork), their tokens, which particles
+    // were activated in the current round, and the histories of its measures,
+    // which must be registered in the same order. Metric histories are shared
+    // copy-on-write. Returns false if a particle or token cannot be copied.
+    bool forkState(const AmoebotSystem& other);
+
+    // Checkpoint hooks for the state of algorithm-specific system subclasses
+    // (beyond particles, objects, and metrics), which serialize writes to the
+    // stream and deserialize reads back in the same order. By default, there
+    // is no such state.
+    virtual void serialize(QDataStream& out) const;
+    virtual void deserialize(QDataStream& in);
+
+    // Inserts the objects and particles of the given configuration into this
+    // system, which must be empty; used by the configuration constructors of
+    // algorithms. newParticle constructs the algorithm's particle with the
+    // given head, global tail direction, and index in the configuration. The
+    // node maps are filled in sorted order, so millions of particles can be
+    // inserted in seconds.
+    void insert(const Configuration& config,
+        std::function<AmoebotParticle*(const Node& head, int globalTailDir, size_t index)> newParticle);
+
     std::vector<AmoebotParticle*> particles;
     std::map<Node, AmoebotParticle*> particleMap;
     std::set<AmoebotParticle*> activatedParticles;
     std::deque<Object*> objects;
     std::map<Node, Object*> objectMap;
+    mutable std::shared_ptr<const OccupancyGrid> objectGrid;
+    mutable std::shared_ptr<const OccupancyGrid> particleGrid;
     std::vector<Count*> _counts;
     std::vector<Measure*> _measures;
+
+private:
+    // Marks the appearance of the particles adjacent to the given node as
+    // changed (see Particle::invalidateRenderAttributes).
+    void invalidateNbrs(const Node& node);
+
+    // Appends the results of finished pending measures to their histories. If
+    // wait is true, waits for all pending measures.
+    void commitMeasures(bool wait);
+
+    // Appends a value to the history of the measure at the given index of
+    // _measures and to the metrics stream, if any.
+    void recordMeasure(size_t index, double value);
+
+    // Returns the positions of the particles, in order, and of the objects.
+    Configuration configuration() const;
+
+    // Write (resp., read) the part of a checkpoint that follows its header.
+    // writeState returns false if the algorithm does not support checkpoints,
+    // and readState returns false if the stream is corrupt or does not match
+    // this system, in which case the system may be partially restored.
+    bool writeState(QDataStream& out) const;
+    bool readState(QDataStream& in);
+
+    bool asyncMeasures;
+    std::deque<std::pair<size_t, QFuture<double>>> pendingMeasures;
+    std::unique_ptr<MetricsWriter> metricsWriter;
+    std::unique_ptr<MoveRecorder> moveRecorder;
+    std::unique_ptr<SnapshotWriter> snapshotWriter;
+    quint64 snapshotInterval;
+    std::unique_ptr<LiveStatePublisher> liveStatePublisher;
+    quint64 publishInterval;
 };
 
 #endif // AMOEBOTSIM_CORE_AMOEBOTSYSTEM_H_
@@ -0,0 +1,251 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/configuration.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include <QFile>
+#include <QTextStream>
+#include <QtEndian>
+
+namespace {
+
+// The magic string differs from those of checkpoints ("AMBC") and snapshot
+// indices ("AMBI"), so neither is mistaken for a configuration.
+const char formatMagic[] = "AMBG";
+const quint32 formatVersion = 1;
+const int headerSize = 24;
+const int particleSize = 9;
+const int objectSize = 9;
+
+// Parses a decimal integer at pos, skipping spaces and tabs before it; returns
+// false if there is none.
+bool parseInt(const char*& pos, long& value)
+{
+    while (*pos == ' ' || *pos == '\t') {
+        ++pos;
+    }
+    char* end;
+    value = std::strtol(pos, &end, 10);
+    if (end == pos) {
+        return false;
+    }
+    pos = end;
+    return true;
+}
+
+// Returns true if only whitespace remains on the line at pos.
+bool atLineEnd(const char* pos)
+{
+    while (*pos == ' ' || *pos == '\t' || *pos == '\r') {
+        ++pos;
+    }
+    return *pos == '\n' || *pos == '\0';
+}
+
+} // namespace
+
+bool Configuration::load(const QString filePath)
+{
+    particles.clear();
+    objects.clear();
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const QByteArray data = file.readAll();
+
+    const bool loaded = (data.size() >= 4 && std::memcmp(data.constData(), formatMagic, 4) == 0)
+        ? loadBinary(data)
+        : loadText(data);
+    if (!loaded || !isValid()) {
+        particles.clear();
+        objects.clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool Configuration::save(const QString filePath) const
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+
+    if (filePath.endsWith(".txt", Qt::CaseInsensitive)) {
+        QTextStream out(&file);
+        out << "# AmoebotSim configuration: p <x> <y> [<globalTailDir>], "
+            << "o <x> <y> [<flags>]\n";
+        for (const auto& o : objects) {
+            out << "o " << o._node.x << ' ' << o._node.y << ' '
+                << ((o._isTraversable ? 1 : 0) | (o._anchor ? 2 : 0)) << '\n';
+        }
+        for (const auto& p : particles) {
+            out << "p " << p.head.x << ' ' << p.head.y;
+            if (p.globalTailDir != -1) {
+                out << ' ' << p.globalTailDir;
+            }
+            out << '\n';
+        }
+        out.flush();
+        return out.status() == QTextStream::Ok;
+    }
+
+    // Encode all records into one buffer, which is written at once.
+    QByteArray data(headerSize + particleSize * static_cast<int>(particles.size())
+            + objectSize * static_cast<int>(objects.size()),
+        '\0');
+    uchar* pos = reinterpret_cast<uchar*>(data.data());
+    std::memcpy(pos, formatMagic, 4);
+    qToLittleEndian<quint32>(formatVersion, pos + 4);
+    qToLittleEndian<quint64>(particles.size(), pos + 8);
+    qToLittleEndian<quint64>(objects.size(), pos + 16);
+    pos += headerSize;
+    for (const auto& p : particles) {
+        qToLittleEndian<qint32>(p.head.x, pos);
+        qToLittleEndian<qint32>(p.head.y, pos + 4);
+        pos[8] = static_cast<uchar>(static_cast<qint8>(p.globalTailDir));
+        pos += particleSize;
+    }
+    for (const auto& o : objects) {
+        qToLittleEndian<qint32>(o._node.x, pos);
+        qToLittleEndian<qint32>(o._node.y, pos + 4);
+        pos[8] = static_cast<uchar>((o._isTraversable ? 1 : 0) | (o._anchor ? 2 : 0));
+        pos += objectSize;
+    }
+
+    return file.write(data) == data.size();
+}
+
+bool Configuration::loadBinary(const QByteArray& data)
+{
+    const uchar* pos = reinterpret_cast<const uchar*>(data.constData());
+    if (data.size() < headerSize || qFromLittleEndian<quint32>(pos + 4) != formatVersion) {
+        return false;
+    }
+    const quint64 numParticles = qFromLittleEndian<quint64>(pos + 8);
+    const quint64 numObjects = qFromLittleEndian<quint64>(pos + 16);
+    const quint64 available = static_cast<quint64>(data.size() - headerSize);
+    if (numParticles > available / particleSize
+        || numObjects > available / objectSize
+        || particleSize * numParticles + objectSize * numObjects != available) {
+        return false;
+    }
+
+    pos += headerSize;
+    particles.reserve(numParticles);
+    for (quint64 i = 0; i < numParticles; ++i, pos += particleSize) {
+        const int dir = static_cast<qint8>(pos[8]);
+        if (dir < -1 || dir > 5) {
+            return false;
+        }
+        particles.push_back({Node(qFromLittleEndian<qint32>(pos),
+                                 qFromLittleEndian<qint32>(pos + 4)),
+            dir});
+    }
+    objects.reserve(numObjects);
+    for (quint64 i = 0; i < numObjects; ++i, pos += objectSize) {
+        objects.push_back(Object(Node(qFromLittleEndian<qint32>(pos),
+                                     qFromLittleEndian<qint32>(pos + 4)),
+            pos[8] & 1, pos[8] & 2));
+    }
+
+    return true;
+}
+
+bool Configuration::loadText(const QByteArray& data)
+{
+    // QByteArray data is always terminated by a null character.
+    const char* pos = data.constData();
+    while (*pos != '\0') {
+        while (*pos == ' ' || *pos == '\t' || *pos == '\r') {
+            ++pos;
+        }
+
+        const char kind = *pos;
+        if (kind == 'p' || kind == 'o') {
+            ++pos;
+            long x, y, extra = (kind == 'p') ? -1 : 0;
+            if (!parseInt(pos, x) || !parseInt(pos, y)) {
+                return false;
+            }
+            if (!atLineEnd(pos) && !parseInt(pos, extra)) {
+                return false;
+            }
+            if (!atLineEnd(pos)) {
+                return false;
+            }
+
+            if (kind == 'p') {
+                if (extra < -1 || extra > 5) {
+                    return false;
+                }
+                particles.push_back({Node(static_cast<int>(x), static_cast<int>(y)),
+                    static_cast<int>(extra)});
+            } else {
+                objects.push_back(Object(Node(static_cast<int>(x), static_cast<int>(y)),
+                    extra & 1, extra & 2));
+            }
+        } else if (kind != '#' && kind != '\n' && kind != '\0') {
+            return false;
+        }
+
+        // Skip to the next line.
+        pos = std::strchr(pos, '\n');
+        if (!pos) {
+            break;
+        }
+        ++pos;
+    }
+
+    return true;
+}
+
+bool Configuration::isValid() const
+{
+    std::vector<Node> particleNodes;
+    particleNodes.reserve(2 * particles.size());
+    for (const auto& p : particles) {
+        particleNodes.push_back(p.head);
+        if (p.globalTailDir != -1) {
+            particleNodes.push_back(p.head.nodeInDir(p.globalTailDir));
+        }
+    }
+    std::sort(particleNodes.begin(), particleNodes.end());
+    if (std::adjacent_find(particleNodes.begin(), particleNodes.end())
+        != particleNodes.end()) {
+        return false;
+    }
+
+    std::vector<const Object*> sortedObjects;
+    sortedObjects.reserve(objects.size());
+    for (const auto& o : objects) {
+        sortedObjects.push_back(&o);
+    }
+    std::sort(sortedObjects.begin(), sortedObjects.end(),
+        [](const Object* a, const Object* b) { return a->_node < b->_node; });
+
+    // Walk both sorted lists together to find overlaps.
+    auto node = particleNodes.begin();
+    for (size_t i = 0; i < sortedObjects.size(); ++i) {
+        const Object& o = *sortedObjects[i];
+        if (i > 0 && sortedObjects[i - 1]->_node == o._node) {
+            return false;
+        }
+        while (node != particleNodes.end() && *node < o._node) {
+            ++node;
+        }
+        if (node != particleNodes.end() && *node == o._node && !o._isTraversable) {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,71 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines an initial configuration, i.e., the positions of the particles and
+// objects of a system, which can be saved to and loaded from a file so that
+// large configurations need not be regenerated by an algorithm's constructor
+// on every instantiation (see AmoebotSystem::saveConfiguration and the
+// configuration constructors of the algorithms).
+//
+// There are two file formats. The binary format stores fixed-size
+// little-endian records, so that millions of them load in a single pass:
+//
+//   header:     "AMBG" (4 bytes), quint32 version (= 1), quint64 #particles,
+//               quint64 #objects.
+//   particles:  qint32 x, qint32 y of the head, and qint8 global direction
+//               from the head to the tail (-1 if contracted).
+//   objects:    qint32 x, qint32 y, and quint8 flags (1 = traversable,
+//               2 = anchor).
+//
+// The text format has one entry per line, where empty lines and lines
+// starting with '#' are ignored:
+//
+//   p <x> <y> [<globalTailDir>]   a particle, contracted if no direction
+//   o <x> <y> [<flags>]           an object, with flags as above (default 0)
+//
+// The order of particles is preserved, since algorithms may treat the first
+// particle specially (e.g., as the seed of Shape Formation).
+
+#ifndef AMOEBOTSIM_CORE_CONFIGURATION_H_
+#define AMOEBOTSIM_CORE_CONFIGURATION_H_
+
+#include <vector>
+
+#include <QByteArray>
+#include <QString>
+
+#include "core/node.h"
+#include "core/object.h"
+
+class Configuration {
+public:
+    struct ParticlePosition {
+        Node head;
+        int globalTailDir;
+    };
+
+    // Loads a configuration from the given file, detecting its format, and
+    // replaces this one with it. Returns false, leaving this configuration
+    // empty, if the file cannot be read or is malformed, or if two particles
+    // or objects overlap or a particle occupies a non-traversable object.
+    bool load(const QString filePath);
+
+    // Saves this configuration to the given file, in the text format if its
+    // name ends with ".txt" and in the binary format otherwise. Returns false
+    // if the file cannot be written.
+    bool save(const QString filePath) const;
+
+    std::vector<ParticlePosition> particles;
+    std::vector<Object> objects;
+
+private:
+    bool loadBinary(const QByteArray& data);
+    bool loadText(const QByteArray& data);
+
+    // Returns true if no two particles or objects overlap and all particles
+    // occupy only nodes without objects or with traversable ones.
+    bool isValid() const;
+};
+
+#endif // AMOEBOTSIM_CORE_CONFIGURATION_H_
@@ -0,0 +1,157 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/livestatepublisher.h"
+
+#include <atomic>
+#include <cstring>
+#include <limits>
+
+#include <QDateTime>
+
+#include "core/system.h"
+
+namespace {
+
+const quint32 formatVersion = 1;
+const quint32 numSlots = 8;
+const quint64 headerSize = 64;
+const quint64 slotHeaderSize = 32;
+
+// Offsets of the header fields that change while publishing.
+const quint64 latestFrameOffset = 40;
+const quint64 statusOffset = 48;
+
+struct ParticleRecord {
+    qint32 x;
+    qint32 y;
+    qint32 color;
+    qint8 globalTailDir;
+    quint8 padding[3];
+};
+static_assert(sizeof(ParticleRecord) == 16, "particle records must be packed");
+
+// Views the aligned field at the given address as an atomic variable, which
+// has the same representation as the plain type.
+template <class T>
+std::atomic<T>& atomicAt(uchar* address)
+{
+    static_assert(sizeof(std::atomic<T>) == sizeof(T), "atomics must be plain");
+    return *reinterpret_cast<std::atomic<T>*>(address);
+}
+
+} // namespace
+
+LiveStatePublisher::LiveStatePublisher(const QString filePath,
+    const System& system, quint64 capacity)
+    : file(filePath)
+    , data(nullptr)
+    , capacity(capacity)
+    , frame(0)
+{
+    const auto& counts = system.getCounts();
+    const auto& measures = system.getMeasures();
+    std::vector<QByteArray> names;
+    quint64 namesSize = 0;
+    for (const auto& c : counts) {
+        names.push_back(c->_name.toUtf8().left(255));
+        namesSize += 2 + names.back().size();
+    }
+    for (const auto& m : measures) {
+        names.push_back(m->_name.toUtf8().left(255));
+        namesSize += 2 + names.back().size();
+    }
+
+    slotsOffset = (headerSize + namesSize + 63) / 64 * 64;
+    slotSize = (slotHeaderSize + 8 * names.size() + sizeof(ParticleRecord) * capacity + 63)
+        / 64 * 64;
+    const qint64 fileSize = static_cast<qint64>(slotsOffset + numSlots * slotSize);
+    if (!file.open(QIODevice::ReadWrite | QIODevice::Truncate) || !file.resize(fileSize)) {
+        return;
+    }
+    data = file.map(0, fileSize);
+    if (!data) {
+        return;
+    }
+
+    std::memset(data, 0, slotsOffset);
+    std::memcpy(data, "AMBL", 4);
+    const quint32 numMetrics = static_cast<quint32>(names.size());
+    std::memcpy(data + 4, &formatVersion, 4);
+    std::memcpy(data + 8, &numSlots, 4);
+    std::memcpy(data + 12, &numMetrics, 4);
+    std::memcpy(data + 16, &capacity, 8);
+    std::memcpy(data + 24, &slotSize, 8);
+    std::memcpy(data + 32, &slotsOffset, 8);
+    uchar* pos = data + headerSize;
+    for (size_t i = 0; i < names.size(); ++i) {
+        *pos++ = (i < counts.size()) ? 0 : 1;
+        *pos++ = static_cast<uchar>(names[i].size());
+        std::memcpy(pos, names[i].constData(), names[i].size());
+        pos += names[i].size();
+    }
+    atomicAt<quint32>(data + statusOffset).store(1, std::memory_order_release);
+}
+
+LiveStatePublisher::~LiveStatePublisher()
+{
+    if (data) {
+        atomicAt<quint32>(data + statusOffset).store(0, std::memory_order_release);
+        file.unmap(data);
+    }
+    file.close();
+}
+
+bool LiveStatePublisher::isOpen() const
+{
+    return data != nullptr;
+}
+
+void LiveStatePublisher::publish(const System& system, quint64 round)
+{
+    if (!data) {
+        return;
+    }
+
+    ++frame;
+    uchar* slot = data + slotsOffset + (frame % numSlots) * slotSize;
+    auto& sequence = atomicAt<quint64>(slot);
+    sequence.store(2 * frame - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const quint64 numParticles = system.size();
+    const qint64 time = QDateTime::currentMSecsSinceEpoch();
+    std::memcpy(slot + 8, &round, 8);
+    std::memcpy(slot + 16, &numParticles, 8);
+    std::memcpy(slot + 24, &time, 8);
+
+    uchar* pos = slot + slotHeaderSize;
+    for (const auto& c : system.getCounts()) {
+        std::memcpy(pos, &c->_value, 8);
+        pos += 8;
+    }
+    for (const auto& m : system.getMeasures()) {
+        const double value = m->_history.empty()
+            ? std::numeric_limits<double>::quiet_NaN()
+            : m->_value;
+        std::memcpy(pos, &value, 8);
+        pos += 8;
+    }
+
+    const quint64 numPublished = qMin(numParticles, capacity);
+    ParticleRecord record;
+    std::memset(&record, 0, sizeof(record));
+    for (quint64 i = 0; i < numPublished; ++i) {
+        const Particle& p = system.at(static_cast<int>(i));
+        record.x = p.head.x;
+        record.y = p.head.y;
+        record.color = system.renderAttributes(p).headMarkColor;
+        record.globalTailDir = static_cast<qint8>(p.globalTailDir);
+        std::memcpy(pos, &record, sizeof(record));
+        pos += sizeof(record);
+    }
+
+    sequence.store(2 * frame, std::memory_order_release);
+    atomicAt<quint64>(data + latestFrameOffset).store(frame, std::memory_order_release);
+}
@@ -0,0 +1,87 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines a publisher that exposes the live state of a system, i.e., the
+// positions and head colors of its particles and the current values of its
+// counts and measures, in a memory-mapped file that analysis processes on the
+// same machine can map and read while the simulation runs. On Linux, a file
+// in /dev/shm is a POSIX shared memory object that never touches the disk.
+// The file is a ring of slots, each holding one published frame; the
+// simulation writes frames into the slots in turn without ever waiting for
+// readers, and readers detect frames that were overwritten while they read
+// them by the sequence numbers of the slots (a seqlock).
+//
+// All numbers are in the native byte order of the machine, and all fields are
+// aligned to their size:
+//
+//   header:     64 bytes: "AMBL" (4 bytes), quint32 version (= 1), quint32
+//               #slots, quint32 #metrics, quint64 particle capacity, quint64
+//               slot size in bytes, quint64 offset of the first slot, quint64
+//               number of the latest complete frame (0 if none), quint32
+//               status (1 = publishing, 0 = stopped), and padding.
+//   metrics:    for each metric, in the order of the values in a slot: quint8
+//               kind (0 = count, 1 = measure), quint8 length of its name,
+//               and its name in UTF-8.
+//   slots:      starting at the given offset, a multiple of 64, each of the
+//               given size: quint64 sequence number, quint64 round, quint64
+//               #particles in the system, qint64 time of publishing in
+//               milliseconds since the epoch, an 8-byte value per metric
+//               (quint64 for counts and double for measures, NaN before its
+//               first value), and 16 bytes per particle (up to the capacity):
+//               qint32 x and qint32 y of its head, qint32 head mark color (-1
+//               if none), qint8 global direction from its head to its tail
+//               (-1 if contracted), and 3 bytes of padding.
+//
+// Frame f (starting at 1) is written to slot f % #slots, whose sequence
+// number is 2f - 1 while it is being written and 2f once it is complete; the
+// header's latest frame number is updated afterwards. To read the latest
+// frame, a reader loads the latest frame number f, loads the sequence number
+// of slot f % #slots with acquire semantics and checks that it is 2f, copies
+// the slot, issues an acquire fence (in C++,
+// std::atomic_thread_fence(std::memory_order_acquire)), and then loads the
+// sequence number again; if it is still 2f, the copy is consistent, and
+// otherwise the reader starts over. The fence is required: an acquire load
+// alone does not keep the copy from being reordered after the second load
+// (see MetricsSummary::read for the same protocol).
+// Systems with more particles than the capacity only publish the first ones.
+
+#ifndef AMOEBOTSIM_CORE_LIVESTATEPUBLISHER_H_
+#define AMOEBOTSIM_CORE_LIVESTATEPUBLISHER_H_
+
+#include <QFile>
+#include <QString>
+#include <QtGlobal>
+
+class System;
+
+class LiveStatePublisher {
+public:
+    // Creates (or truncates) and maps the given file, with slots for the
+    // given number of particles and the counts and measures of the given
+    // system; check isOpen() for success.
+    LiveStatePublisher(const QString filePath, const System& system,
+        quint64 capacity);
+
+    // Marks the file as stopped and unmaps it; the file itself is kept, so
+    // readers can still access the last frames.
+    ~LiveStatePublisher();
+
+    bool isOpen() const;
+
+    // Publishes the next frame, taken at the given round, holding the
+    // particles of the given system, which must have the same counts and
+    // measures as the one the publisher was constructed with, and their
+    // current values. Never waits for readers.
+    void publish(const System& system, quint64 round);
+
+private:
+    QFile file;
+    uchar* data;
+    quint64 capacity;
+    quint64 slotsOffset;
+    quint64 slotSize;
+    quint64 frame;
+};
+
+#endif // AMOEBOTSIM_CORE_LIVESTATEPUBLISHER_H_
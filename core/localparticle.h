@@ -120,7 +120,9 @@ class LocalParticle : public Particle {
   bool pointsAtMyHead(const LocalParticle& nbr, int nbrLabel) const;
   bool pointsAtMyTail(const LocalParticle& nbr, int nbrLabel) const;
 
-  const int orientation;  // Offset from global direction for local compass.
+  // Offset from global direction for local compass. It never changes during a
+  // run; only restoring a checkpoint (see AmoebotSystem) reassigns it.
+  int orientation;
 
  private:
   static const std::vector<int> sixLabels;
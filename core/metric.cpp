@@ -16,6 +16,12 @@ void Count::record(const unsigned int numEvents) {
 
 Measure::Measure(const QString name, const unsigned int freq)
   : _name(name),
-    _freq(freq) {}
+    _freq(freq),
+    _value(0.0) {}
 
 Measure::~Measure() {}
+
+std::function<double()> Measure::capture() const {
+  const double value = calculate();
+  return [value]() { return value; };
+}
@@ -9,10 +9,14 @@
 #define AMOEBOTSIM_CORE_METRIC_H_
 
 #include <deque>
+#include <functional>
 #include <map>
 #include <vector>
 
 #include <QString>
+#include <QtGlobal>
+
+#include "core/metrichistory.h"
 
 class Count {
  public:
@@ -25,10 +29,13 @@ class Count {
 
   // Member variables. The count's name should be human-readable, as it is used
   // to represent this count in the GUI. The value of the count is what is
-  // incremented. History records the count values over time, once per round.
+  // incremented; it is 64-bit, as long runs record billions of events. History
+  // records the count values over time, once per round, subject to its
+  // retention policy (see core/metrichistory.h); to save memory, its values
+  // are kept in 32 bits as long as they fit.
   const QString _name;
-  unsigned int _value;
-  std::vector<int> _history;
+  quint64 _value;
+  MetricHistory<quint64> _history;
 };
 
 class Measure {
@@ -43,13 +50,27 @@ class Measure {
   // This is a pure virtual function and must be overridden by child classes.
   virtual double calculate() const = 0;
 
+  // Captures whatever this measure needs from the current system state and
+  // returns a function that computes the measure from it. When a system
+  // evaluates measures asynchronously, capture is called on the simulation
+  // thread and the returned function on a worker thread, so the function must
+  // not access the system. The default captures the result of calculate();
+  // measures with an expensive calculation can override this to capture a
+  // cheap snapshot (e.g., a shared occupancy grid) and defer the work instead.
+  virtual std::function<double()> capture() const;
+
   // Member variables. The measure's name should be human-readable, as it is
   // used to represent this measure in the GUI. Frequency determines how often
-  // the measure is calculated in terms of # of rounds. History records the
-  // measure values over time, once per round.
+  // the measure is calculated in terms of # of rounds. The value is the most
+  // recently recorded one, exactly (0 until the first is recorded); code that
+  // depends on the current value (e.g., termination conditions) should read
+  // it. History records the measure values over time, once per round, subject
+  // to its retention policy (see core/metrichistory.h); to save memory, its
+  // values are kept in single precision.
   const QString _name;
   const unsigned int _freq;
-  std::vector<double> _history;
+  double _value;
+  MetricHistory<float> _history;
 };
 
 #endif  // AMOEBOTSIM_CORE_METRIC_H_
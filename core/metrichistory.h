@@ -0,0 +1,498 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines the history of a count or measure, i.e., the sequence of values it
+// recorded over time, together with a retention policy that bounds how many
+// entries are kept in memory:
+//
+//   Full:        every value is kept (the default).
+//   Ring:        only the last capacity values are kept.
+//   Downsample:  every stride-th value is kept, starting with the first. The
+//                stride starts at 1 and doubles whenever capacity entries are
+//                kept, after which every second entry is dropped; hence, the
+//                history always spans the whole run at logarithmically
+//                decreasing resolution.
+//   Bucket:      like Downsample, but each entry summarizes the stride
+//                consecutive values starting at its index by their minimum,
+//                maximum, and mean. When capacity buckets are full,
+//                consecutive pairs of buckets are merged.
+//
+// All policies but Full use O(capacity) memory regardless of the number of
+// recorded values, and the most recent value is always available via back().
+// Copies of a history share their entries copy-on-write (see
+// helper/cowvector.h), so forked systems only pay for diverging histories.
+// Histories of 64-bit counts keep their entries in 32 bits until one of them
+// exceeds 32 bits (see HistoryEntries).
+
+#ifndef AMOEBOTSIM_CORE_METRICHISTORY_H_
+#define AMOEBOTSIM_CORE_METRICHISTORY_H_
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include <QDataStream>
+#include <QtGlobal>
+
+#include "helper/cowvector.h"
+
+enum class Retention {
+  Full,
+  Ring,
+  Downsample,
+  Bucket
+};
+
+// Stores the kept entries of a history, copy-on-write. In general, entries are
+// stored as they are.
+template<class T>
+class HistoryEntries {
+ public:
+  size_t size() const;
+  T operator[](size_t i) const;
+  void set(size_t i, T value);
+  void push_back(T value);
+  void resize(size_t n);
+  void clear();
+
+ private:
+  CowVector<T> _entries;
+};
+
+// Counts are 64-bit, but most runs never count 2^32 events, so their entries
+// are stored in 32 bits as long as all of them fit. The first entry that does
+// not fit widens all entries to 64 bits until the history is cleared.
+template<>
+class HistoryEntries<quint64> {
+ public:
+  HistoryEntries();
+
+  size_t size() const;
+  quint64 operator[](size_t i) const;
+  void set(size_t i, quint64 value);
+  void push_back(quint64 value);
+  void resize(size_t n);
+  void clear();
+
+ private:
+  void widenFor(quint64 value);
+
+  bool _wide;
+  CowVector<quint32> _narrowEntries;
+  CowVector<quint64> _wideEntries;
+};
+
+template<class T>
+class MetricHistory {
+ public:
+  // Summarizes consecutive values of a history.
+  struct Bucket {
+    T min;
+    T max;
+    double mean;
+  };
+
+  // Constructs an empty history that keeps every value.
+  MetricHistory();
+
+  // Changes the retention policy. capacity is the maximum number of entries
+  // kept by all policies but Full, which ignores it; Downsample and Bucket
+  // round it up to an even number of at least 2. Existing entries are replayed
+  // into the new policy in order (for buckets, their means).
+  void setRetention(Retention retention, size_t capacity = 0);
+  Retention retention() const;
+
+  // Records the next value.
+  void push_back(T value);
+
+  // Removes all values but keeps the retention policy.
+  void clear();
+
+  // Returns the number of entries kept and whether there are none.
+  size_t size() const;
+  bool empty() const;
+
+  // Returns the entry at the given position, where 0 is the oldest entry kept.
+  // For buckets, this is the mean, and bucket() returns the full summary; for
+  // all other policies, bucket() returns a bucket of the single value.
+  T operator[](size_t i) const;
+  Bucket bucket(size_t i) const;
+
+  // Returns the most recently recorded value; the history must not be empty.
+  T back() const;
+
+  // Returns the index (among all recorded values) of the value at the given
+  // position, or of the first value summarized by the bucket at it.
+  quint64 index(size_t i) const;
+
+  // Returns the position of the first entry whose index is at least the given
+  // one, or size() if there is none; the inverse of index(), e.g., to read
+  // only the entries recorded since a previous read.
+  size_t position(quint64 index) const;
+
+  // Returns the number of recorded values per entry: 1 for Full and Ring, and
+  // the current stride for Downsample and Bucket.
+  quint64 stride() const;
+
+  // Returns the number of values recorded so far, including discarded ones.
+  quint64 numRecorded() const;
+
+  // Returns all entries kept, oldest first.
+  std::vector<T> values() const;
+
+  // Write (resp., read) the complete history, including its retention policy,
+  // to (resp., from) a data stream, e.g., for checkpoints. Reading an invalid
+  // history sets the stream's status to ReadCorruptData.
+  template<class U>
+  friend QDataStream& operator<<(QDataStream& out,
+                                 const MetricHistory<U>& history);
+  template<class U>
+  friend QDataStream& operator>>(QDataStream& in, MetricHistory<U>& history);
+
+ private:
+  void compact();
+
+  Retention _retention;
+  size_t _capacity;
+  quint64 _stride;
+  quint64 _numRecorded;
+  T _last;
+
+  // Kept values for Full, Ring, and Downsample; _head is the position of the
+  // oldest value of a full ring.
+  HistoryEntries<T> _values;
+  size_t _head;
+
+  // Kept buckets for Bucket; the last one may summarize fewer than _stride
+  // values.
+  CowVector<Bucket> _buckets;
+};
+
+template<class T>
+size_t HistoryEntries<T>::size() const {
+  return _entries.size();
+}
+
+template<class T>
+T HistoryEntries<T>::operator[](size_t i) const {
+  return _entries[i];
+}
+
+template<class T>
+void HistoryEntries<T>::set(size_t i, T value) {
+  _entries.mutableAt(i) = value;
+}
+
+template<class T>
+void HistoryEntries<T>::push_back(T value) {
+  _entries.push_back(value);
+}
+
+template<class T>
+void HistoryEntries<T>::resize(size_t n) {
+  _entries.resize(n);
+}
+
+template<class T>
+void HistoryEntries<T>::clear() {
+  _entries.clear();
+}
+
+inline HistoryEntries<quint64>::HistoryEntries()
+  : _wide(false) {}
+
+inline size_t HistoryEntries<quint64>::size() const {
+  return _wide ? _wideEntries.size() : _narrowEntries.size();
+}
+
+inline quint64 HistoryEntries<quint64>::operator[](size_t i) const {
+  return _wide ? _wideEntries[i] : _narrowEntries[i];
+}
+
+inline void HistoryEntries<quint64>::set(size_t i, quint64 value) {
+  widenFor(value);
+  if (_wide) {
+    _wideEntries.mutableAt(i) = value;
+  } else {
+    _narrowEntries.mutableAt(i) = static_cast<quint32>(value);
+  }
+}
+
+inline void HistoryEntries<quint64>::push_back(quint64 value) {
+  widenFor(value);
+  if (_wide) {
+    _wideEntries.push_back(value);
+  } else {
+    _narrowEntries.push_back(static_cast<quint32>(value));
+  }
+}
+
+inline void HistoryEntries<quint64>::resize(size_t n) {
+  if (_wide) {
+    _wideEntries.resize(n);
+  } else {
+    _narrowEntries.resize(n);
+  }
+}
+
+inline void HistoryEntries<quint64>::clear() {
+  _wide = false;
+  _narrowEntries.clear();
+  _wideEntries.clear();
+}
+
+inline void HistoryEntries<quint64>::widenFor(quint64 value) {
+  if (_wide || value <= std::numeric_limits<quint32>::max()) {
+    return;
+  }
+  for (size_t i = 0; i < _narrowEntries.size(); ++i) {
+    _wideEntries.push_back(_narrowEntries[i]);
+  }
+  _narrowEntries.clear();
+  _wide = true;
+}
+
+template<class T>
+MetricHistory<T>::MetricHistory()
+  : _retention(Retention::Full),
+    _capacity(0),
+    _stride(1),
+    _numRecorded(0),
+    _last(),
+    _head(0) {}
+
+template<class T>
+void MetricHistory<T>::setRetention(Retention retention, size_t capacity) {
+  const std::vector<T> kept = values();
+
+  _retention = retention;
+  _capacity = capacity;
+  if (retention == Retention::Ring) {
+    _capacity = std::max<size_t>(capacity, 1);
+  } else if (retention == Retention::Downsample
+             || retention == Retention::Bucket) {
+    _capacity = std::max<size_t>(capacity + capacity % 2, 2);
+  }
+
+  const T last = _last;
+  clear();
+  for (const T value : kept) {
+    push_back(value);
+  }
+  _last = last;
+}
+
+template<class T>
+Retention MetricHistory<T>::retention() const {
+  return _retention;
+}
+
+template<class T>
+void MetricHistory<T>::push_back(T value) {
+  switch (_retention) {
+    case Retention::Full:
+      _values.push_back(value);
+      break;
+    case Retention::Ring:
+      if (_values.size() < _capacity) {
+        _values.push_back(value);
+      } else {
+        _values.set(_head, value);
+        _head = (_head + 1) % _capacity;
+      }
+      break;
+    case Retention::Downsample:
+      if (_numRecorded % _stride == 0 && _values.size() == _capacity) {
+        compact();
+      }
+      if (_numRecorded % _stride == 0) {
+        _values.push_back(value);
+      }
+      break;
+    case Retention::Bucket:
+      if (_numRecorded % _stride == 0 && _buckets.size() == _capacity) {
+        compact();
+      }
+      if (_numRecorded % _stride == 0) {
+        _buckets.push_back({value, value, static_cast<double>(value)});
+      } else {
+        Bucket& bucket = _buckets.mutableBack();
+        const quint64 count = _numRecorded % _stride + 1;
+        bucket.min = std::min(bucket.min, value);
+        bucket.max = std::max(bucket.max, value);
+        bucket.mean += (static_cast<double>(value) - bucket.mean) / count;
+      }
+      break;
+  }
+
+  _last = value;
+  ++_numRecorded;
+}
+
+template<class T>
+void MetricHistory<T>::clear() {
+  _stride = 1;
+  _numRecorded = 0;
+  _last = T();
+  _values.clear();
+  _head = 0;
+  _buckets.clear();
+}
+
+template<class T>
+size_t MetricHistory<T>::size() const {
+  return (_retention == Retention::Bucket) ? _buckets.size() : _values.size();
+}
+
+template<class T>
+bool MetricHistory<T>::empty() const {
+  return _numRecorded == 0;
+}
+
+template<class T>
+T MetricHistory<T>::operator[](size_t i) const {
+  Q_ASSERT(i < size());
+  if (_retention == Retention::Bucket) {
+    return static_cast<T>(_buckets[i].mean);
+  } else if (_retention == Retention::Ring) {
+    return _values[(_head + i) % _values.size()];
+  }
+  return _values[i];
+}
+
+template<class T>
+typename MetricHistory<T>::Bucket MetricHistory<T>::bucket(size_t i) const {
+  if (_retention == Retention::Bucket) {
+    Q_ASSERT(i < _buckets.size());
+    return _buckets[i];
+  }
+  const T value = (*this)[i];
+  return {value, value, static_cast<double>(value)};
+}
+
+template<class T>
+T MetricHistory<T>::back() const {
+  Q_ASSERT(!empty());
+  return _last;
+}
+
+template<class T>
+quint64 MetricHistory<T>::index(size_t i) const {
+  if (_retention == Retention::Ring) {
+    return _numRecorded - _values.size() + i;
+  }
+  return i * _stride;
+}
+
+template<class T>
+size_t MetricHistory<T>::position(quint64 index) const {
+  if (_retention == Retention::Ring) {
+    const quint64 first = _numRecorded - _values.size();
+    return (index <= first) ? 0 : std::min<quint64>(index - first, size());
+  }
+  return std::min<quint64>((index + _stride - 1) / _stride, size());
+}
+
+template<class T>
+quint64 MetricHistory<T>::stride() const {
+  return _stride;
+}
+
+template<class T>
+quint64 MetricHistory<T>::numRecorded() const {
+  return _numRecorded;
+}
+
+template<class T>
+std::vector<T> MetricHistory<T>::values() const {
+  std::vector<T> result;
+  result.reserve(size());
+  for (size_t i = 0; i < size(); ++i) {
+    result.push_back((*this)[i]);
+  }
+  return result;
+}
+
+template<class T>
+void MetricHistory<T>::compact() {
+  // Every kept entry covers _stride values, so merging pairs halves the number
+  // of entries and doubles the stride. The capacity is even, so no entry is
+  // left unpaired.
+  if (_retention == Retention::Downsample) {
+    for (size_t i = 0; 2 * i < _values.size(); ++i) {
+      _values.set(i, _values[2 * i]);
+    }
+    _values.resize(_values.size() / 2);
+  } else {
+    for (size_t i = 0; 2 * i + 1 < _buckets.size(); ++i) {
+      const Bucket a = _buckets[2 * i];
+      const Bucket b = _buckets[2 * i + 1];
+      _buckets.mutableAt(i) = {std::min(a.min, b.min), std::max(a.max, b.max),
+                               (a.mean + b.mean) / 2};
+    }
+    _buckets.resize(_buckets.size() / 2);
+  }
+  _stride *= 2;
+}
+
+template<class T>
+QDataStream& operator<<(QDataStream& out, const MetricHistory<T>& history) {
+  out << static_cast<quint8>(history._retention)
+      << static_cast<quint64>(history._capacity) << history._stride
+      << history._numRecorded << history._last
+      << static_cast<quint64>(history._head);
+  out << static_cast<quint64>(history._values.size());
+  for (size_t i = 0; i < history._values.size(); ++i) {
+    out << history._values[i];
+  }
+  out << static_cast<quint64>(history._buckets.size());
+  for (size_t i = 0; i < history._buckets.size(); ++i) {
+    const auto& bucket = history._buckets[i];
+    out << bucket.min << bucket.max << bucket.mean;
+  }
+
+  return out;
+}
+
+template<class T>
+QDataStream& operator>>(QDataStream& in, MetricHistory<T>& history) {
+  quint8 retention;
+  quint64 capacity, head, numValues, numBuckets;
+  MetricHistory<T> result;
+  in >> retention >> capacity >> result._stride >> result._numRecorded
+     >> result._last >> head >> numValues;
+  if (in.status() != QDataStream::Ok
+      || retention > static_cast<quint8>(Retention::Bucket)
+      || numValues > result._numRecorded || head > numValues) {
+    in.setStatus(QDataStream::ReadCorruptData);
+    return in;
+  }
+  result._retention = static_cast<Retention>(retention);
+  result._capacity = capacity;
+  result._head = head;
+  // Entries are appended as they are read, so a corrupt size cannot make us
+  // allocate more than the stream holds.
+  for (quint64 i = 0; i < numValues && in.status() == QDataStream::Ok; ++i) {
+    T value;
+    in >> value;
+    result._values.push_back(value);
+  }
+  in >> numBuckets;
+  if (in.status() != QDataStream::Ok || numBuckets > result._numRecorded) {
+    in.setStatus(QDataStream::ReadCorruptData);
+    return in;
+  }
+  for (quint64 i = 0; i < numBuckets && in.status() == QDataStream::Ok; ++i) {
+    typename MetricHistory<T>::Bucket bucket;
+    in >> bucket.min >> bucket.max >> bucket.mean;
+    result._buckets.push_back(bucket);
+  }
+
+  if (in.status() == QDataStream::Ok) {
+    history = result;
+  }
+  return in;
+}
+
+#endif  // AMOEBOTSIM_CORE_METRICHISTORY_H_
@@ -0,0 +1,110 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/metricssummary.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QThread>
+
+#include "core/system.h"
+
+constexpr int MetricsSummary::maxMetrics;
+
+MetricsSummary::MetricsSummary()
+    : layout(std::make_shared<const Layout>(Layout{0, QStringList()}))
+    , sequence(0)
+    , layoutNumber(0)
+    , numValues(0)
+{
+    for (auto& value : values) {
+        value.store(0, std::memory_order_relaxed);
+    }
+}
+
+void MetricsSummary::publish(const System& system)
+{
+    const auto& counts = system.getCounts();
+    const auto& measures = system.getMeasures();
+    QStringList names;
+    for (const auto& c : counts) {
+        names.append(c->_name);
+    }
+    for (const auto& m : measures) {
+        names.append(m->_name);
+    }
+    while (names.size() > maxMetrics) {
+        names.removeLast();
+    }
+
+    // A new layout is published before the values that belong to it.
+    quint64 number = layoutNumber.load(std::memory_order_relaxed);
+    if (names != publishedNames) {
+        publishedNames = names;
+        ++number;
+        std::atomic_store(&layout,
+            std::make_shared<const Layout>(Layout{number, names}));
+    }
+
+    const quint64 start = sequence.load(std::memory_order_relaxed);
+    sequence.store(start + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    layoutNumber.store(number, std::memory_order_relaxed);
+    numValues.store(names.size(), std::memory_order_relaxed);
+    int i = 0;
+    auto store = [this, &i](double value) {
+        if (i < maxMetrics) {
+            quint64 bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            values[i++].store(bits, std::memory_order_relaxed);
+        }
+    };
+    for (const auto& c : counts) {
+        store(static_cast<double>(c->_value));
+    }
+    for (const auto& m : measures) {
+        store(m->_value);
+    }
+
+    sequence.store(start + 2, std::memory_order_release);
+}
+
+bool MetricsSummary::read(quint64& sequence, QStringList& names,
+    std::vector<double>& values) const
+{
+    while (true) {
+        const quint64 before = this->sequence.load(std::memory_order_acquire);
+        if (before == sequence) {
+            return false;
+        } else if (before % 2 == 1) {
+            QThread::yieldCurrentThread();
+            continue;
+        }
+
+        const quint64 number = layoutNumber.load(std::memory_order_relaxed);
+        const int count = std::min(numValues.load(std::memory_order_relaxed),
+            maxMetrics);
+        values.resize(count);
+        for (int i = 0; i < count; ++i) {
+            const quint64 bits = this->values[i].load(std::memory_order_relaxed);
+            std::memcpy(&values[i], &bits, sizeof(bits));
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (this->sequence.load(std::memory_order_relaxed) != before) {
+            continue;
+        }
+
+        // The layout was published before the values, but a newer one may
+        // have been published since; the values of that are read next time.
+        const std::shared_ptr<const Layout> current = std::atomic_load(&layout);
+        if (current->number != number || current->names.size() != count) {
+            continue;
+        }
+        names = current->names;
+        sequence = before;
+        return true;
+    }
+}
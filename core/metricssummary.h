@@ -0,0 +1,67 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines a summary of the current values of a system's counts and measures
+// that one thread publishes and any other thread reads without locking, so the
+// GUI can show the metrics without contending with the simulation for the
+// system's mutex (see Simulator::metrics). The values are guarded by a
+// seqlock: the writer makes the sequence number odd, stores the values, and
+// makes it even again, and a reader copies the values between two loads of
+// the same even sequence number, starting over if they differ. The names of
+// the metrics only change with the set of metrics (e.g., when the simulator's
+// system is replaced); they are published as an immutable list that readers
+// share, numbered so that readers can tell which values belong to it. At most
+// maxMetrics metrics are summarized.
+
+#ifndef AMOEBOTSIM_CORE_METRICSSUMMARY_H_
+#define AMOEBOTSIM_CORE_METRICSSUMMARY_H_
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <QStringList>
+#include <QtGlobal>
+
+class System;
+
+class MetricsSummary {
+public:
+    static constexpr int maxMetrics = 64;
+
+    // Constructs an empty summary, whose sequence number is 0.
+    MetricsSummary();
+
+    // Publishes the current values of the counts and measures of the given
+    // system, which must be locked: the value of each count and the latest
+    // value of each measure (0 if it has none). Only one thread may publish.
+    void publish(const System& system);
+
+    // Copies the names and values of the latest published summary unless its
+    // sequence number is the given one, in which case it returns false;
+    // otherwise, it sets sequence to the number of the copied summary and
+    // returns true. Never locks; it only retries reads that overlapped with
+    // publishing.
+    bool read(quint64& sequence, QStringList& names,
+        std::vector<double>& values) const;
+
+private:
+    struct Layout {
+        quint64 number;
+        QStringList names;
+    };
+
+    // Shared with readers, who access layout with std::atomic_load.
+    std::shared_ptr<const Layout> layout;
+    std::atomic<quint64> sequence;
+    std::atomic<quint64> layoutNumber;
+    std::atomic<int> numValues;
+    std::array<std::atomic<quint64>, maxMetrics> values;
+
+    // Only accessed by the publishing thread.
+    QStringList publishedNames;
+};
+
+#endif // AMOEBOTSIM_CORE_METRICSSUMMARY_H_
@@ -0,0 +1,331 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/metricswriter.h"
+
+#include <cstring>
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QMutexLocker>
+#include <QTextStream>
+#include <QThread>
+
+namespace {
+
+const quint32 formatVersion = 1;
+
+// The number of values per block, and the number of full blocks that may wait
+// for the flush thread before appending blocks.
+const size_t valuesPerBlock = 4096;
+const size_t maxQueuedBlocks = 64;
+
+struct MetricInfo {
+    quint8 kind;
+    quint32 freq;
+    QByteArray name;
+};
+
+bool readHeader(QDataStream& in, std::vector<MetricInfo>& metrics)
+{
+    char magic[4];
+    if (in.readRawData(magic, 4) != 4 || std::memcmp(magic, "AMBM", 4) != 0) {
+        return false;
+    }
+
+    quint32 version, numMetrics;
+    in >> version >> numMetrics;
+    if (version != formatVersion) {
+        return false;
+    }
+    for (quint32 i = 0; i < numMetrics && in.status() == QDataStream::Ok; ++i) {
+        MetricInfo metric;
+        in >> metric.kind >> metric.freq >> metric.name;
+        metrics.push_back(metric);
+    }
+
+    return in.status() == QDataStream::Ok;
+}
+
+QString formatValue(const MetricInfo& metric, quint64 bits)
+{
+    if (metric.kind == 0) {
+        return QString::number(bits);
+    }
+
+    // 17 significant digits round-trip every double exactly.
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return QString::number(value, 'g', 17);
+}
+
+// Writes the values of all blocks of the given metric, separated by ", ",
+// skipping the blocks of all other metrics.
+void writeHistory(QFile& file, qint64 dataStart, quint32 metric,
+    const MetricInfo& info, QTextStream& out)
+{
+    file.seek(dataStart);
+    QDataStream in(&file);
+    in.setByteOrder(QDataStream::LittleEndian);
+
+    bool first = true;
+    quint32 blockMetric, numValues;
+    while (!in.atEnd()) {
+        in >> blockMetric >> numValues;
+        if (in.status() != QDataStream::Ok) {
+            return;
+        }
+        if (blockMetric != metric) {
+            in.skipRawData(8 * numValues);
+            continue;
+        }
+        for (quint32 i = 0; i < numValues; ++i) {
+            quint64 bits;
+            in >> bits;
+            out << (first ? "" : ", ") << formatValue(info, bits);
+            first = false;
+        }
+    }
+}
+
+bool renderCSV(QFile& file, qint64 dataStart,
+    const std::vector<MetricInfo>& metrics, QTextStream& out)
+{
+    file.seek(dataStart);
+    QDataStream in(&file);
+    in.setByteOrder(QDataStream::LittleEndian);
+
+    std::vector<quint64> indices(metrics.size(), 0);
+    out << "name,index,value\n";
+    quint32 metric, numValues;
+    while (!in.atEnd()) {
+        in >> metric >> numValues;
+        if (in.status() != QDataStream::Ok || metric >= metrics.size()) {
+            return false;
+        }
+        const MetricInfo& info = metrics[metric];
+        const QString name = "\"" + QString::fromUtf8(info.name) + "\",";
+        for (quint32 i = 0; i < numValues; ++i) {
+            quint64 bits;
+            in >> bits;
+            out << name << indices[metric]++ << ',' << formatValue(info, bits) << '\n';
+        }
+    }
+
+    return in.status() == QDataStream::Ok;
+}
+
+bool renderJSON(QFile& file, qint64 dataStart,
+    const std::vector<MetricInfo>& metrics, QTextStream& out)
+{
+    out << "{\"title\" : \"AmoebotSim Metrics JSON\", ";
+    out << "\"datetime\" : \"" << QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss") << "\", ";
+    out << "\"algorithm\" : \"???\", ";
+    for (quint8 kind = 0; kind <= 1; ++kind) {
+        out << ((kind == 0) ? "\"counts\" : [" : "], \"measures\" : [");
+        bool first = true;
+        for (quint32 metric = 0; metric < metrics.size(); ++metric) {
+            const MetricInfo& info = metrics[metric];
+            if (info.kind != kind) {
+                continue;
+            }
+            out << (first ? "" : ", ") << "{\"name\" : \"" << QString::fromUtf8(info.name) << "\", ";
+            if (kind == 1) {
+                out << "\"frequency\" : " << info.freq << ", ";
+            }
+            out << "\"history\" : [";
+            writeHistory(file, dataStart, metric, info, out);
+            out << "]}";
+            first = false;
+        }
+    }
+    out << "]}";
+
+    return true;
+}
+
+} // namespace
+
+class MetricsWriter::FlushThread : public QThread {
+public:
+    explicit FlushThread(MetricsWriter& writer)
+        : writer(writer)
+    {
+    }
+
+protected:
+    void run() override
+    {
+        writer.writeBlocks();
+    }
+
+private:
+    MetricsWriter& writer;
+};
+
+MetricsWriter::MetricsWriter(const QString filePath,
+    const std::vector<Count*>& counts, const std::vector<Measure*>& measures)
+    : file(filePath)
+    , numCounts(static_cast<int>(counts.size()))
+    , openBlocks(counts.size() + measures.size())
+    , writing(false)
+    , stopping(false)
+{
+    for (size_t i = 0; i < openBlocks.size(); ++i) {
+        openBlocks[i].metric = static_cast<quint32>(i);
+        openBlocks[i].values.reserve(valuesPerBlock);
+    }
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out.writeRawData("AMBM", 4);
+    out << formatVersion << static_cast<quint32>(openBlocks.size());
+    for (const auto& c : counts) {
+        out << quint8(0) << quint32(1) << c->_name.toUtf8();
+    }
+    for (const auto& m : measures) {
+        out << quint8(1) << quint32(m->_freq) << m->_name.toUtf8();
+    }
+
+    thread.reset(new FlushThread(*this));
+    thread->start();
+}
+
+MetricsWriter::~MetricsWriter()
+{
+    if (thread) {
+        flush();
+        mutex.lock();
+        stopping = true;
+        queueNotEmpty.wakeAll();
+        mutex.unlock();
+        thread->wait();
+    }
+    file.close();
+}
+
+bool MetricsWriter::isOpen() const
+{
+    return thread != nullptr;
+}
+
+void MetricsWriter::appendCount(int count, quint64 value)
+{
+    Q_ASSERT(0 <= count && count < numCounts);
+    append(static_cast<quint32>(count), value);
+}
+
+void MetricsWriter::appendMeasure(int measure, double value)
+{
+    Q_ASSERT(0 <= measure && numCounts + measure < static_cast<int>(openBlocks.size()));
+
+    quint64 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    append(static_cast<quint32>(numCounts + measure), bits);
+}
+
+void MetricsWriter::flush()
+{
+    for (auto& block : openBlocks) {
+        if (!block.values.empty()) {
+            enqueue(block);
+        }
+    }
+
+    QMutexLocker locker(&mutex);
+    while (!queue.empty() || writing) {
+        queueDrained.wait(&mutex);
+    }
+    file.flush();
+}
+
+bool MetricsWriter::render(const QString binaryPath, const QString outPath)
+{
+    const bool csv = outPath.endsWith(".csv");
+    if (!csv && !outPath.endsWith(".json")) {
+        return false;
+    }
+
+    QFile inFile(binaryPath);
+    if (!inFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QDataStream in(&inFile);
+    in.setByteOrder(QDataStream::LittleEndian);
+    std::vector<MetricInfo> metrics;
+    if (!readHeader(in, metrics)) {
+        return false;
+    }
+    const qint64 dataStart = inFile.pos();
+
+    QFile outFile(outPath);
+    if (!outFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return false;
+    }
+    QTextStream out(&outFile);
+
+    return csv ? renderCSV(inFile, dataStart, metrics, out)
+               : renderJSON(inFile, dataStart, metrics, out);
+}
+
+void MetricsWriter::append(quint32 metric, quint64 bits)
+{
+    Block& block = openBlocks[metric];
+    block.values.push_back(bits);
+    if (block.values.size() >= valuesPerBlock) {
+        enqueue(block);
+    }
+}
+
+void MetricsWriter::enqueue(Block& block)
+{
+    QMutexLocker locker(&mutex);
+    while (queue.size() >= maxQueuedBlocks) {
+        queueNotFull.wait(&mutex);
+    }
+    queue.push_back(Block());
+    queue.back().metric = block.metric;
+    queue.back().values.swap(block.values);
+    block.values.reserve(valuesPerBlock);
+    queueNotEmpty.wakeOne();
+}
+
+void MetricsWriter::writeBlocks()
+{
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::LittleEndian);
+
+    QMutexLocker locker(&mutex);
+    while (true) {
+        while (queue.empty() && !stopping) {
+            queueNotEmpty.wait(&mutex);
+        }
+        if (queue.empty()) {
+            break;
+        }
+
+        Block block;
+        block.metric = queue.front().metric;
+        block.values.swap(queue.front().values);
+        queue.pop_front();
+        writing = true;
+        queueNotFull.wakeAll();
+
+        locker.unlock();
+        out << block.metric << static_cast<quint32>(block.values.size());
+        for (const quint64 bits : block.values) {
+            out << bits;
+        }
+        locker.relock();
+
+        writing = false;
+        if (queue.empty()) {
+            queueDrained.wakeAll();
+        }
+    }
+}
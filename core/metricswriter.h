@@ -0,0 +1,96 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines a sink that streams count and measure values to disk as the
+// simulation produces them, so long runs need not keep (or later format) their
+// whole metrics history in memory. Values are collected per metric into blocks
+// which are handed to a background thread that writes them to the file; if the
+// disk falls behind by more than a fixed number of blocks, appending values
+// waits for the thread to catch up.
+//
+// The file is a binary columnar format. All numbers are little-endian, as
+// written by a QDataStream:
+//
+//   header:  "AMBM" (4 bytes), quint32 version (= 1), quint32 #metrics, then
+//            for each metric: quint8 kind (0 = count, 1 = measure), quint32
+//            frequency (1 for counts), and its name as a UTF-8 QByteArray.
+//   blocks:  until the end of the file: quint32 metric index, quint32 #values,
+//            followed by that many 8-byte values; counts as quint64, measures
+//            as the IEEE 754 bits of a double, also stored as a quint64.
+//
+// The blocks of each metric appear in the order of its values; blocks of
+// different metrics are interleaved. render() converts such a file to CSV (one
+// "name,index,value" line per value) or to the JSON structure produced by
+// AmoebotSystem::metricsAsJSON, streaming in both cases.
+
+#ifndef AMOEBOTSIM_CORE_METRICSWRITER_H_
+#define AMOEBOTSIM_CORE_METRICSWRITER_H_
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <QWaitCondition>
+#include <QtGlobal>
+
+#include "core/metric.h"
+
+class MetricsWriter {
+public:
+    // Opens the given file and writes the header for the given counts and
+    // measures; check isOpen() for success. Values of count i (resp., measure
+    // j) are then streamed by appendCount(i, ...) (resp., appendMeasure(j,
+    // ...)), where indices refer to the given lists.
+    MetricsWriter(const QString filePath, const std::vector<Count*>& counts,
+        const std::vector<Measure*>& measures);
+
+    // Writes all remaining values and closes the file.
+    ~MetricsWriter();
+
+    bool isOpen() const;
+
+    // Append the next value of a count or measure. These are meant to be
+    // called from a single (the simulation) thread.
+    void appendCount(int count, quint64 value);
+    void appendMeasure(int measure, double value);
+
+    // Writes all values appended so far to the file and waits until they are
+    // on disk.
+    void flush();
+
+    // Converts a metrics file written by a MetricsWriter to CSV or JSON,
+    // depending on whether outPath ends in ".csv" or ".json". Returns false
+    // if either file cannot be opened or the input is not a metrics file.
+    static bool render(const QString binaryPath, const QString outPath);
+
+private:
+    struct Block {
+        quint32 metric;
+        std::vector<quint64> values;
+    };
+
+    class FlushThread;
+
+    void append(quint32 metric, quint64 bits);
+    void enqueue(Block& block);
+    void writeBlocks();
+
+    QFile file;
+    const int numCounts;
+    std::vector<Block> openBlocks;
+
+    QMutex mutex;
+    QWaitCondition queueNotEmpty;
+    QWaitCondition queueNotFull;
+    QWaitCondition queueDrained;
+    std::deque<Block> queue;
+    bool writing;
+    bool stopping;
+    std::unique_ptr<FlushThread> thread;
+};
+
+#endif // AMOEBOTSIM_CORE_METRICSWRITER_H_
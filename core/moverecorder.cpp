@@ -0,0 +1,317 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/moverecorder.h"
+
+#include <cstring>
+
+#include <QDataStream>
+#include <QTextStream>
+#include <QtEndian>
+
+#include "core/amoebotparticle.h"
+
+namespace {
+
+const quint32 formatVersion = 2;
+const qint64 headerSize = 8;
+
+// The size of the mapped window, and the maximum size of an encoded event
+// (a 64-bit varint, a tag, and up to four 32-bit varints) rounded up.
+const qint64 windowSize = 4 << 20;
+const qint64 maxEventSize = 48;
+
+const char* const opNames[] = {"expand", "contractHead", "contractTail", "push",
+    "pull", "state", "insert", "object", "clear"};
+
+} // namespace
+
+MoveRecorder::MoveRecorder(const QString filePath, const Count& activations)
+    : file(filePath)
+    , activations(activations)
+    , nextId(0)
+    , window(nullptr)
+    , windowStart(headerSize)
+    , windowPos(0)
+    , lastActivation(0)
+    , lastParticle(0)
+{
+    if (!file.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out.writeRawData("AMBV", 4);
+    out << formatVersion;
+    if (out.status() == QDataStream::Ok) {
+        remap();
+    }
+}
+
+MoveRecorder::~MoveRecorder()
+{
+    if (window) {
+        file.unmap(window);
+    }
+    if (file.isOpen()) {
+        file.resize(windowStart + windowPos);
+        file.close();
+    }
+}
+
+bool MoveRecorder::isOpen() const
+{
+    return window != nullptr;
+}
+
+void MoveRecorder::addParticle(const AmoebotParticle* particle)
+{
+    ids[particle] = nextId;
+    if (beginEvent(nextId, Op::Insert, particle->globalTailDir)) {
+        putSignedVarint(particle->head.x);
+        putSignedVarint(particle->head.y);
+    }
+    ++nextId;
+}
+
+void MoveRecorder::addObject(const Object& object)
+{
+    if (beginEvent(lastParticle, Op::Object, -1)) {
+        putVarint((object._isTraversable ? 1 : 0) | (object._anchor ? 2 : 0));
+        putSignedVarint(object._node.x);
+        putSignedVarint(object._node.y);
+    }
+}
+
+void MoveRecorder::removeParticles(bool removeObjects)
+{
+    ids.clear();
+    if (beginEvent(lastParticle, Op::Clear, -1)) {
+        putVarint(removeObjects ? 1 : 0);
+    }
+}
+
+void MoveRecorder::record(const AmoebotParticle* particle, Op op, int dir,
+    quint32 state)
+{
+    auto it = ids.find(particle);
+    Q_ASSERT(it != ids.end());
+    if (beginEvent(it->second, op, dir) && op == Op::StateChange) {
+        putVarint(state);
+    }
+}
+
+void MoveRecorder::recordHandover(const AmoebotParticle* particle,
+    const AmoebotParticle* neighbor, Op op, int dir)
+{
+    Q_ASSERT(op == Op::Push || op == Op::Pull);
+    auto it = ids.find(particle);
+    auto nbrIt = ids.find(neighbor);
+    Q_ASSERT(it != ids.end() && nbrIt != ids.end());
+    if (beginEvent(it->second, op, dir)) {
+        putSignedVarint(static_cast<qint64>(nbrIt->second) - it->second);
+    }
+}
+
+bool MoveRecorder::render(const QString binaryPath, const QString outPath)
+{
+    MoveLogReader reader(binaryPath);
+    if (!reader.isOpen()) {
+        return false;
+    }
+
+    QFile outFile(outPath);
+    if (!outFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return false;
+    }
+    QTextStream out(&outFile);
+
+    out << "activation,particle,op,direction,neighbor,state,x,y\n";
+    MoveRecorder::Event event;
+    while (reader.next(event)) {
+        const bool hasParticle = event.op != Op::Object && event.op != Op::Clear;
+        const bool hasNeighbor = event.op == Op::Push || event.op == Op::Pull;
+        const bool hasState = event.op == Op::StateChange
+            || event.op == Op::Object || event.op == Op::Clear;
+        const bool hasNode = event.op == Op::Insert || event.op == Op::Object;
+        out << event.activation << ',';
+        if (hasParticle) {
+            out << event.particle;
+        }
+        out << ',' << opNames[static_cast<int>(event.op)] << ',';
+        if (event.dir >= 0) {
+            out << event.dir;
+        }
+        out << ',';
+        if (hasNeighbor) {
+            out << event.neighbor;
+        }
+        out << ',';
+        if (hasState) {
+            out << event.state;
+        }
+        out << ',';
+        if (hasNode) {
+            out << event.node.x << ',' << event.node.y;
+        } else {
+            out << ',';
+        }
+        out << '\n';
+    }
+
+    return reader.atEnd();
+}
+
+bool MoveRecorder::beginEvent(quint32 particle, Op op, int dir)
+{
+    if (!window || (windowSize - windowPos < maxEventSize && !remap())) {
+        return false;
+    }
+
+    const quint64 activation = activations._value;
+    putVarint(activation - lastActivation);
+    putSignedVarint(static_cast<qint64>(particle) - lastParticle);
+    window[windowPos++] = static_cast<uchar>((static_cast<int>(op) << 4) | (dir + 1));
+    lastActivation = activation;
+    lastParticle = particle;
+
+    return true;
+}
+
+bool MoveRecorder::remap()
+{
+    if (window) {
+        file.unmap(window);
+        windowStart += windowPos;
+    }
+    windowPos = 0;
+    window = file.resize(windowStart + windowSize)
+        ? file.map(windowStart, windowSize)
+        : nullptr;
+
+    return window != nullptr;
+}
+
+void MoveRecorder::putVarint(quint64 value)
+{
+    while (value >= 0x80) {
+        window[windowPos++] = static_cast<uchar>(value | 0x80);
+        value >>= 7;
+    }
+    window[windowPos++] = static_cast<uchar>(value);
+}
+
+void MoveRecorder::putSignedVarint(qint64 value)
+{
+    putVarint((value >= 0) ? 2 * static_cast<quint64>(value)
+                           : 2 * static_cast<quint64>(-(value + 1)) + 1);
+}
+
+MoveLogReader::MoveLogReader(const QString filePath)
+    : file(filePath)
+    , data(nullptr)
+    , size(0)
+    , pos(headerSize)
+{
+    if (!file.open(QIODevice::ReadOnly) || file.size() < headerSize) {
+        return;
+    }
+    const uchar* mapped = file.map(0, file.size());
+    if (mapped && std::memcmp(mapped, "AMBV", 4) == 0
+        && qFromLittleEndian<quint32>(mapped + 4) == formatVersion) {
+        data = mapped;
+        size = file.size();
+    }
+}
+
+bool MoveLogReader::isOpen() const
+{
+    return data != nullptr;
+}
+
+bool MoveLogReader::next(MoveRecorder::Event& event)
+{
+    typedef MoveRecorder::Op Op;
+
+    const qint64 start = pos;
+    quint64 activationDelta, state = 0;
+    qint64 particleDelta, neighborDelta = 0, x = 0, y = 0;
+    if (pos >= size || !getVarint(activationDelta)
+        || !getSignedVarint(particleDelta) || pos >= size) {
+        pos = start;
+        return false;
+    }
+    const uchar tag = data[pos++];
+    if (tag == 0) {
+        // Expansions always have a direction, so this is the zero padding of a
+        // log that was not closed.
+        pos = size;
+        return false;
+    }
+    const Op op = static_cast<Op>(tag >> 4);
+    const int dir = (tag & 0xf) - 1;
+    bool valid = op <= Op::Clear && dir < 6;
+    if (valid && (op == Op::Push || op == Op::Pull)) {
+        valid = getSignedVarint(neighborDelta);
+    }
+    if (valid && (op == Op::StateChange || op == Op::Object || op == Op::Clear)) {
+        valid = getVarint(state);
+    }
+    if (valid && (op == Op::Insert || op == Op::Object)) {
+        valid = getSignedVarint(x) && getSignedVarint(y);
+    }
+    if (!valid) {
+        pos = start;
+        return false;
+    }
+
+    event.activation += activationDelta;
+    event.particle += static_cast<quint32>(particleDelta);
+    event.op = op;
+    event.dir = dir;
+    event.neighbor = event.particle + static_cast<quint32>(neighborDelta);
+    event.state = static_cast<quint32>(state);
+    event.node = Node(static_cast<int>(x), static_cast<int>(y));
+    return true;
+}
+
+bool MoveLogReader::atEnd() const
+{
+    return pos >= size;
+}
+
+qint64 MoveLogReader::position() const
+{
+    return pos;
+}
+
+void MoveLogReader::setPosition(qint64 pos)
+{
+    this->pos = pos;
+}
+
+bool MoveLogReader::getVarint(quint64& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < size; shift += 7) {
+        const uchar byte = data[pos++];
+        value |= static_cast<quint64>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MoveLogReader::getSignedVarint(qint64& value)
+{
+    quint64 zigzag;
+    if (!getVarint(zigzag)) {
+        return false;
+    }
+    value = (zigzag & 1) ? -static_cast<qint64>(zigzag >> 1) - 1
+                         : static_cast<qint64>(zigzag >> 1);
+    return true;
+}
@@ -0,0 +1,181 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines a recorder that logs every movement of the particles of a system,
+// as well as algorithm-defined state changes, as a compact stream of events,
+// so trajectories can be analyzed (see MoveLogReader) or replayed (see
+// core/replaysystem.h) offline without re-running the simulation. Events are
+// encoded directly into a memory-mapped window of the file, which is moved
+// further along the file whenever it is full, so recording an event costs a
+// few byte stores and no system call.
+//
+// All fixed-size numbers are little-endian. Varints store 7 bits per byte,
+// least significant group first, with the high bit set on all but the last
+// byte; signed varints are zigzag-encoded first (2d for d >= 0 and -2d - 1
+// otherwise).
+//
+//   header:  "AMBV" (4 bytes), quint32 version (= 2).
+//   events:  until the end of the file: the activation index minus that of
+//            the previous event (or 0) as a varint; the particle id minus that
+//            of the previous event (or 0) as a signed varint; and a tag byte
+//            whose high nibble is the operation (see Op) and whose low nibble
+//            is the global direction plus 1, i.e., 0 for none. Some operations
+//            are followed by more fields:
+//              Push, Pull:   the id of the neighbor the particle handed over
+//                            to minus its own id, as a signed varint.
+//              StateChange:  the new state as a varint.
+//              Insert:       the x and y coordinates of the particle's head as
+//                            signed varints; the direction is its tail's.
+//              Object:       the flags of the object (1 = traversable, 2 =
+//                            anchor) as a varint, followed by its x and y
+//                            coordinates as signed varints.
+//              Clear:        1 if objects were removed with the particles, 0
+//                            otherwise, as a varint.
+//
+// The activation index of an event is the value of the "# Activations" count
+// when it happened, so the events of one activation share it; consecutive
+// moves usually differ by at most a few activations and take 3-5 bytes. A log
+// starts with an Object event per object and an Insert event per particle,
+// whose ids are their indices in the system; particles inserted later get the
+// next ids in order, and Clear removes all particles (their ids are not
+// reused). Object and Clear events repeat the previous particle id. Push and
+// pull events are recorded for the activated particle, with the direction of
+// its own expansion (push) or the direction from it to the pulled neighbor
+// (pull); contractions record the direction from the head to the tail before
+// contracting. The file grows by whole windows and is trimmed when the
+// recorder is destroyed; the log of a run that ended without that is padded
+// with zero bytes, which readers ignore.
+
+#ifndef AMOEBOTSIM_CORE_MOVERECORDER_H_
+#define AMOEBOTSIM_CORE_MOVERECORDER_H_
+
+#include <unordered_map>
+
+#include <QFile>
+#include <QString>
+#include <QtGlobal>
+
+#include "core/metric.h"
+#include "core/node.h"
+#include "core/object.h"
+
+// AmoebotParticle must be forward declared to avoid a cyclic dependency.
+class AmoebotParticle;
+
+class MoveRecorder {
+public:
+    enum class Op : quint8 {
+        Expand,
+        ContractHead,
+        ContractTail,
+        Push,
+        Pull,
+        StateChange,
+        Insert,
+        Object,
+        Clear
+    };
+
+    // A decoded event; fields its operation does not use are 0 (dir: -1).
+    struct Event {
+        quint64 activation = 0;
+        quint32 particle = 0;
+        Op op = Op::Expand;
+        int dir = -1;
+        quint32 neighbor = 0;
+        quint32 state = 0;
+        Node node;
+    };
+
+    // Opens (and truncates) the given file and writes the header; check
+    // isOpen() for success. Events are stamped with the current value of the
+    // given activation count.
+    MoveRecorder(const QString filePath, const Count& activations);
+
+    // Trims the file to the recorded events and closes it.
+    ~MoveRecorder();
+
+    bool isOpen() const;
+
+    // addParticle assigns the next particle id to the given particle and
+    // records its insertion, and addObject records the insertion of an object.
+    // removeParticles forgets all particles added so far and records their
+    // removal, together with that of all objects if removeObjects is true.
+    void addParticle(const AmoebotParticle* particle);
+    void addObject(const Object& object);
+    void removeParticles(bool removeObjects);
+
+    // Records an event of the given particle, which must have been added
+    // before. dir is a global direction, or -1 if the event has none; state is
+    // only recorded for state changes.
+    void record(const AmoebotParticle* particle, Op op, int dir,
+        quint32 state = 0);
+
+    // Records a push or pull (op) of the given particle with the given
+    // neighbor, both of which must have been added before; dir is as above.
+    void recordHandover(const AmoebotParticle* particle,
+        const AmoebotParticle* neighbor, Op op, int dir);
+
+    // Converts a move log to CSV, with one "activation,particle,op,direction,
+    // neighbor,state,x,y" line per event, where op is the name of the operation
+    // and fields the event does not use are empty. Returns false if either file
+    // cannot be opened or the input is not a valid move log.
+    static bool render(const QString binaryPath, const QString outPath);
+
+private:
+    // Writes the common fields of an event, moving the window first if
+    // necessary; returns false if the window cannot be moved.
+    bool beginEvent(quint32 particle, Op op, int dir);
+
+    // Moves the mapped window to start at the end of the recorded events.
+    bool remap();
+
+    void putVarint(quint64 value);
+    void putSignedVarint(qint64 value);
+
+    QFile file;
+    const Count& activations;
+    std::unordered_map<const AmoebotParticle*, quint32> ids;
+    quint32 nextId;
+
+    uchar* window;
+    qint64 windowStart;
+    qint64 windowPos;
+    quint64 lastActivation;
+    quint32 lastParticle;
+};
+
+// Reads the events of a move log in order, from a read-only memory mapping of
+// the file.
+class MoveLogReader {
+public:
+    // Opens and maps the given move log; check isOpen() for success.
+    explicit MoveLogReader(const QString filePath);
+
+    bool isOpen() const;
+
+    // Decodes the next event into event, which must hold the event read before
+    // (or be default-constructed before the first one), as events are
+    // delta-encoded. Returns false at the end of the log or if the rest of the
+    // log is corrupt; atEnd() tells these apart.
+    bool next(MoveRecorder::Event& event);
+    bool atEnd() const;
+
+    // Returns (resp., restores) the position of the next event, e.g., to
+    // resume reading from a keyframe. Reading from a restored position
+    // requires the event that was read just before it.
+    qint64 position() const;
+    void setPosition(qint64 pos);
+
+private:
+    bool getVarint(quint64& value);
+    bool getSignedVarint(qint64& value);
+
+    QFile file;
+    const uchar* data;
+    qint64 size;
+    qint64 pos;
+};
+
+#endif // AMOEBOTSIM_CORE_MOVERECORDER_H_
@@ -0,0 +1,359 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/occupancygrid.h"
+
+#include <algorithm>
+#include <climits>
+
+#include <QtAlgorithms>
+
+#include "helper/parallelreduce.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Returns the 64 bits of the given row starting at bit position start, which
+// may lie (partially) outside of the row; bits outside of the row are zero.
+quint64 bitsAt(const quint64* row, int numWords, long start)
+{
+    const long word = (start >= 0) ? start / 64 : -((63 - start) / 64);
+    const int offset = static_cast<int>(start - word * 64);
+    const quint64 lo = (word >= 0 && word < numWords) ? row[word] : 0;
+    const quint64 hi = (word + 1 >= 0 && word + 1 < numWords) ? row[word + 1] : 0;
+
+    return (offset == 0) ? lo : (lo >> offset) | (hi << (64 - offset));
+}
+
+// Shifts the row by one bit towards bit 0 (resp., away from bit 0), so that bit
+// i of the result is bit i + 1 (resp., i - 1) of the row.
+void shiftDown(const quint64* row, int numWords, quint64* result)
+{
+    for (int i = 0; i < numWords - 1; ++i) {
+        result[i] = (row[i] >> 1) | (row[i + 1] << 63);
+    }
+    result[numWords - 1] = row[numWords - 1] >> 1;
+}
+
+void shiftUp(const quint64* row, int numWords, quint64* result)
+{
+    result[0] = row[0] << 1;
+    for (int i = 1; i < numWords; ++i) {
+        result[i] = (row[i] << 1) | (row[i - 1] >> 63);
+    }
+}
+
+#if defined(__AVX2__)
+// Counts the bits of each 64-bit lane using the nibble lookup table method.
+inline __m256i popcount256(__m256i v)
+{
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i lowMask = _mm256_set1_epi8(0x0f);
+    const __m256i lo = _mm256_and_si256(v, lowMask);
+    const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), lowMask);
+    const __m256i counts = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo),
+        _mm256_shuffle_epi8(lookup, hi));
+
+    return _mm256_sad_epu8(counts, _mm256_setzero_si256());
+}
+#endif
+
+// Returns the number of bits set in both a and b.
+quint64 popcountAnd(const quint64* a, const quint64* b, int numWords)
+{
+    quint64 total = 0;
+    int i = 0;
+
+#if defined(__AVX2__)
+    __m256i acc = _mm256_setzero_si256();
+    for (; i + 4 <= numWords; i += 4) {
+        const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        acc = _mm256_add_epi64(acc, popcount256(_mm256_and_si256(va, vb)));
+    }
+    total += static_cast<quint64>(_mm256_extract_epi64(acc, 0))
+        + static_cast<quint64>(_mm256_extract_epi64(acc, 1))
+        + static_cast<quint64>(_mm256_extract_epi64(acc, 2))
+        + static_cast<quint64>(_mm256_extract_epi64(acc, 3));
+#endif
+
+    for (; i < numWords; ++i) {
+        total += qPopulationCount(a[i] & b[i]);
+    }
+
+    return total;
+}
+
+// The number of rows (resp., nodes of sparse grids) per chunk when counting
+// edges in parallel.
+const size_t rowsPerChunk = 64;
+const size_t nodesPerChunk = 4096;
+
+// A grid is dense as long as its words take at most this many times the memory
+// of a sorted list of its nodes, or at most denseWordsAlways words anyway.
+const quint64 maxDenseOverhead = 4;
+const quint64 denseWordsAlways = 4096;
+
+// The offsets of the forward global directions 0=E, 1=NE, and 2=NW.
+const int forwardX[] = { 1, 0, -1 };
+const int forwardY[] = { 0, 1, 1 };
+
+} // namespace
+
+OccupancyGrid::OccupancyGrid()
+    : _minX(0)
+    , _minY(0)
+    , _width(0)
+    , _height(0)
+    , _wordsPerRow(0)
+    , _sparse(false)
+{
+}
+
+OccupancyGrid::OccupancyGrid(int minX, int minY, int maxX, int maxY)
+    : _minX(minX)
+    , _minY(minY)
+    , _width(maxX - minX + 1)
+    , _height(maxY - minY + 1)
+    , _wordsPerRow((_width + 63) / 64)
+    , _words(static_cast<size_t>(_wordsPerRow) * _height, 0)
+    , _sparse(false)
+{
+    Q_ASSERT(minX <= maxX && minY <= maxY);
+}
+
+OccupancyGrid OccupancyGrid::ofNodes(std::vector<Node> nodes)
+{
+    if (nodes.empty()) {
+        return OccupancyGrid();
+    }
+
+    int minX = INT_MAX, minY = INT_MAX, maxX = INT_MIN, maxY = INT_MIN;
+    for (const Node& node : nodes) {
+        minX = std::min(minX, node.x);
+        minY = std::min(minY, node.y);
+        maxX = std::max(maxX, node.x);
+        maxY = std::max(maxY, node.y);
+    }
+
+    OccupancyGrid grid = withBounds(minX, minY, maxX, maxY, nodes.size());
+    if (grid._sparse) {
+        std::sort(nodes.begin(), nodes.end());
+        nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+        grid._nodes = std::move(nodes);
+    } else {
+        for (const Node& node : nodes) {
+            grid.set(node);
+        }
+    }
+
+    return grid;
+}
+
+OccupancyGrid OccupancyGrid::withBounds(int minX, int minY, int maxX, int maxY,
+    size_t numNodes)
+{
+    const quint64 wordsPerRow = (static_cast<quint64>(maxX - minX) + 64) / 64;
+    const quint64 numWords = wordsPerRow * (static_cast<quint64>(maxY - minY) + 1);
+    const quint64 wordsPerNode = (sizeof(Node) + sizeof(quint64) - 1) / sizeof(quint64);
+    if (numWords <= std::max(denseWordsAlways, maxDenseOverhead * wordsPerNode * numNodes)) {
+        return OccupancyGrid(minX, minY, maxX, maxY);
+    }
+
+    OccupancyGrid grid;
+    grid._minX = minX;
+    grid._minY = minY;
+    grid._width = maxX - minX + 1;
+    grid._height = maxY - minY + 1;
+    grid._sparse = true;
+
+    return grid;
+}
+
+quint64 OccupancyGrid::count() const
+{
+    if (_sparse) {
+        return _nodes.size();
+    }
+
+    quint64 total = 0;
+    for (const quint64 word : _words) {
+        total += qPopulationCount(word);
+    }
+
+    return total;
+}
+
+OccupancyGrid OccupancyGrid::andNot(const OccupancyGrid& other) const
+{
+    if (_sparse) {
+        OccupancyGrid result(*this);
+        result._nodes.erase(std::remove_if(result._nodes.begin(), result._nodes.end(),
+                                [&other](const Node& node) { return other.test(node); }),
+            result._nodes.end());
+        return result;
+    } else if (other._sparse) {
+        OccupancyGrid result(*this);
+        for (const Node& node : other._nodes) {
+            if (result.covers(node)) {
+                result.reset(node);
+            }
+        }
+        return result;
+    }
+
+    if (!sameBounds(other)) {
+        if (_width == 0) {
+            return *this;
+        }
+        return andNot(other.window(minX(), minY(), maxX(), maxY()));
+    }
+
+    OccupancyGrid result(*this);
+    for (size_t i = 0; i < result._words.size(); ++i) {
+        result._words[i] &= ~other._words[i];
+    }
+
+    return result;
+}
+
+OccupancyGrid OccupancyGrid::window(int minX, int minY, int maxX, int maxY) const
+{
+    if (_sparse) {
+        std::vector<Node> nodes;
+        for (const Node& node : _nodes) {
+            if (minX <= node.x && node.x <= maxX && minY <= node.y && node.y <= maxY) {
+                nodes.push_back(node);
+            }
+        }
+        OccupancyGrid result = withBounds(minX, minY, maxX, maxY, nodes.size());
+        if (result._sparse) {
+            result._nodes = std::move(nodes);
+        } else {
+            for (const Node& node : nodes) {
+                result.set(node);
+            }
+        }
+        return result;
+    }
+
+    OccupancyGrid result(minX, minY, maxX, maxY);
+    if (_width == 0) {
+        return result;
+    }
+
+    const long offset = static_cast<long>(minX) - _minX;
+    const int lastBits = result._width % 64;
+    const quint64 lastMask = (lastBits == 0) ? ~quint64(0) : (quint64(1) << lastBits) - 1;
+    for (int y = std::max(minY, _minY); y <= std::min(maxY, this->maxY()); ++y) {
+        const quint64* src = row(y);
+        quint64* dst = result.row(y);
+        for (int i = 0; i < result._wordsPerRow; ++i) {
+            dst[i] = bitsAt(src, _wordsPerRow, offset + 64L * i);
+        }
+        dst[result._wordsPerRow - 1] &= lastMask;
+    }
+
+    return result;
+}
+
+quint64 OccupancyGrid::edgeCount(const OccupancyGrid& from, const OccupancyGrid& to)
+{
+    return edgeCount(from, to, 0) + edgeCount(from, to, 1) + edgeCount(from, to, 2);
+}
+
+quint64 OccupancyGrid::edgeCount(const OccupancyGrid& from, const OccupancyGrid& to,
+    int dir)
+{
+    Q_ASSERT(0 <= dir && dir <= 2);
+
+    // With a sparse grid involved, every node of from looks up its neighbor in
+    // to, which takes time linear in the number of nodes instead of the area.
+    if (from._sparse || to._sparse) {
+        std::vector<Node> denseNodes;
+        if (!from._sparse) {
+            denseNodes = from.nodes();
+        }
+        const std::vector<Node>& nodes = from._sparse ? from._nodes : denseNodes;
+        auto countNode = [&](size_t i) -> quint64 {
+            return to.test(Node(nodes[i].x + forwardX[dir], nodes[i].y + forwardY[dir]))
+                ? 1
+                : 0;
+        };
+
+        return parallelReduce(nodes.size(), quint64(0), countNode,
+            [](quint64 a, quint64 b) { return a + b; }, nodesPerChunk);
+    }
+
+    Q_ASSERT(from.sameBounds(to));
+
+    // Rows are counted independently, so they are reduced in parallel; each
+    // thread keeps its own buffer for the shifted rows.
+    const int numWords = from._wordsPerRow;
+    const int numRows = (dir == 0) ? from._height : from._height - 1;
+    auto countRow = [&](size_t i) -> quint64 {
+        const int y = from.minY() + static_cast<int>(i);
+        const quint64* a = from.row(y);
+        if (dir == 1) {
+            return popcountAnd(a, to.row(y + 1), numWords);
+        }
+
+        thread_local std::vector<quint64> shifted;
+        shifted.resize(numWords);
+        if (dir == 0) {
+            shiftDown(to.row(y), numWords, shifted.data());
+        } else {
+            shiftUp(to.row(y + 1), numWords, shifted.data());
+        }
+        return popcountAnd(a, shifted.data(), numWords);
+    };
+
+    return parallelReduce(static_cast<size_t>(std::max(numRows, 0)), quint64(0),
+        countRow, [](quint64 a, quint64 b) { return a + b; }, rowsPerChunk);
+}
+
+std::vector<Node> OccupancyGrid::nodes() const
+{
+    if (_sparse) {
+        return _nodes;
+    }
+
+    std::vector<Node> result;
+    for (int y = 0; y < _height; ++y) {
+        for (int i = 0; i < _wordsPerRow; ++i) {
+            for (quint64 word = _words[y * _wordsPerRow + i]; word != 0; word &= word - 1) {
+                result.push_back(Node(_minX + 64 * i + qCountTrailingZeroBits(word), _minY + y));
+            }
+        }
+    }
+    std::sort(result.begin(), result.end());
+
+    return result;
+}
+
+bool OccupancyGrid::sameBounds(const OccupancyGrid& other) const
+{
+    return _minX == other._minX && _minY == other._minY
+        && _width == other._width && _height == other._height;
+}
+
+void OccupancyGrid::setSparse(const Node& node)
+{
+    const auto it = std::lower_bound(_nodes.begin(), _nodes.end(), node);
+    if (it == _nodes.end() || *it != node) {
+        _nodes.insert(it, node);
+    }
+}
+
+void OccupancyGrid::resetSparse(const Node& node)
+{
+    const auto it = std::lower_bound(_nodes.begin(), _nodes.end(), node);
+    if (it != _nodes.end() && *it == node) {
+        _nodes.erase(it);
+    }
+}
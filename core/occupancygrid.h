@@ -0,0 +1,259 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines a bit-packed occupancy representation of a rectangular window of the
+// triangular lattice. Each row (fixed y) is stored as a run of 64-bit words in
+// which bit i represents the node (minX + i, y). Neighbor relations in the
+// three "forward" global directions 0=E, 1=NE, and 2=NW then become a shift of
+// the same row (E) or of the next row (NE, NW), and counting adjacent pairs is
+// a sequence of ANDs and popcounts over whole words. When compiled with AVX2
+// enabled (e.g., -mavx2 or -march=native), the popcounts are done on 256-bit
+// vectors; otherwise the portable qPopulationCount is used. Rows of large grids
+// are counted in parallel (see helper/parallelreduce.h).
+//
+// A dense grid takes one bit per node of its bounding box, which is far more
+// than one bit per particle for spread out systems (a diagonal line of 10^6
+// particles spans 10^12 nodes). The factories below therefore build a sparse
+// grid instead whenever the box has many more nodes than the grid will
+// contain; a sparse grid stores its nodes in a sorted list, so its memory is
+// linear in their number, and its operations look nodes up by binary search.
+//
+// Grids are meant to be built on demand from the particle and object lists by
+// whole-system measures (see PerimeterMeasure) and are not kept in sync with
+// the system as particles move.
+
+#ifndef AMOEBOTSIM_CORE_OCCUPANCYGRID_H_
+#define AMOEBOTSIM_CORE_OCCUPANCYGRID_H_
+
+#include <algorithm>
+#include <climits>
+#include <vector>
+
+#include <QtGlobal>
+
+#include "core/node.h"
+
+class OccupancyGrid {
+public:
+    // Constructs a grid containing no nodes. The first constructor covers no
+    // nodes at all; the second covers the nodes (x, y) with minX <= x <= maxX
+    // and minY <= y <= maxY and is always dense.
+    OccupancyGrid();
+    OccupancyGrid(int minX, int minY, int maxX, int maxY);
+
+    // Constructs a grid covering (and containing) the given nodes, which is
+    // sparse if their bounding box is much larger than their number.
+    static OccupancyGrid ofNodes(std::vector<Node> nodes);
+
+    // Constructs a grid covering (and containing) the position of every
+    // particle in the given container, where a particle's position is its tail
+    // if it is expanded and its head otherwise. This mirrors how the
+    // particle-based measures ignore the heads of expanded neighbors, so every
+    // particle is represented by exactly one node. The optional predicate
+    // restricts the grid to the particles satisfying it while keeping the
+    // bounds (and representation) of the whole container, so grids built from
+    // the same container can be combined directly.
+    template <class ParticleContainer>
+    static OccupancyGrid ofTails(const ParticleContainer& particles);
+    template <class ParticleContainer, class Predicate>
+    static OccupancyGrid ofTails(const ParticleContainer& particles,
+        Predicate predicate);
+
+    // Returns whether the given node lies within the bounds of this grid.
+    bool covers(const Node& node) const;
+
+    // Returns whether this grid stores a sorted list of nodes instead of rows
+    // of bits.
+    bool isSparse() const;
+
+    // Functions for (un)marking and querying single nodes. set and reset fail
+    // for nodes outside the grid's bounds, while test simply returns false.
+    // On sparse grids, set and reset take time linear in the number of nodes.
+    void set(const Node& node);
+    void reset(const Node& node);
+    bool test(const Node& node) const;
+
+    // Returns the number of nodes in this grid.
+    quint64 count() const;
+
+    // Returns a grid with the bounds of this grid containing the nodes of this
+    // grid that are not contained in the other grid. The other grid may have
+    // arbitrary bounds.
+    OccupancyGrid andNot(const OccupancyGrid& other) const;
+
+    // Returns a grid with the given bounds containing the nodes of this grid
+    // that lie within them.
+    OccupancyGrid window(int minX, int minY, int maxX, int maxY) const;
+
+    // Returns the number of pairs of adjacent nodes u, v with u in from and v in
+    // to such that v is reached from u in one of the forward global directions
+    // 0, 1, or 2 (or only the given one). Since every lattice edge points
+    // forward from exactly one of its endpoints, edgeCount(g, g) is the number
+    // of edges between nodes of g and edgeCount(a, b) + edgeCount(b, a) is the
+    // number of edges between nodes of a and nodes of b. Dense grids must have
+    // the same bounds; if either grid is sparse, the nodes of from are looked
+    // up in to one by one, so the bounds may differ.
+    static quint64 edgeCount(const OccupancyGrid& from, const OccupancyGrid& to);
+    static quint64 edgeCount(const OccupancyGrid& from, const OccupancyGrid& to,
+        int dir);
+
+    // Accessors for the grid's bounds and raw rows. row(y) points to the
+    // wordsPerRow() words representing row y; the bits beyond maxX are zero.
+    // Only dense grids have rows.
+    int minX() const;
+    int minY() const;
+    int maxX() const;
+    int maxY() const;
+    int wordsPerRow() const;
+    const quint64* row(int y) const;
+    quint64* row(int y);
+
+private:
+    // Returns an empty grid with the given bounds that is dense unless its
+    // words would take much more memory than a sorted list of numNodes nodes.
+    static OccupancyGrid withBounds(int minX, int minY, int maxX, int maxY,
+        size_t numNodes);
+
+    // Returns the nodes of this grid in the order of the sorted list of a
+    // sparse grid.
+    std::vector<Node> nodes() const;
+
+    bool sameBounds(const OccupancyGrid& other) const;
+    void setSparse(const Node& node);
+    void resetSparse(const Node& node);
+
+    int _minX, _minY;
+    int _width, _height;
+    int _wordsPerRow;
+    std::vector<quint64> _words;
+
+    // For sparse grids, the contained nodes in ascending order.
+    bool _sparse;
+    std::vector<Node> _nodes;
+};
+
+template <class ParticleContainer>
+OccupancyGrid OccupancyGrid::ofTails(const ParticleContainer& particles)
+{
+    return ofTails(particles, [](decltype(*particles.begin())) { return true; });
+}
+
+template <class ParticleContainer, class Predicate>
+OccupancyGrid OccupancyGrid::ofTails(const ParticleContainer& particles,
+    Predicate predicate)
+{
+    int minX = INT_MAX, minY = INT_MAX, maxX = INT_MIN, maxY = INT_MIN;
+    for (const auto& p : particles) {
+        const Node node = p->isExpanded() ? p->tail() : p->head;
+        minX = std::min(minX, node.x);
+        minY = std::min(minY, node.y);
+        maxX = std::max(maxX, node.x);
+        maxY = std::max(maxY, node.y);
+    }
+
+    if (minX > maxX) {
+        return OccupancyGrid();
+    }
+
+    OccupancyGrid grid = withBounds(minX, minY, maxX, maxY, particles.size());
+    for (const auto& p : particles) {
+        if (predicate(p)) {
+            const Node node = p->isExpanded() ? p->tail() : p->head;
+            if (grid._sparse) {
+                grid._nodes.push_back(node);
+            } else {
+                grid.set(node);
+            }
+        }
+    }
+    std::sort(grid._nodes.begin(), grid._nodes.end());
+
+    return grid;
+}
+
+inline bool OccupancyGrid::covers(const Node& node) const
+{
+    return node.x >= _minX && node.x - _minX < _width
+        && node.y >= _minY && node.y - _minY < _height;
+}
+
+inline bool OccupancyGrid::isSparse() const
+{
+    return _sparse;
+}
+
+inline void OccupancyGrid::set(const Node& node)
+{
+    Q_ASSERT(covers(node));
+    if (_sparse) {
+        setSparse(node);
+        return;
+    }
+    const int bit = node.x - _minX;
+    _words[(node.y - _minY) * _wordsPerRow + bit / 64] |= quint64(1) << (bit % 64);
+}
+
+inline void OccupancyGrid::reset(const Node& node)
+{
+    Q_ASSERT(covers(node));
+    if (_sparse) {
+        resetSparse(node);
+        return;
+    }
+    const int bit = node.x - _minX;
+    _words[(node.y - _minY) * _wordsPerRow + bit / 64] &= ~(quint64(1) << (bit % 64));
+}
+
+inline bool OccupancyGrid::test(const Node& node) const
+{
+    if (!covers(node)) {
+        return false;
+    }
+    if (_sparse) {
+        return std::binary_search(_nodes.begin(), _nodes.end(), node);
+    }
+    const int bit = node.x - _minX;
+    return (_words[(node.y - _minY) * _wordsPerRow + bit / 64] >> (bit % 64)) & 1;
+}
+
+inline int OccupancyGrid::minX() const
+{
+    return _minX;
+}
+
+inline int OccupancyGrid::minY() const
+{
+    return _minY;
+}
+
+inline int OccupancyGrid::maxX() const
+{
+    return _minX + _width - 1;
+}
+
+inline int OccupancyGrid::maxY() const
+{
+    return _minY + _height - 1;
+}
+
+inline int OccupancyGrid::wordsPerRow() const
+{
+    return _wordsPerRow;
+}
+
+inline const quint64* OccupancyGrid::row(int y) const
+{
+    Q_ASSERT(!_sparse);
+    Q_ASSERT(_minY <= y && y - _minY < _height);
+    return _words.data() + (y - _minY) * _wordsPerRow;
+}
+
+inline quint64* OccupancyGrid::row(int y)
+{
+    Q_ASSERT(!_sparse);
+    Q_ASSERT(_minY <= y && y - _minY < _height);
+    return _words.data() + (y - _minY) * _wordsPerRow;
+}
+
+#endif // AMOEBOTSIM_CORE_OCCUPANCYGRID_H_
@@ -8,7 +8,8 @@
 
 Particle::Particle(const Node& head, int globalTailDir)
   : head(head),
-    globalTailDir(globalTailDir) {
+    globalTailDir(globalTailDir),
+    attributesGeneration(0) {
   Q_ASSERT(-1 <= globalTailDir && globalTailDir < 6);
 }
 
@@ -57,6 +58,10 @@ std::array<int, 6> Particle::borderPointColors() const {
   return borderPointColors;
 }
 
+void Particle::invalidateRenderAttributes() const {
+  attributesGeneration = 0;
+}
+
 QString Particle::inspectionText() const {
   return "Overwrite Particle::inspectionText() to specify an inspection text.";
 }
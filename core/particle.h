@@ -11,9 +11,27 @@
 #include <array>
 
 #include <QString>
+#include <QtGlobal>
 
 #include "core/node.h"
 
+// The cosmetic appearance of a particle, as returned by the functions of
+// Particle below, packed in one place so renderers and exporters can read it
+// without calling them (see System::renderAttributes). Bit i of borderMask
+// (resp., borderPointMask) is set if borderColors[i] (resp.,
+// borderPointColors[i]) is a color, so particles without borders are skipped
+// without reading the colors.
+struct RenderAttributes {
+  int headMarkColor;
+  int tailMarkColor;
+  qint8 headMarkGlobalDir;
+  qint8 tailMarkGlobalDir;
+  quint8 borderPointMask;
+  quint32 borderMask;
+  std::array<int, 18> borderColors;
+  std::array<int, 6> borderPointColors;
+};
+
 class Particle {
  public:
   // Constructs a new particle with a node position for its head and a global
@@ -48,12 +66,26 @@ class Particle {
   virtual std::array<int, 18> borderColors() const;
   virtual std::array<int, 6> borderPointColors() const;
 
+  // Marks the cosmetic appearance of this particle as changed, so the next
+  // call of System::renderAttributes calls the functions above again. Systems
+  // do this for every particle they activate, for its neighbors, and for
+  // every particle that moves or whose tokens change.
+  void invalidateRenderAttributes() const;
+
   // Returns the string to be displayed when this particle is inspected; used
   // to snapshot the current values of this particle's memory at runtime.
   virtual QString inspectionText() const;
 
   Node head;
   int globalTailDir;
+
+ private:
+  friend class System;
+
+  // The cached appearance of the particle and the generation of the system's
+  // cache it belongs to (0 if none); see System::renderAttributes.
+  mutable RenderAttributes attributes;
+  mutable quint64 attributesGeneration;
 };
 
 #endif  // AMOEBOTSIM_CORE_PARTICLE_H_
@@ -0,0 +1,149 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/performancegovernor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+
+#include <QMutexLocker>
+
+// The maximum frame rate, the share of the time drawing may take, and the share
+// of the rest of a frame interval a batch may take for each target.
+struct Policy {
+    double maxFramesPerSecond;
+    double renderShare;
+    double batchShare;
+};
+static const Policy policies[] = {
+    { 60.0, 0.5, 0.25 }, // SmoothView
+    { 10.0, 0.1, 0.5 } // MaxSimSpeed
+};
+
+// frames are drawn at least once per second, and batches are bounded so that
+// a misestimate cannot lock the system for long
+static constexpr int maxFrameInterval = 1000;
+static constexpr double maxBatchSize = 1 << 20;
+
+// weight of a new measurement in the moving averages of the costs
+static constexpr double smoothing = 0.1;
+
+// achieved rates are counted over windows of at least this many milliseconds
+static constexpr qint64 rateWindow = 500;
+
+PerformanceGovernor::PerformanceGovernor()
+    : _target(SmoothView)
+    , frameCost(-1.0)
+    , activationCost(-1.0)
+{
+    for (Rate* rate : { &frameRate, &activationRate }) {
+        rate->window.invalidate();
+        rate->count = 0;
+        rate->perSecond = 0.0;
+    }
+}
+
+void PerformanceGovernor::setTarget(Target target)
+{
+    QMutexLocker locker(&mutex);
+    _target = target;
+}
+
+PerformanceGovernor::Target PerformanceGovernor::target() const
+{
+    QMutexLocker locker(&mutex);
+    return _target;
+}
+
+void PerformanceGovernor::frameRendered(double ms)
+{
+    QMutexLocker locker(&mutex);
+    frameCost = (frameCost < 0.0) ? ms : frameCost + smoothing * (ms - frameCost);
+    count(frameRate, 1);
+}
+
+void PerformanceGovernor::batchSimulated(quint64 activations, double ms)
+{
+    if (activations == 0) {
+        return;
+    }
+
+    QMutexLocker locker(&mutex);
+    const double cost = ms / activations;
+    activationCost = (activationCost < 0.0)
+        ? cost
+        : activationCost + smoothing * (cost - activationCost);
+    count(activationRate, activations);
+}
+
+int PerformanceGovernor::frameInterval() const
+{
+    QMutexLocker locker(&mutex);
+    return frameIntervalLocked();
+}
+
+quint64 PerformanceGovernor::batchSize() const
+{
+    QMutexLocker locker(&mutex);
+    if (activationCost < 0.0) {
+        return 1;
+    }
+
+    // A batch may take its share of the time that drawing leaves free.
+    const double budget = (frameIntervalLocked() - std::max(0.0, frameCost))
+        * policies[_target].batchShare;
+    return static_cast<quint64>(
+        std::min(maxBatchSize, std::max(1.0, budget / activationCost)));
+}
+
+double PerformanceGovernor::framesPerSecond() const
+{
+    QMutexLocker locker(&mutex);
+    return perSecond(frameRate);
+}
+
+double PerformanceGovernor::activationsPerSecond() const
+{
+    QMutexLocker locker(&mutex);
+    return perSecond(activationRate);
+}
+
+void PerformanceGovernor::count(Rate& rate, quint64 amount)
+{
+    if (!rate.window.isValid()) {
+        rate.window.start();
+        rate.count = 0;
+    }
+    rate.count += amount;
+
+    const qint64 elapsed = rate.window.elapsed();
+    if (elapsed >= rateWindow) {
+        rate.perSecond = rate.count * 1000.0 / elapsed;
+        rate.count = 0;
+        rate.window.restart();
+    }
+}
+
+double PerformanceGovernor::perSecond(const Rate& rate)
+{
+    if (!rate.window.isValid()) {
+        return 0.0;
+    }
+
+    // Once a window passes without being counted into, the rate drops to what
+    // was counted in it so far, e.g., to 0 when the simulation stops.
+    const qint64 elapsed = rate.window.elapsed();
+    return (elapsed >= rateWindow) ? rate.count * 1000.0 / elapsed : rate.perSecond;
+}
+
+int PerformanceGovernor::frameIntervalLocked() const
+{
+    const Policy& policy = policies[_target];
+    double interval = 1000.0 / policy.maxFramesPerSecond;
+    if (frameCost > 0.0) {
+        interval = std::max(interval, frameCost / policy.renderShare);
+    }
+    return std::min(maxFrameInterval, static_cast<int>(std::ceil(interval)));
+}
@@ -0,0 +1,83 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines a governor that splits time between rendering and simulation. The
+// view reports how long each frame took to draw (see GLItem::frameRendered),
+// and the simulator reports how long its batches of activations took (see
+// Simulator::step). From these, the governor chooses the interval between
+// frames and the number of activations per batch when the simulation runs
+// without a step duration, according to one of two targets:
+//
+//   SmoothView:   up to 60 frames per second, with drawing taking at most half
+//                 of the time; batches take at most a quarter of the rest of
+//                 a frame interval, so the view stays responsive.
+//   MaxSimSpeed:  up to 10 frames per second, with drawing taking at most a
+//                 tenth of the time; batches take up to half of a frame
+//                 interval.
+//
+// So frames become rarer as the system becomes too large to draw quickly, and
+// batches grow as drawing becomes cheap. The governor also measures the frames
+// and activations per second actually achieved. Its functions may be called
+// from any thread.
+
+#ifndef AMOEBOTSIM_CORE_PERFORMANCEGOVERNOR_H_
+#define AMOEBOTSIM_CORE_PERFORMANCEGOVERNOR_H_
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QtGlobal>
+
+class PerformanceGovernor {
+public:
+    enum Target {
+        SmoothView,
+        MaxSimSpeed
+    };
+
+    // Constructs a governor for smooth views that has not measured anything.
+    PerformanceGovernor();
+
+    void setTarget(Target target);
+    Target target() const;
+
+    // Report a frame that took the given time to draw, not counting waiting
+    // for the system, and a batch of the given number of activations that took
+    // the given time, respectively, both in milliseconds.
+    void frameRendered(double ms);
+    void batchSimulated(quint64 activations, double ms);
+
+    // Return the interval in milliseconds at which frames should be drawn and
+    // the number of activations a batch should run.
+    int frameInterval() const;
+    quint64 batchSize() const;
+
+    // Return the frames and activations per second achieved recently.
+    double framesPerSecond() const;
+    double activationsPerSecond() const;
+
+private:
+    // Rates are counted over windows of at least rateWindow milliseconds.
+    struct Rate {
+        QElapsedTimer window;
+        quint64 count;
+        double perSecond;
+    };
+    static void count(Rate& rate, quint64 amount);
+    static double perSecond(const Rate& rate);
+
+    int frameIntervalLocked() const;
+
+    mutable QMutex mutex;
+    Target _target;
+
+    // Moving averages of the time it takes to draw a frame and to run one
+    // activation, in milliseconds; negative until measured.
+    double frameCost;
+    double activationCost;
+
+    Rate frameRate;
+    Rate activationRate;
+};
+
+#endif // AMOEBOTSIM_CORE_PERFORMANCEGOVERNOR_H_
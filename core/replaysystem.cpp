@@ -0,0 +1,387 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/replaysystem.h"
+
+#include <algorithm>
+
+#include <QDateTime>
+
+namespace {
+
+// Keyframes are thinned out when there are more than this many of them or
+// when they use more than this many bytes (but at least two are kept).
+const size_t maxKeyframes = 256;
+const size_t maxKeyframeMemory = 256 << 20;
+
+// The colors of particles by state (modulo the number of colors).
+const int stateColors[] = {0x2196f3, 0xf44336, 0x4caf50, 0xff9800, 0x9c27b0,
+                           0x00bcd4, 0x795548, 0x607d8b};
+
+}  // namespace
+
+ReplayParticle::ReplayParticle(const Node& head, int globalTailDir, int state)
+  : Particle(head, globalTailDir),
+    state(state) {}
+
+int ReplayParticle::headMarkColor() const {
+  return (state < 0) ? -1 : stateColors[state % 8];
+}
+
+int ReplayParticle::tailMarkColor() const {
+  return headMarkColor();
+}
+
+QString ReplayParticle::inspectionText() const {
+  QString text;
+  text += "Global Info:\n";
+  text += "  head: (" + QString::number(head.x) + ", "
+                      + QString::number(head.y) + ")\n";
+  text += "  globalTailDir: " + QString::number(globalTailDir) + "\n\n";
+  text += "Replayed state: ";
+  text += (state < 0) ? "none\n" : QString::number(state) + "\n";
+
+  return text;
+}
+
+ReplaySystem::ReplaySystem(const QString filePath)
+  : reader(filePath),
+    valid(false),
+    firstId(0),
+    _firstActivation(0),
+    _lastActivation(0),
+    keyframeInterval(1) {
+  _counts.push_back(new Count("# Activations"));
+  _counts.push_back(new Count("# Moves"));
+  if (!reader.isOpen()) {
+    return;
+  }
+
+  // Set up the configuration the log starts with.
+  MoveRecorder::Event next = event;
+  qint64 position = reader.position();
+  while (reader.next(next) && (next.op == MoveRecorder::Op::Insert
+                               || next.op == MoveRecorder::Op::Object)) {
+    if (!apply(next)) {
+      return;
+    }
+    event = next;
+    position = reader.position();
+  }
+  reader.setPosition(position);
+  _firstActivation = event.activation;
+  _lastActivation = _firstActivation;
+  _counts[0]->_value = _firstActivation;
+  takeKeyframe(position);
+
+  // Replay the whole log once, validating it and taking keyframes.
+  next = event;
+  while (reader.next(next)) {
+    if (next.activation >= keyframes.back().activation + keyframeInterval) {
+      _counts[0]->_value = next.activation;
+      takeKeyframe(position);
+    }
+    if (!apply(next)) {
+      return;
+    }
+    event = next;
+    position = reader.position();
+    _lastActivation = event.activation + 1;
+  }
+
+  valid = reader.atEnd();
+  restore(keyframes.front());
+}
+
+ReplaySystem::~ReplaySystem() {
+  clearObjects();
+  for (auto c : _counts) {
+    delete c;
+  }
+}
+
+bool ReplaySystem::isValid() const {
+  return valid;
+}
+
+void ReplaySystem::activate() {
+  if (!hasTerminated()) {
+    seek(activation() + 1);
+  }
+}
+
+void ReplaySystem::activateParticleAt(Node) {
+  activate();
+}
+
+unsigned int ReplaySystem::size() const {
+  return particles.size();
+}
+
+unsigned int ReplaySystem::numObjects() const {
+  return objects.size();
+}
+
+const Particle& ReplaySystem::at(int i) const {
+  return particles.at(i);
+}
+
+const std::deque<Object*>& ReplaySystem::getObjects() const {
+  return objects;
+}
+
+const std::vector<Count*>& ReplaySystem::getCounts() const {
+  return _counts;
+}
+
+const std::vector<Measure*>& ReplaySystem::getMeasures() const {
+  return _measures;
+}
+
+Count& ReplaySystem::getCount(QString name) const {
+  for (const auto& c : _counts) {
+    if (QString::compare(c->_name, name) == 0) {
+      return *c;
+    }
+  }
+  Q_ASSERT(false);  // Requested count does not exist.
+}
+
+Measure& ReplaySystem::getMeasure(QString name) const {
+  for (const auto& m : _measures) {
+    if (QString::compare(m->_name, name) == 0) {
+      return *m;
+    }
+  }
+  Q_ASSERT(false);  // Requested measure does not exist.
+}
+
+const QString ReplaySystem::metricsAsJSON() const {
+  QString json;
+  QTextStream out(&json);
+  writeMetricsJSON(out);
+  out.flush();
+  return json;
+}
+
+void ReplaySystem::writeMetricsJSON(QTextStream& out) const {
+  out << "{\"title\" : \"AmoebotSim Metrics JSON\", ";
+  out << "\"datetime\" : \"" << QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss") << "\", ";
+  out << "\"algorithm\" : \"replay\", ";
+  out << "\"counts\" : [";
+  for (size_t i = 0; i < _counts.size(); ++i) {
+    out << (i == 0 ? "" : ", ") << "{\"name\" : \"" << _counts[i]->_name
+        << "\", \"history\" : [" << _counts[i]->_value << "]}";
+  }
+  out << "], \"measures\" : []}";
+}
+
+bool ReplaySystem::hasTerminated() const {
+  return activation() >= _lastActivation;
+}
+
+quint64 ReplaySystem::firstActivation() const {
+  return _firstActivation;
+}
+
+quint64 ReplaySystem::lastActivation() const {
+  return _lastActivation;
+}
+
+quint64 ReplaySystem::activation() const {
+  return _counts[0]->_value;
+}
+
+void ReplaySystem::seek(quint64 activation) {
+  activation = std::max(_firstActivation,
+                        std::min(activation, _lastActivation));
+
+  // Replay from the last keyframe at or before the target, unless the current
+  // state is closer to it.
+  auto keyframe = std::upper_bound(keyframes.begin(), keyframes.end(),
+                                   activation,
+                                   [](quint64 a, const Keyframe& k) {
+                                     return a < k.activation;
+                                   }) - 1;
+  if (activation < this->activation()
+      || keyframe->activation > this->activation()) {
+    restore(*keyframe);
+  }
+  advance(activation);
+}
+
+bool ReplaySystem::apply(const MoveRecorder::Event& e) {
+  typedef MoveRecorder::Op Op;
+
+  switch (e.op) {
+    case Op::Insert:
+      if (e.particle != firstId + particles.size()) {
+        return false;
+      }
+      particles.push_back(ReplayParticle(e.node, e.dir));
+      reportChange(e.node);
+      return true;
+    case Op::Object:
+      objects.push_back(new Object(e.node, e.state & 1, e.state & 2));
+      reportChange(e.node);
+      reportObjectsChanged();
+      return true;
+    case Op::Clear:
+      reportAllChanged();
+      firstId += particles.size();
+      particles.clear();
+      if (e.state & 1) {
+        clearObjects();
+      }
+      return true;
+    default:
+      break;
+  }
+
+  if (e.particle - firstId >= particles.size()) {
+    return false;
+  }
+  reportChange(particles[e.particle - firstId].head);
+  ReplayParticle& p = particles[e.particle - firstId];
+  p.invalidateRenderAttributes();
+  ReplayParticle* nbr = nullptr;
+  if (e.op == Op::Push || e.op == Op::Pull) {
+    if (e.neighbor - firstId >= particles.size() || e.dir < 0) {
+      return false;
+    }
+    nbr = &particles[e.neighbor - firstId];
+  }
+
+  switch (e.op) {
+    case Op::Expand:
+      if (e.dir < 0 || p.isExpanded()) {
+        return false;
+      }
+      p.head = p.head.nodeInDir(e.dir);
+      p.globalTailDir = (e.dir + 3) % 6;
+      _counts[1]->record();
+      break;
+    case Op::ContractHead:
+    case Op::ContractTail:
+      if (p.isContracted()) {
+        return false;
+      }
+      if (e.op == Op::ContractHead) {
+        p.head = p.tail();
+      }
+      p.globalTailDir = -1;
+      _counts[1]->record();
+      break;
+    case Op::Push: {
+      // The particle expands into the node the neighbor contracts out of.
+      const Node handoverNode = p.head.nodeInDir(e.dir);
+      if (p.isExpanded() || nbr->isContracted()) {
+        return false;
+      }
+      if (handoverNode == nbr->head) {
+        nbr->head = nbr->tail();
+      } else if (handoverNode != nbr->tail()) {
+        return false;
+      }
+      nbr->globalTailDir = -1;
+      p.head = handoverNode;
+      p.globalTailDir = (e.dir + 3) % 6;
+      _counts[1]->record(2);
+      break;
+    }
+    case Op::Pull: {
+      // The neighbor expands into the node the particle contracts out of.
+      const Node handoverNode = nbr->head.nodeInDir((e.dir + 3) % 6);
+      if (p.isContracted() || nbr->isExpanded()) {
+        return false;
+      }
+      if (handoverNode == p.head) {
+        p.head = p.tail();
+      } else if (handoverNode != p.tail()) {
+        return false;
+      }
+      p.globalTailDir = -1;
+      nbr->head = handoverNode;
+      nbr->globalTailDir = e.dir;
+      _counts[1]->record(2);
+      break;
+    }
+    case Op::StateChange:
+      p.state = static_cast<int>(e.state);
+      break;
+    default:
+      return false;
+  }
+
+  return true;
+}
+
+void ReplaySystem::advance(quint64 activation) {
+  MoveRecorder::Event next = event;
+  qint64 position = reader.position();
+  while (reader.next(next) && next.activation < activation) {
+    apply(next);
+    event = next;
+    position = reader.position();
+  }
+  reader.setPosition(position);
+  _counts[0]->_value = activation;
+}
+
+void ReplaySystem::takeKeyframe(qint64 position) {
+  Keyframe keyframe;
+  keyframe.activation = _counts[0]->_value;
+  keyframe.numMoves = _counts[1]->_value;
+  keyframe.position = position;
+  keyframe.event = event;
+  keyframe.firstId = firstId;
+  keyframe.particles.reserve(particles.size());
+  for (const auto& p : particles) {
+    keyframe.particles.push_back({p.head, p.state,
+                                  static_cast<qint8>(p.globalTailDir)});
+  }
+  for (const auto& o : objects) {
+    keyframe.objects.push_back(*o);
+  }
+  keyframes.push_back(std::move(keyframe));
+
+  const size_t memory = keyframes.size()
+      * (particles.size() * sizeof(KeyParticle)
+         + objects.size() * sizeof(Object));
+  if (keyframes.size() > 2
+      && (keyframes.size() > maxKeyframes || memory > maxKeyframeMemory)) {
+    for (size_t i = 1; 2 * i < keyframes.size(); ++i) {
+      keyframes[i] = std::move(keyframes[2 * i]);
+    }
+    keyframes.resize((keyframes.size() + 1) / 2);
+    keyframeInterval *= 2;
+  }
+}
+
+void ReplaySystem::restore(const Keyframe& keyframe) {
+  reportAllChanged();
+  particles.clear();
+  particles.reserve(keyframe.particles.size());
+  for (const auto& p : keyframe.particles) {
+    particles.push_back(ReplayParticle(p.head, p.globalTailDir, p.state));
+  }
+  clearObjects();
+  for (const auto& o : keyframe.objects) {
+    objects.push_back(new Object(o));
+  }
+
+  firstId = keyframe.firstId;
+  event = keyframe.event;
+  reader.setPosition(keyframe.position);
+  _counts[0]->_value = keyframe.activation;
+  _counts[1]->_value = keyframe.numMoves;
+}
+
+void ReplaySystem::clearObjects() {
+  for (auto o : objects) {
+    delete o;
+  }
+  objects.clear();
+  reportObjectsChanged();
+}
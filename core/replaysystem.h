@@ -0,0 +1,143 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines a system that replays a move log (see core/moverecorder.h) without
+// running the algorithm that recorded it. Its particles only have positions
+// and the states their algorithm reported, and each activation applies the
+// logged events of the next activation index, which is much faster than
+// simulating. To seek to any activation index, snapshots of all particles
+// (keyframes) are taken while the log is loaded. Whenever there are too many
+// of them, every other keyframe is dropped and the minimum number of
+// activations between keyframes doubles, so keyframes use bounded memory and
+// seeking only replays the events between two consecutive ones.
+
+#ifndef AMOEBOTSIM_CORE_REPLAYSYSTEM_H_
+#define AMOEBOTSIM_CORE_REPLAYSYSTEM_H_
+
+#include <deque>
+#include <vector>
+
+#include <QString>
+#include <QTextStream>
+
+#include "core/metric.h"
+#include "core/moverecorder.h"
+#include "core/node.h"
+#include "core/object.h"
+#include "core/particle.h"
+#include "core/system.h"
+
+class ReplayParticle : public Particle {
+ public:
+  // Constructs a particle with a node position for its head, a global compass
+  // direction from its head to its tail (-1 if contracted), and the state last
+  // reported by its algorithm (-1 if none).
+  ReplayParticle(const Node& head = Node(), int globalTailDir = -1,
+                 int state = -1);
+
+  // Colors the particle by its state, if any.
+  int headMarkColor() const override;
+  int tailMarkColor() const override;
+
+  QString inspectionText() const override;
+
+  int state;
+};
+
+class ReplaySystem : public System {
+ public:
+  // Loads the given move log and builds its keyframes; check isValid() for
+  // success. The replay starts in the configuration the log starts with.
+  explicit ReplaySystem(const QString filePath);
+  ~ReplaySystem();
+
+  bool isValid() const;
+
+  // Replay the events of the next activation index. Particles cannot be
+  // activated individually, so activateParticleAt does the same as activate.
+  void activate() final;
+  void activateParticleAt(Node node) final;
+
+  unsigned int size() const final;
+  unsigned int numObjects() const final;
+  const Particle& at(int i) const final;
+  const std::deque<Object*>& getObjects() const final;
+
+  // A replay has the counts "# Activations" and "# Moves", i.e., the current
+  // activation index and the number of movements replayed to get there, but
+  // neither histories nor measures.
+  const std::vector<Count*>& getCounts() const final;
+  const std::vector<Measure*>& getMeasures() const final;
+  Count& getCount(QString name) const final;
+  Measure& getMeasure(QString name) const final;
+  const QString metricsAsJSON() const final;
+  void writeMetricsJSON(QTextStream& out) const final;
+
+  // Returns true once all events have been replayed.
+  bool hasTerminated() const final;
+
+  // Return the activation index the log starts (resp., ends) at, i.e., that
+  // of its first event (resp., one more than that of its last event), and the
+  // current activation index, which is between the two.
+  quint64 firstActivation() const;
+  quint64 lastActivation() const;
+  quint64 activation() const;
+
+  // Moves the replay to the given activation index, clamped to the indices
+  // of the log; the particles are then as before the activation of that
+  // index, i.e., all events of earlier activations have been replayed.
+  void seek(quint64 activation);
+
+ private:
+  struct KeyParticle {
+    Node head;
+    qint32 state;
+    qint8 globalTailDir;
+  };
+
+  struct Keyframe {
+    quint64 activation;
+    quint64 numMoves;
+    qint64 position;
+    MoveRecorder::Event event;
+    quint32 firstId;
+    std::vector<KeyParticle> particles;
+    std::vector<Object> objects;
+  };
+
+  // Applies the given event; returns false if it does not fit the current
+  // configuration, i.e., if the log is corrupt.
+  bool apply(const MoveRecorder::Event& e);
+
+  // Replays the events before the given activation index.
+  void advance(quint64 activation);
+
+  // Keyframe support. takeKeyframe appends a keyframe of the current state,
+  // whose next event is at the given position of the log, thinning out the
+  // keyframes if necessary. restore returns to a keyframe.
+  void takeKeyframe(qint64 position);
+  void restore(const Keyframe& keyframe);
+
+  void clearObjects();
+
+  MoveLogReader reader;
+  bool valid;
+
+  std::vector<ReplayParticle> particles;
+  quint32 firstId;
+  std::deque<Object*> objects;
+
+  // The last event replayed, from which the reader decodes the next one.
+  MoveRecorder::Event event;
+  quint64 _firstActivation;
+  quint64 _lastActivation;
+
+  std::vector<Keyframe> keyframes;
+  quint64 keyframeInterval;
+
+  std::vector<Count*> _counts;
+  std::vector<Measure*> _measures;
+};
+
+#endif  // AMOEBOTSIM_CORE_REPLAYSYSTEM_H_
@@ -0,0 +1,360 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/shapeanalysis.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <QThread>
+#include <QtAlgorithms>
+#include <QtConcurrent>
+
+namespace {
+
+// Bands with fewer rows than this are not worth handing to another thread.
+const int minRowsPerBand = 64;
+
+// A maximal run of nodes (minX + begin, y), ..., (minX + end, y) in some row y.
+struct Run {
+    int begin;
+    int end;
+};
+
+// A range [first, last) of rows labeled by a single thread.
+struct Band {
+    int first;
+    int last;
+};
+
+// Labels the runs of either the occupied (background = false) or unoccupied
+// (background = true) nodes of a grid. Runs are indexed row by row and, within
+// a row, from left to right. Every union links the larger root to the smaller
+// one, so parents always have smaller indices than their children; this keeps
+// the unions of different bands from touching each other's runs and lets
+// flatten() compress all paths in a single forward pass.
+class RunLabeling {
+public:
+    RunLabeling(const OccupancyGrid& grid, bool background);
+
+    int numLabels() const;
+    int label(int run) const;
+
+    const Run& run(int index) const;
+    int firstRun(int row) const;
+    int lastRun(int row) const;
+    const std::vector<Band>& bands() const;
+
+private:
+    void extractRuns(int row, std::vector<Run>& out) const;
+    void mergeRows(int row);
+    int find(int run);
+    void unite(int a, int b);
+    void flatten();
+
+    const OccupancyGrid& grid;
+    const bool background;
+    const int height;
+    std::vector<Band> _bands;
+    std::vector<Run> runs;
+    std::vector<int> rowOffsets;
+    std::vector<int> parent;
+};
+
+RunLabeling::RunLabeling(const OccupancyGrid& grid, bool background)
+    : grid(grid)
+    , background(background)
+    , height(grid.maxY() - grid.minY() + 1)
+{
+    Q_ASSERT(!grid.isSparse());
+    const int numBands = std::max(1, std::min(QThread::idealThreadCount(),
+        height / minRowsPerBand));
+    for (int i = 0; i < numBands; ++i) {
+        _bands.push_back({ height * i / numBands, height * (i + 1) / numBands });
+    }
+
+    // Extract the runs of every row, then concatenate them.
+    std::vector<std::vector<Run>> rowRuns(height);
+    auto extractBand = [this, &rowRuns](const Band& band) {
+        for (int row = band.first; row < band.last; ++row) {
+            extractRuns(row, rowRuns[row]);
+        }
+    };
+    if (numBands > 1) {
+        QtConcurrent::blockingMap(_bands, extractBand);
+    } else {
+        extractBand(_bands.front());
+    }
+
+    rowOffsets.resize(height + 1, 0);
+    for (int row = 0; row < height; ++row) {
+        rowOffsets[row + 1] = rowOffsets[row] + static_cast<int>(rowRuns[row].size());
+    }
+    runs.reserve(rowOffsets.back());
+    for (const auto& r : rowRuns) {
+        runs.insert(runs.end(), r.begin(), r.end());
+    }
+    parent.resize(runs.size());
+    for (size_t i = 0; i < parent.size(); ++i) {
+        parent[i] = static_cast<int>(i);
+    }
+
+    // Merge the runs of consecutive rows within each band in parallel, then
+    // merge across the seams between bands.
+    auto mergeBand = [this](const Band& band) {
+        for (int row = band.first; row + 1 < band.last; ++row) {
+            mergeRows(row);
+        }
+    };
+    if (numBands > 1) {
+        QtConcurrent::blockingMap(_bands, mergeBand);
+    } else {
+        mergeBand(_bands.front());
+    }
+    for (int i = 1; i < numBands; ++i) {
+        mergeRows(_bands[i].first - 1);
+    }
+
+    flatten();
+}
+
+int RunLabeling::numLabels() const
+{
+    int count = 0;
+    for (size_t i = 0; i < parent.size(); ++i) {
+        if (parent[i] == static_cast<int>(i)) {
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+int RunLabeling::label(int run) const
+{
+    return parent[run];
+}
+
+const Run& RunLabeling::run(int index) const
+{
+    return runs[index];
+}
+
+int RunLabeling::firstRun(int row) const
+{
+    return rowOffsets[row];
+}
+
+int RunLabeling::lastRun(int row) const
+{
+    return rowOffsets[row + 1];
+}
+
+const std::vector<Band>& RunLabeling::bands() const
+{
+    return _bands;
+}
+
+void RunLabeling::extractRuns(int row, std::vector<Run>& out) const
+{
+    const quint64* words = grid.row(grid.minY() + row);
+    const int numWords = grid.wordsPerRow();
+    const int lastBits = (grid.maxX() - grid.minX() + 1) % 64;
+    const quint64 lastMask = (lastBits == 0) ? ~quint64(0) : (quint64(1) << lastBits) - 1;
+
+    for (int i = 0; i < numWords; ++i) {
+        quint64 word = background ? ~words[i] : words[i];
+        if (i == numWords - 1) {
+            word &= lastMask;
+        }
+
+        // Peel off the runs of set bits in this word; a run starting at bit 0
+        // continues one that ended at bit 63 of the previous word.
+        while (word != 0) {
+            const int start = qCountTrailingZeroBits(word);
+            const quint64 rest = ~(word >> start);
+            const int length = (rest == 0) ? 64 : qCountTrailingZeroBits(rest);
+            const int begin = 64 * i + start;
+            if (start == 0 && !out.empty() && out.back().end == begin - 1) {
+                out.back().end = begin + length - 1;
+            } else {
+                out.push_back({ begin, begin + length - 1 });
+            }
+            word = (start + length == 64) ? 0 : word & (~quint64(0) << (start + length));
+        }
+    }
+}
+
+void RunLabeling::mergeRows(int row)
+{
+    // Node (x, y) is adjacent to (x, y + 1) and (x - 1, y + 1), so a run
+    // [a, b] of row y touches a run [c, d] of row y + 1 iff c <= b and d >= a - 1.
+    int j = rowOffsets[row + 1];
+    const int jEnd = rowOffsets[row + 2];
+    for (int i = rowOffsets[row]; i < rowOffsets[row + 1]; ++i) {
+        while (j < jEnd && runs[j].end < runs[i].begin - 1) {
+            ++j;
+        }
+        for (int k = j; k < jEnd && runs[k].begin <= runs[i].end; ++k) {
+            unite(i, k);
+        }
+    }
+}
+
+int RunLabeling::find(int run)
+{
+    while (parent[run] != run) {
+        parent[run] = parent[parent[run]];
+        run = parent[run];
+    }
+
+    return run;
+}
+
+void RunLabeling::unite(int a, int b)
+{
+    a = find(a);
+    b = find(b);
+    if (a < b) {
+        parent[b] = a;
+    } else if (b < a) {
+        parent[a] = b;
+    }
+}
+
+void RunLabeling::flatten()
+{
+    for (size_t i = 0; i < parent.size(); ++i) {
+        parent[i] = parent[parent[i]];
+    }
+}
+
+// Returns the grid padded by one unoccupied node on every side, so that the
+// unoccupied nodes along its border all belong to the unbounded component.
+OccupancyGrid padded(const OccupancyGrid& grid)
+{
+    return grid.window(grid.minX() - 1, grid.minY() - 1, grid.maxX() + 1,
+        grid.maxY() + 1);
+}
+
+// Sets the bits begin, ..., end of the given row.
+void setBits(quint64* row, int begin, int end)
+{
+    for (int i = begin / 64; i <= end / 64; ++i) {
+        const int lo = std::max(begin, 64 * i) - 64 * i;
+        const int hi = std::min(end, 64 * i + 63) - 64 * i;
+        const quint64 upper = (hi == 63) ? ~quint64(0) : (quint64(1) << (hi + 1)) - 1;
+        row[i] |= upper & (~quint64(0) << lo);
+    }
+}
+
+} // namespace
+
+int ShapeAnalysis::numComponents(const OccupancyGrid& grid)
+{
+    if (grid.wordsPerRow() == 0) {
+        return 0;
+    }
+
+    return RunLabeling(grid, false).numLabels();
+}
+
+int ShapeAnalysis::numHoles(const OccupancyGrid& grid)
+{
+    if (grid.wordsPerRow() == 0) {
+        return 0;
+    }
+
+    // The padding makes the unbounded component a single label.
+    return RunLabeling(padded(grid), true).numLabels() - 1;
+}
+
+quint64 ShapeAnalysis::outerBoundaryLength(const OccupancyGrid& grid)
+{
+    if (grid.wordsPerRow() == 0) {
+        return 0;
+    }
+
+    // The first run of the padded grid is its bottom row, which lies in the
+    // unbounded component; rasterize that component and count its edges to the
+    // occupied nodes.
+    const OccupancyGrid occupied = padded(grid);
+    const RunLabeling labeling(occupied, true);
+    const int outside = labeling.label(0);
+    OccupancyGrid exterior(occupied.minX(), occupied.minY(), occupied.maxX(),
+        occupied.maxY());
+    auto rasterizeBand = [&](const Band& band) {
+        for (int row = band.first; row < band.last; ++row) {
+            quint64* words = exterior.row(exterior.minY() + row);
+            for (int i = labeling.firstRun(row); i < labeling.lastRun(row); ++i) {
+                if (labeling.label(i) == outside) {
+                    setBits(words, labeling.run(i).begin, labeling.run(i).end);
+                }
+            }
+        }
+    };
+    std::vector<Band> bands = labeling.bands();
+    if (bands.size() > 1) {
+        QtConcurrent::blockingMap(bands, rasterizeBand);
+    } else {
+        rasterizeBand(bands.front());
+    }
+
+    return OccupancyGrid::edgeCount(occupied, exterior)
+        + OccupancyGrid::edgeCount(exterior, occupied);
+}
+
+ComponentMeasure::ComponentMeasure(const QString name, const unsigned int freq,
+    AmoebotSystem& system)
+    : Measure(name, freq)
+    , _system(system)
+{
+}
+
+double ComponentMeasure::calculate() const
+{
+    return ShapeAnalysis::numComponents(*_system.particleOccupancy());
+}
+
+std::function<double()> ComponentMeasure::capture() const
+{
+    const std::shared_ptr<const OccupancyGrid> grid = _system.particleOccupancy();
+    return [grid]() { return static_cast<double>(ShapeAnalysis::numComponents(*grid)); };
+}
+
+HoleMeasure::HoleMeasure(const QString name, const unsigned int freq,
+    AmoebotSystem& system)
+    : Measure(name, freq)
+    , _system(system)
+{
+}
+
+double HoleMeasure::calculate() const
+{
+    return ShapeAnalysis::numHoles(*_system.particleOccupancy());
+}
+
+std::function<double()> HoleMeasure::capture() const
+{
+    const std::shared_ptr<const OccupancyGrid> grid = _system.particleOccupancy();
+    return [grid]() { return static_cast<double>(ShapeAnalysis::numHoles(*grid)); };
+}
+
+OuterBoundaryMeasure::OuterBoundaryMeasure(const QString name,
+    const unsigned int freq, AmoebotSystem& system)
+    : Measure(name, freq)
+    , _system(system)
+{
+}
+
+double OuterBoundaryMeasure::calculate() const
+{
+    return ShapeAnalysis::outerBoundaryLength(*_system.particleOccupancy());
+}
+
+std::function<double()> OuterBoundaryMeasure::capture() const
+{
+    const std::shared_ptr<const OccupancyGrid> grid = _system.particleOccupancy();
+    return [grid]() { return static_cast<double>(ShapeAnalysis::outerBoundaryLength(*grid)); };
+}
@@ -0,0 +1,91 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines structural analyses of a set of nodes given as an OccupancyGrid: the
+// number of connected components, the number of holes (maximal connected
+// regions of unoccupied nodes enclosed by occupied ones), and the length of the
+// outer boundary. All of them label the maximal horizontal runs of (un)occupied
+// nodes instead of single nodes, so a row is scanned word by word and only the
+// runs are merged via union-find. Rows are split into bands that are labeled in
+// parallel, after which the seams between consecutive bands are merged. The
+// analyses need the rows of a dense grid (see OccupancyGrid::isSparse).
+//
+// The measures at the bottom of this file apply these analyses to the nodes
+// occupied by the particles of an AmoebotSystem (heads and tails alike), so any
+// algorithm can register them. They capture the system's shared occupancy grid,
+// so the analyses can run off the simulation thread (see Measure::capture).
+
+#ifndef AMOEBOTSIM_CORE_SHAPEANALYSIS_H_
+#define AMOEBOTSIM_CORE_SHAPEANALYSIS_H_
+
+#include <functional>
+#include <memory>
+
+#include <QString>
+#include <QtGlobal>
+
+#include "core/amoebotsystem.h"
+#include "core/metric.h"
+#include "core/occupancygrid.h"
+
+class ShapeAnalysis {
+public:
+    // Returns the number of connected components of the nodes in the grid.
+    static int numComponents(const OccupancyGrid& grid);
+
+    // Returns the number of holes of the nodes in the grid, i.e., the number of
+    // connected components of unoccupied nodes other than the unbounded one.
+    static int numHoles(const OccupancyGrid& grid);
+
+    // Returns the length of the outer boundary of the nodes in the grid, i.e.,
+    // the number of lattice edges between a node in the grid and a node of the
+    // unbounded component of unoccupied nodes. Edges bordering holes are not
+    // counted.
+    static quint64 outerBoundaryLength(const OccupancyGrid& grid);
+};
+
+class ComponentMeasure : public Measure {
+public:
+    // Constructs a measure of the number of connected components formed by the
+    // nodes occupied by the particles of the given system.
+    ComponentMeasure(const QString name, const unsigned int freq,
+        AmoebotSystem& system);
+
+    double calculate() const final;
+    std::function<double()> capture() const final;
+
+protected:
+    AmoebotSystem& _system;
+};
+
+class HoleMeasure : public Measure {
+public:
+    // Constructs a measure of the number of holes enclosed by the nodes
+    // occupied by the particles of the given system.
+    HoleMeasure(const QString name, const unsigned int freq,
+        AmoebotSystem& system);
+
+    double calculate() const final;
+    std::function<double()> capture() const final;
+
+protected:
+    AmoebotSystem& _system;
+};
+
+class OuterBoundaryMeasure : public Measure {
+public:
+    // Constructs a measure of the outer boundary length (see
+    // ShapeAnalysis::outerBoundaryLength) of the nodes occupied by the
+    // particles of the given system.
+    OuterBoundaryMeasure(const QString name, const unsigned int freq,
+        AmoebotSystem& system);
+
+    double calculate() const final;
+    std::function<double()> capture() const final;
+
+protected:
+    AmoebotSystem& _system;
+};
+
+#endif // AMOEBOTSIM_CORE_SHAPEANALYSIS_H_
@@ -4,23 +4,38 @@
 
 #include "core/simulator.h"
 
+#include <vector>
+
 #include <QCoreApplication>
 #include <QDateTime>
 #include <QDir>
 #include <QFile>
 #include <QMutexLocker>
+#include <QStringList>
 #include <QTextStream>
 #include <QtGlobal>
 
 #include "core/metric.h"
+#include "core/replaysystem.h"
+
+constexpr int Simulator::metricsInterval;
 
 Simulator::Simulator() {
   stepTimer.setInterval(100);
-  connect(&stepTimer, &QTimer::timeout, this, &Simulator::step);
+  connect(&stepTimer, &QTimer::timeout, [this]() {
+    activate((stepTimer.interval() == 0) ? governor.batchSize() : 1);
+  });
+
+  metricsTimer.setSingleShot(true);
+  connect(&metricsTimer, &QTimer::timeout, [this]() {
+    QMutexLocker locker(&system->mutex);
+    publishMetrics();
+  });
 }
 
 Simulator::~Simulator() {
   stepTimer.stop();
+  metricsTimer.stop();
 }
 
 void Simulator::setSystem(std::shared_ptr<System> _system) {
@@ -28,6 +43,10 @@ void Simulator::setSystem(std::shared_ptr<System> _system) {
   emit stopped();
 
   system = _system;
+  if (system) {
+    QMutexLocker locker(&system->mutex);
+    publishMetrics();
+  }
   emit systemChanged(system);
 }
 
@@ -35,6 +54,10 @@ std::shared_ptr<System> Simulator::getSystem() const {
   return system;
 }
 
+PerformanceGovernor& Simulator::getGovernor() {
+  return governor;
+}
+
 void Simulator::start() {
   stepTimer.start();
   emit started();
@@ -46,17 +69,13 @@ void Simulator::stop() {
 }
 
 void Simulator::step() {
-  QMutexLocker locker(&system->mutex);
-  system->activate();
-
-  if (system->hasTerminated()) {
-    stop();
-  }
+  activate(1);
 }
 
 void Simulator::stepForParticleAt(Node node) {
   QMutexLocker locker(&system->mutex);
   system->activateParticleAt(node);
+  publishMetricsIfDue();
 }
 
 void Simulator::setStepDuration(int ms) {
@@ -66,9 +85,24 @@ void Simulator::setStepDuration(int ms) {
 
 void Simulator::runUntilTermination() {
   QMutexLocker locker(&system->mutex);
+  QElapsedTimer batchTimer;
+  batchTimer.start();
+  quint64 i = 0;
   while (!system->hasTerminated()) {
     system->activate();
+    if (++i % 1024 == 0) {
+      governor.batchSimulated(1024, batchTimer.nsecsElapsed() / 1e6);
+      batchTimer.restart();
+      publishMetricsIfDue();
+    }
   }
+  governor.batchSimulated(i % 1024, batchTimer.nsecsElapsed() / 1e6);
+  system->syncMeasures();
+  publishMetrics();
+}
+
+void Simulator::setPerformanceTarget(int target) {
+  governor.setTarget(static_cast<PerformanceGovernor::Target>(target));
 }
 
 int Simulator::numParticles() const {
@@ -81,22 +115,36 @@ int Simulator::numObjects() const {
   return system->numObjects();
 }
 
-QVariant Simulator::metrics() const {
-  QMutexLocker locker(&system->mutex);
-  QList<QVariant> metricsData;
-  for (const auto& c : system->getCounts()) {
-    metricsData.push_back(QVariant({c->_name, c->_value}));
+QVariant Simulator::metrics(quint64* sequence) const {
+  // Odd numbers are never the number of a published summary.
+  quint64 number = (sequence != nullptr) ? *sequence : 1;
+  QStringList names;
+  std::vector<double> values;
+  if (!metricsSummary.read(number, names, values)) {
+    return QVariant();
   }
-  for (const auto& m : system->getMeasures()) {
-    if (m->_history.empty()) {
-      metricsData.push_back(QVariant({m->_name, 0.0}));
-    } else {
-      metricsData.push_back(QVariant({m->_name, m->_history.back()}));
-    }
+  if (sequence != nullptr) {
+    *sequence = number;
+  }
+
+  QList<QVariant> metricsData;
+  for (int i = 0; i < names.size(); ++i) {
+    metricsData.push_back(QVariant({names[i], values[i]}));
   }
   return QVariant::fromValue(metricsData);
 }
 
+void Simulator::setAsyncMeasures(bool async) {
+  QMutexLocker locker(&system->mutex);
+  system->setAsyncMeasures(async);
+}
+
+void Simulator::setMetricRetention(Retention retention, size_t capacity) {
+  QMutexLocker locker(&system->mutex);
+  system->syncMeasures();
+  system->setMetricRetention(retention, capacity);
+}
+
 void Simulator::exportMetrics() {
   QMutexLocker locker(&system->mutex);
   QDir metricsDir(QCoreApplication::applicationDirPath());
@@ -113,11 +161,92 @@ void Simulator::exportMetrics() {
     return;
   }
   QTextStream outStream(&outFile);
-  outStream << system->metricsAsJSON();
+  system->syncMeasures();
+  system->writeMetricsJSON(outStream);
   outFile.close();
 }
 
-void Simulator::saveScreenshotSetup(const QString filePath) {
-  emit systemChanged(system);
-  emit saveScreenshot(filePath);
+bool Simulator::streamMetrics(const QString filePath) {
+  QMutexLocker locker(&system->mutex);
+  return system->streamMetrics(filePath);
+}
+
+bool Simulator::recordMoves(const QString filePath) {
+  QMutexLocker locker(&system->mutex);
+  return system->recordMoves(filePath);
+}
+
+bool Simulator::recordSnapshots(const QString filePath, int everyRounds) {
+  QMutexLocker locker(&system->mutex);
+  return system->recordSnapshots(filePath, everyRounds);
+}
+
+bool Simulator::publishLiveState(const QString filePath, int everyRounds) {
+  QMutexLocker locker(&system->mutex);
+  return system->publishLiveState(filePath, everyRounds);
+}
+
+bool Simulator::saveCheckpoint(const QString filePath) {
+  QMutexLocker locker(&system->mutex);
+  return system->saveCheckpoint(filePath);
+}
+
+bool Simulator::loadCheckpoint(const QString filePath) {
+  QMutexLocker locker(&system->mutex);
+  const bool loaded = system->loadCheckpoint(filePath);
+  publishMetricsIfDue();
+  return loaded;
+}
+
+bool Simulator::saveConfiguration(const QString filePath) {
+  QMutexLocker locker(&system->mutex);
+  return system->saveConfiguration(filePath);
+}
+
+std::shared_ptr<System> Simulator::forkSystem() {
+  QMutexLocker locker(&system->mutex);
+  return system->fork();
+}
+
+bool Simulator::seekReplay(quint64 activation) {
+  QMutexLocker locker(&system->mutex);
+  auto replay = std::dynamic_pointer_cast<ReplaySystem>(system);
+  if (replay == nullptr) {
+    return false;
+  }
+  replay->seek(activation);
+  publishMetricsIfDue();
+  return true;
+}
+
+void Simulator::activate(quint64 maxActivations) {
+  QMutexLocker locker(&system->mutex);
+  QElapsedTimer batchTimer;
+  batchTimer.start();
+  quint64 numActivations = 0;
+  do {
+    system->activate();
+    ++numActivations;
+  } while (numActivations < maxActivations && !system->hasTerminated());
+  governor.batchSimulated(numActivations, batchTimer.nsecsElapsed() / 1e6);
+  publishMetricsIfDue();
+
+  if (system->hasTerminated()) {
+    stop();
+  }
+}
+
+void Simulator::publishMetrics() {
+  metricsTimer.stop();
+  metricsSummary.publish(*system);
+  sinceMetricsPublished.start();
+}
+
+void Simulator::publishMetricsIfDue() {
+  if (!sinceMetricsPublished.isValid()
+      || sinceMetricsPublished.elapsed() >= metricsInterval) {
+    publishMetrics();
+  } else if (!metricsTimer.isActive()) {
+    metricsTimer.start(metricsInterval - sinceMetricsPublished.elapsed());
+  }
 }
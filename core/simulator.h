@@ -7,10 +7,13 @@
 
 #include <memory>
 
+#include <QElapsedTimer>
 #include <QObject>
 #include <QTimer>
 #include <QVariant>
 
+#include "core/metricssummary.h"
+#include "core/performancegovernor.h"
 #include "core/system.h"
 
 class Simulator : public QObject {
@@ -23,10 +26,15 @@ class Simulator : public QObject {
   void setSystem(std::shared_ptr<System> _system);
   std::shared_ptr<System> getSystem() const;
 
+  // Returns the governor that balances the simulation against drawing the
+  // view (see core/performancegovernor.h). While the simulator runs with a step
+  // duration of 0, every step runs as many activations as the governor's batch
+  // size; otherwise, it runs a single one.
+  PerformanceGovernor& getGovernor();
+
  signals:
   void systemChanged(std::shared_ptr<System> _system);
   void stepDurationChanged(int ms);
-  void saveScreenshot(const QString filePath);
 
   void started();
   void stopped();
@@ -44,23 +52,89 @@ class Simulator : public QObject {
   void setStepDuration(int ms);
   void runUntilTermination();
 
-  // Responds to GUI and script requests for statistics and metrics.
+  // Sets the target of the governor to the given PerformanceGovernor::Target.
+  void setPerformanceTarget(int target);
+
+  // Responds to GUI and script requests for statistics and metrics. metrics
+  // returns the latest metrics summary the simulator published (see
+  // core/metricssummary.h) as a list of [name, value] pairs without locking
+  // the system, so it can be called from any thread; summaries are published
+  // at most every metricsInterval milliseconds while the system changes, and
+  // the last one within metricsInterval after it stops changing. Given a
+  // sequence number, metrics returns an invalid QVariant if no summary was
+  // published since the one with that number, and otherwise sets it to the
+  // number of the returned summary. setAsyncMeasures enables or disables
+  // asynchronous measure evaluation for the current system (see
+  // AmoebotSystem::setAsyncMeasures), and setMetricRetention bounds its metric
+  // histories (see core/metrichistory.h).
+  static constexpr int metricsInterval = 50;
   int numParticles() const;
   int numObjects() const;
-  QVariant metrics() const;
+  QVariant metrics(quint64* sequence = nullptr) const;
+  void setAsyncMeasures(bool async);
+  void setMetricRetention(Retention retention, size_t capacity);
 
   // Responds to the exportMetrics signal from the GUI and scripts by creating
   // an output file with a unique timestamp (to avoid accidental overwrites) and
   // writing the metrics JSON to it.
   void exportMetrics();
 
-  // Emits a signal that updates the system visually, followed by a signal that
-  // takes a screenshot of the result.
-  void saveScreenshotSetup(const QString filePath);
+  // Starts (or, given an empty path, stops) streaming the current system's
+  // metrics to a binary file as they are recorded; see core/metricswriter.h.
+  // Returns whether the system is streaming.
+  bool streamMetrics(const QString filePath);
+
+  // Starts (or, given an empty path, stops) recording the particle movements
+  // of the current system to a binary file; see System::recordMoves.
+  bool recordMoves(const QString filePath);
+
+  // Starts (or, given an empty path, stops) writing periodic snapshots of the
+  // current system's configuration to a binary file; see
+  // System::recordSnapshots.
+  bool recordSnapshots(const QString filePath, int everyRounds);
+
+  // Starts (or, given an empty path, stops) publishing the live state of the
+  // current system to a memory-mapped file; see System::publishLiveState.
+  // Readers of the file never lock the simulator.
+  bool publishLiveState(const QString filePath, int everyRounds);
+
+  // Save the current system's complete state to a checkpoint file and restore
+  // it from one, respectively; see AmoebotSystem::saveCheckpoint. Both return
+  // whether they succeeded.
+  bool saveCheckpoint(const QString filePath);
+  bool loadCheckpoint(const QString filePath);
+
+  // Saves the positions of the current system's particles and objects to a
+  // configuration file; see System::saveConfiguration.
+  bool saveConfiguration(const QString filePath);
+
+  // Returns an independent copy of the current system that shares only its
+  // metric histories with it, or nullptr if its algorithm does not support
+  // forking; see System::fork.
+  std::shared_ptr<System> forkSystem();
+
+  // Moves the current system to the given activation index if it is a replay
+  // of a move log; returns false otherwise. See ReplaySystem::seek.
+  bool seekReplay(quint64 activation);
 
  protected:
+  // Runs up to the given number of activations, stopping early once the system
+  // has terminated, and reports them to the governor.
+  void activate(quint64 maxActivations);
+
+  // Publish the metrics summary of the system, which must be locked, now or,
+  // if the last one was published less than metricsInterval milliseconds ago,
+  // once that much time has passed.
+  void publishMetrics();
+  void publishMetricsIfDue();
+
   QTimer stepTimer;
   std::shared_ptr<System> system;
+  PerformanceGovernor governor;
+
+  MetricsSummary metricsSummary;
+  QElapsedTimer sinceMetricsPublished;
+  QTimer metricsTimer;
 };
 
 #endif  // AMOEBOTSIM_CORE_SIMULATOR_H_
@@ -0,0 +1,471 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/snapshotwriter.h"
+
+#include <cstring>
+
+#include <QDataStream>
+#include <QMutexLocker>
+#include <QThread>
+#include <QtEndian>
+
+namespace {
+
+const quint32 formatVersion = 1;
+const qint64 headerSize = 8;
+const qint64 recordHeaderSize = 13;
+const qint64 indexEntrySize = 17;
+const qint64 trailerSize = 20;
+
+const quint8 keyframeKind = 0;
+const quint8 deltaKind = 1;
+
+// Every keyframeInterval-th record is a keyframe, and appending waits while
+// more than maxQueuedSnapshots snapshots are waiting to be written.
+const quint32 keyframeInterval = 64;
+const size_t maxQueuedSnapshots = 2;
+
+void putVarint(QByteArray& data, quint64 value)
+{
+    while (value >= 0x80) {
+        data.append(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    data.append(static_cast<char>(value));
+}
+
+void putSignedVarint(QByteArray& data, qint64 value)
+{
+    putVarint(data, (value >= 0) ? 2 * static_cast<quint64>(value)
+                                 : 2 * static_cast<quint64>(-(value + 1)) + 1);
+}
+
+bool getVarint(const uchar*& pos, const uchar* end, quint64& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < end; shift += 7) {
+        const uchar byte = *pos++;
+        value |= static_cast<quint64>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool getSignedVarint(const uchar*& pos, const uchar* end, qint64& value)
+{
+    quint64 zigzag;
+    if (!getVarint(pos, end, zigzag)) {
+        return false;
+    }
+    value = (zigzag & 1) ? -static_cast<qint64>(zigzag >> 1) - 1
+                         : static_cast<qint64>(zigzag >> 1);
+    return true;
+}
+
+// Reads a node given as offsets from prev, followed by a byte.
+bool getNode(const uchar*& pos, const uchar* end, const Node& prev, Node& node,
+    uchar& byte)
+{
+    qint64 dx, dy;
+    if (!getSignedVarint(pos, end, dx) || !getSignedVarint(pos, end, dy)
+        || pos >= end) {
+        return false;
+    }
+    node = Node(prev.x + static_cast<int>(dx), prev.y + static_cast<int>(dy));
+    byte = *pos++;
+    return true;
+}
+
+bool sameObjects(const std::vector<Object>& a, const std::vector<Object>& b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i]._node != b[i]._node || a[i]._isTraversable != b[i]._isTraversable
+            || a[i]._anchor != b[i]._anchor) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QByteArray encodeKeyframe(const Configuration& config)
+{
+    QByteArray data;
+    data.reserve(static_cast<int>(4 * (config.particles.size() + config.objects.size())) + 20);
+    putVarint(data, config.particles.size());
+    putVarint(data, config.objects.size());
+    Node prev;
+    for (const auto& p : config.particles) {
+        putSignedVarint(data, p.head.x - prev.x);
+        putSignedVarint(data, p.head.y - prev.y);
+        data.append(static_cast<char>(p.globalTailDir + 1));
+        prev = p.head;
+    }
+    prev = Node();
+    for (const auto& o : config.objects) {
+        putSignedVarint(data, o._node.x - prev.x);
+        putSignedVarint(data, o._node.y - prev.y);
+        data.append(static_cast<char>((o._isTraversable ? 1 : 0) | (o._anchor ? 2 : 0)));
+        prev = o._node;
+    }
+
+    return data;
+}
+
+// Encodes the particles of config that moved since previous, which has as
+// many particles.
+QByteArray encodeDelta(const Configuration& previous, const Configuration& config)
+{
+    QByteArray moves;
+    quint64 numMoved = 0;
+    size_t lastMoved = 0;
+    for (size_t i = 0; i < config.particles.size(); ++i) {
+        const auto& p = config.particles[i];
+        const auto& old = previous.particles[i];
+        if (p.head != old.head || p.globalTailDir != old.globalTailDir) {
+            putVarint(moves, (numMoved == 0) ? i : i - lastMoved);
+            putSignedVarint(moves, p.head.x - old.head.x);
+            putSignedVarint(moves, p.head.y - old.head.y);
+            moves.append(static_cast<char>(p.globalTailDir + 1));
+            lastMoved = i;
+            ++numMoved;
+        }
+    }
+
+    QByteArray data;
+    data.reserve(moves.size() + 10);
+    putVarint(data, numMoved);
+    data.append(moves);
+    return data;
+}
+
+} // namespace
+
+class SnapshotWriter::WriteThread : public QThread {
+public:
+    explicit WriteThread(SnapshotWriter& writer)
+        : writer(writer)
+    {
+    }
+
+protected:
+    void run() override
+    {
+        writer.writeSnapshots();
+    }
+
+private:
+    SnapshotWriter& writer;
+};
+
+SnapshotWriter::SnapshotWriter(const QString filePath)
+    : file(filePath)
+    , numDeltas(0)
+    , stopping(false)
+{
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out.writeRawData("AMBS", 4);
+    out << formatVersion;
+    if (out.status() != QDataStream::Ok) {
+        return;
+    }
+
+    thread.reset(new WriteThread(*this));
+    thread->start();
+}
+
+SnapshotWriter::~SnapshotWriter()
+{
+    if (thread) {
+        mutex.lock();
+        stopping = true;
+        queueNotEmpty.wakeAll();
+        mutex.unlock();
+        thread->wait();
+
+        QDataStream out(&file);
+        out.setByteOrder(QDataStream::LittleEndian);
+        const quint64 indexOffset = static_cast<quint64>(file.pos());
+        for (const auto& entry : index) {
+            out << entry.offset << entry.round << entry.kind;
+        }
+        out << static_cast<quint64>(index.size()) << indexOffset;
+        out.writeRawData("AMBI", 4);
+    }
+    file.close();
+}
+
+bool SnapshotWriter::isOpen() const
+{
+    return thread != nullptr;
+}
+
+void SnapshotWriter::append(quint64 round, Configuration&& config)
+{
+    QMutexLocker locker(&mutex);
+    while (queue.size() >= maxQueuedSnapshots) {
+        queueNotFull.wait(&mutex);
+    }
+    queue.push_back(Snapshot());
+    queue.back().round = round;
+    queue.back().config = std::move(config);
+    queueNotEmpty.wakeOne();
+}
+
+bool SnapshotWriter::render(const QString binaryPath, quint64 index,
+    const QString outPath)
+{
+    SnapshotReader reader(binaryPath);
+    Configuration config;
+    return reader.isOpen() && reader.read(index, config) && config.save(outPath);
+}
+
+void SnapshotWriter::writeSnapshots()
+{
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::LittleEndian);
+
+    QMutexLocker locker(&mutex);
+    while (true) {
+        while (queue.empty() && !stopping) {
+            queueNotEmpty.wait(&mutex);
+        }
+        if (queue.empty()) {
+            break;
+        }
+
+        Snapshot snapshot = std::move(queue.front());
+        queue.pop_front();
+        queueNotFull.wakeAll();
+
+        locker.unlock();
+        const Configuration& config = snapshot.config;
+        quint8 kind = deltaKind;
+        if (index.empty() || numDeltas + 1 >= keyframeInterval
+            || config.particles.size() != previous.particles.size()
+            || !sameObjects(config.objects, previous.objects)) {
+            kind = keyframeKind;
+        }
+        const QByteArray payload = qCompress((kind == keyframeKind)
+                ? encodeKeyframe(config)
+                : encodeDelta(previous, config));
+        numDeltas = (kind == keyframeKind) ? 0 : numDeltas + 1;
+
+        index.push_back({static_cast<quint64>(file.pos()), snapshot.round, kind});
+        out << kind << snapshot.round << static_cast<quint32>(payload.size());
+        out.writeRawData(payload.constData(), payload.size());
+        previous = std::move(snapshot.config);
+        locker.relock();
+    }
+}
+
+SnapshotReader::SnapshotReader(const QString filePath)
+    : file(filePath)
+    , valid(false)
+    , currentIndex(0)
+{
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    const QByteArray header = file.read(headerSize);
+    if (header.size() != headerSize || std::memcmp(header.constData(), "AMBS", 4) != 0
+        || qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(header.constData()) + 4)
+            != formatVersion) {
+        return;
+    }
+
+    valid = (readIndex() || scanIndex())
+        && (index.empty() || index.front().kind == keyframeKind);
+    currentIndex = index.size();
+}
+
+bool SnapshotReader::isOpen() const
+{
+    return valid;
+}
+
+quint64 SnapshotReader::size() const
+{
+    return index.size();
+}
+
+quint64 SnapshotReader::round(quint64 index) const
+{
+    Q_ASSERT(index < this->index.size());
+    return this->index[index].round;
+}
+
+bool SnapshotReader::read(quint64 index, Configuration& config)
+{
+    if (!valid || index >= this->index.size()) {
+        return false;
+    }
+
+    quint64 keyframe = index;
+    while (this->index[keyframe].kind != keyframeKind) {
+        --keyframe;
+    }
+    quint64 next = keyframe;
+    if (currentIndex < this->index.size() && keyframe <= currentIndex
+        && currentIndex <= index) {
+        next = currentIndex + 1;
+    }
+    for (; next <= index; ++next) {
+        if (!apply(next)) {
+            current = Configuration();
+            currentIndex = this->index.size();
+            return false;
+        }
+        currentIndex = next;
+    }
+
+    config = current;
+    return true;
+}
+
+bool SnapshotReader::readIndex()
+{
+    const qint64 fileSize = file.size();
+    if (fileSize < headerSize + trailerSize || !file.seek(fileSize - trailerSize)) {
+        return false;
+    }
+    const QByteArray trailer = file.read(trailerSize);
+    const uchar* data = reinterpret_cast<const uchar*>(trailer.constData());
+    if (trailer.size() != trailerSize || std::memcmp(data + 16, "AMBI", 4) != 0) {
+        return false;
+    }
+    const quint64 numEntries = qFromLittleEndian<quint64>(data);
+    const quint64 indexOffset = qFromLittleEndian<quint64>(data + 8);
+    if (indexOffset < static_cast<quint64>(headerSize)
+        || indexOffset > static_cast<quint64>(fileSize - trailerSize)
+        || numEntries != (fileSize - trailerSize - indexOffset) / indexEntrySize
+        || numEntries * indexEntrySize != fileSize - trailerSize - indexOffset
+        || !file.seek(static_cast<qint64>(indexOffset))) {
+        return false;
+    }
+
+    const QByteArray entries = file.read(static_cast<qint64>(numEntries * indexEntrySize));
+    if (entries.size() != static_cast<int>(numEntries * indexEntrySize)) {
+        return false;
+    }
+    data = reinterpret_cast<const uchar*>(entries.constData());
+    index.reserve(numEntries);
+    for (quint64 i = 0; i < numEntries; ++i, data += indexEntrySize) {
+        const quint64 offset = qFromLittleEndian<quint64>(data);
+        if (offset < static_cast<quint64>(headerSize) || offset >= indexOffset
+            || data[16] > deltaKind) {
+            index.clear();
+            return false;
+        }
+        index.push_back({static_cast<qint64>(offset), qFromLittleEndian<quint64>(data + 8),
+            data[16]});
+    }
+
+    return true;
+}
+
+bool SnapshotReader::scanIndex()
+{
+    const qint64 fileSize = file.size();
+    qint64 offset = headerSize;
+    while (offset + recordHeaderSize <= fileSize && file.seek(offset)) {
+        const QByteArray header = file.read(recordHeaderSize);
+        const uchar* data = reinterpret_cast<const uchar*>(header.constData());
+        if (header.size() != recordHeaderSize || data[0] > deltaKind) {
+            break;
+        }
+        const qint64 end = offset + recordHeaderSize + qFromLittleEndian<quint32>(data + 9);
+        if (end > fileSize) {
+            // The last record of a crashed run may be incomplete.
+            break;
+        }
+        index.push_back({offset, qFromLittleEndian<quint64>(data + 1), data[0]});
+        offset = end;
+    }
+
+    return true;
+}
+
+bool SnapshotReader::apply(quint64 index)
+{
+    const IndexEntry& entry = this->index[index];
+    if (!file.seek(entry.offset)) {
+        return false;
+    }
+    const QByteArray header = file.read(recordHeaderSize);
+    if (header.size() != recordHeaderSize || static_cast<quint8>(header[0]) != entry.kind) {
+        return false;
+    }
+    const quint32 size = qFromLittleEndian<quint32>(
+        reinterpret_cast<const uchar*>(header.constData()) + 9);
+    const QByteArray payload = qUncompress(file.read(size));
+    const uchar* pos = reinterpret_cast<const uchar*>(payload.constData());
+    const uchar* end = pos + payload.size();
+
+    quint64 numParticles, numObjects;
+    if (entry.kind == keyframeKind) {
+        // Each particle and object takes at least three bytes.
+        if (!getVarint(pos, end, numParticles) || !getVarint(pos, end, numObjects)
+            || numParticles > static_cast<quint64>(end - pos) / 3
+            || numObjects > static_cast<quint64>(end - pos) / 3) {
+            return false;
+        }
+        current.particles.clear();
+        current.particles.reserve(numParticles);
+        Node prev;
+        uchar byte;
+        for (quint64 i = 0; i < numParticles; ++i) {
+            Node head;
+            if (!getNode(pos, end, prev, head, byte) || byte > 6) {
+                return false;
+            }
+            current.particles.push_back({head, byte - 1});
+            prev = head;
+        }
+        current.objects.clear();
+        current.objects.reserve(numObjects);
+        prev = Node();
+        for (quint64 i = 0; i < numObjects; ++i) {
+            Node node;
+            if (!getNode(pos, end, prev, node, byte)) {
+                return false;
+            }
+            current.objects.push_back(Object(node, byte & 1, byte & 2));
+            prev = node;
+        }
+    } else {
+        if (!getVarint(pos, end, numParticles)) {
+            return false;
+        }
+        quint64 i = 0;
+        uchar byte;
+        for (quint64 j = 0; j < numParticles; ++j) {
+            quint64 gap;
+            if (!getVarint(pos, end, gap) || (j > 0 && gap == 0)) {
+                return false;
+            }
+            i = (j == 0) ? gap : i + gap;
+            if (i >= current.particles.size()) {
+                return false;
+            }
+            auto& p = current.particles[i];
+            if (!getNode(pos, end, p.head, p.head, byte) || byte > 6) {
+                return false;
+            }
+            p.globalTailDir = byte - 1;
+        }
+    }
+
+    return pos == end;
+}
@@ -0,0 +1,153 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines a writer that streams periodic snapshots of a system's configuration
+// (see core/configuration.h) to a compressed file, and a reader that returns
+// any snapshot of such a file. Most snapshots are stored as a delta against
+// the previous one, listing only the particles that moved in between, and
+// every record is compressed with zlib (LZ77 and Huffman coding), so a
+// snapshot of a million particles that barely moved takes a few bytes per
+// moved particle. Encoding, compressing, and writing snapshots happens on a
+// background thread; if it falls behind by more than a few snapshots, taking
+// another one waits for it to catch up.
+//
+// All numbers are little-endian, as written by a QDataStream:
+//
+//   header:  "AMBS" (4 bytes), quint32 version (= 1).
+//   records: quint8 kind (0 = keyframe, 1 = delta), quint64 round, quint32
+//            size, followed by that many bytes of qCompress'ed payload.
+//   index:   written when the writer is closed: for each record, quint64
+//            offset of the record in the file, quint64 round, and quint8
+//            kind; then quint64 #records, quint64 offset of the index, and
+//            "AMBI".
+//
+// A keyframe payload holds a varint #particles and a varint #objects, then
+// for each particle its head as zigzag varint offsets from the previous
+// particle's head and a byte holding its global tail direction plus one, and
+// for each object its node in the same way and a byte of flags (1 =
+// traversable, 2 = anchor). A delta payload holds a varint #moved particles,
+// then for each moved particle the varint difference of its index from the
+// previous moved particle's (the first one's index itself), its head as
+// zigzag varint offsets from its previous head, and a byte holding its global
+// tail direction plus one. A keyframe is written instead of a delta for
+// every 64th record and whenever the number of particles or the objects have
+// changed, so reading any snapshot decodes at most 64 records. A file whose
+// writer was not closed (e.g., of a crashed run) has no index, and readers
+// index it by skipping from record to record instead.
+
+#ifndef AMOEBOTSIM_CORE_SNAPSHOTWRITER_H_
+#define AMOEBOTSIM_CORE_SNAPSHOTWRITER_H_
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <QWaitCondition>
+#include <QtGlobal>
+
+#include "core/configuration.h"
+
+class SnapshotWriter {
+public:
+    // Opens the given file and writes its header; check isOpen() for success.
+    explicit SnapshotWriter(const QString filePath);
+
+    // Writes all remaining snapshots and the index and closes the file.
+    ~SnapshotWriter();
+
+    bool isOpen() const;
+
+    // Appends a snapshot of the given configuration, taken at the given round,
+    // which is moved to the background thread. This is meant to be called
+    // from a single (the simulation) thread.
+    void append(quint64 round, Configuration&& config);
+
+    // Converts the snapshot at the given index of a snapshot file to a
+    // configuration file (see Configuration::save). Returns false if either
+    // file cannot be opened, the input is not a snapshot file, or it has no
+    // snapshot at that index.
+    static bool render(const QString binaryPath, quint64 index,
+        const QString outPath);
+
+private:
+    struct Snapshot {
+        quint64 round;
+        Configuration config;
+    };
+
+    struct IndexEntry {
+        quint64 offset;
+        quint64 round;
+        quint8 kind;
+    };
+
+    class WriteThread;
+
+    // Encodes, compresses, and writes queued snapshots until the writer stops.
+    void writeSnapshots();
+
+    QFile file;
+    std::vector<IndexEntry> index;
+
+    // The snapshot the next delta is encoded against, and the number of
+    // deltas written since the last keyframe; only used by the thread.
+    Configuration previous;
+    quint32 numDeltas;
+
+    QMutex mutex;
+    QWaitCondition queueNotEmpty;
+    QWaitCondition queueNotFull;
+    std::deque<Snapshot> queue;
+    bool stopping;
+    std::unique_ptr<WriteThread> thread;
+};
+
+class SnapshotReader {
+public:
+    // Opens a snapshot file and reads (or rebuilds) its index; check isOpen()
+    // for success.
+    explicit SnapshotReader(const QString filePath);
+
+    bool isOpen() const;
+
+    // Returns the number of snapshots in the file and the round the snapshot
+    // at the given index was taken at, respectively.
+    quint64 size() const;
+    quint64 round(quint64 index) const;
+
+    // Decodes the snapshot at the given index into config. Decoding starts at
+    // the last keyframe at or before it, unless the snapshot read last is
+    // between the two, so reading snapshots in order decodes each record once.
+    // Returns false if there is no such snapshot or the file is corrupt.
+    bool read(quint64 index, Configuration& config);
+
+private:
+    struct IndexEntry {
+        qint64 offset;
+        quint64 round;
+        quint8 kind;
+    };
+
+    // Index support. readIndex reads the index written by a closed writer,
+    // and scanIndex rebuilds it by skipping over the records; both return
+    // false if the file does not fit.
+    bool readIndex();
+    bool scanIndex();
+
+    // Reads the record at the given index and applies it to current.
+    bool apply(quint64 index);
+
+    QFile file;
+    bool valid;
+    std::vector<IndexEntry> index;
+
+    // The snapshot read last, at index currentIndex (index.size() if none).
+    Configuration current;
+    quint64 currentIndex;
+};
+
+#endif // AMOEBOTSIM_CORE_SNAPSHOTWRITER_H_
@@ -4,6 +4,20 @@
 
 #include "core/system.h"
 
+#include <atomic>
+
+// At most this many changed nodes are kept between two calls of takeChanges;
+// beyond that, redrawing everything is cheaper anyway.
+static constexpr size_t maxReportedChanges = 1 << 16;
+
+// Returns a render attribute cache or objects generation that no system has
+// used yet, so particles copied from one system (e.g., by fork) are stale in
+// another, and views notice when they are shown another system's objects.
+static quint64 newGeneration() {
+  static std::atomic<quint64> nextGeneration(1);
+  return nextGeneration++;
+}
+
 SystemIterator::SystemIterator(const System* system, int pos)
   : _pos(pos)
   , system(system) {}
@@ -21,6 +35,13 @@ const SystemIterator& SystemIterator::operator++() {
   return *this;
 }
 
+constexpr int System::changeRadius;
+
+System::System()
+  : allChanged(true),
+    attributesGeneration(newGeneration()),
+    objectsGeneration(newGeneration()) {}
+
 SystemIterator System::begin() const {
   return SystemIterator(this, 0);
 }
@@ -29,6 +50,142 @@ SystemIterator System::end() const {
   return SystemIterator(this, size());
 }
 
+const Particle* System::particleAt(const Node& node) const {
+  for (const Particle& p : *this) {
+    if (p.head == node || (p.isExpanded() && p.tail() == node)) {
+      return &p;
+    }
+  }
+  return nullptr;
+}
+
+void System::particlesInRegion(int minY, int maxY, double minX, double maxX,
+                               std::vector<const Particle*>& result) const {
+  for (const Particle& p : *this) {
+    const double x = p.head.x + 0.5 * p.head.y;
+    if (minY <= p.head.y && p.head.y <= maxY && minX <= x && x <= maxX) {
+      result.push_back(&p);
+    }
+  }
+}
+
+void System::objectsInRegion(int minY, int maxY, double minX, double maxX,
+                             std::vector<const Object*>& result) const {
+  for (const Object* o : getObjects()) {
+    const double x = o->_node.x + 0.5 * o->_node.y;
+    if (minY <= o->_node.y && o->_node.y <= maxY && minX <= x && x <= maxX) {
+      result.push_back(o);
+    }
+  }
+}
+
 bool System::hasTerminated() const {
   return false;
 }
+
+void System::setAsyncMeasures(bool) {}
+
+bool System::streamMetrics(const QString) {
+  return false;
+}
+
+bool System::recordMoves(const QString) {
+  return false;
+}
+
+bool System::recordSnapshots(const QString, int) {
+  return false;
+}
+
+bool System::publishLiveState(const QString, int) {
+  return false;
+}
+
+bool System::saveConfiguration(const QString) const {
+  return false;
+}
+
+bool System::saveCheckpoint(const QString) {
+  return false;
+}
+
+bool System::loadCheckpoint(const QString) {
+  return false;
+}
+
+bool System::takeChanges(std::vector<Node>& result) {
+  const bool tracked = !allChanged;
+  if (tracked) {
+    result.insert(result.end(), changedNodes.begin(), changedNodes.end());
+  }
+  changedNodes.clear();
+  allChanged = false;
+  return tracked;
+}
+
+const RenderAttributes& System::renderAttributes(const Particle& p) const {
+  if (p.attributesGeneration != attributesGeneration) {
+    RenderAttributes& attributes = p.attributes;
+    attributes.headMarkColor = p.headMarkColor();
+    attributes.tailMarkColor = p.tailMarkColor();
+    attributes.headMarkGlobalDir = static_cast<qint8>(p.headMarkGlobalDir());
+    attributes.tailMarkGlobalDir = static_cast<qint8>(p.tailMarkGlobalDir());
+    attributes.borderColors = p.borderColors();
+    attributes.borderPointColors = p.borderPointColors();
+    attributes.borderMask = 0;
+    for (size_t i = 0; i < attributes.borderColors.size(); ++i) {
+      if (attributes.borderColors[i] != -1) {
+        attributes.borderMask |= 1u << i;
+      }
+    }
+    attributes.borderPointMask = 0;
+    for (size_t i = 0; i < attributes.borderPointColors.size(); ++i) {
+      if (attributes.borderPointColors[i] != -1) {
+        attributes.borderPointMask |= 1u << i;
+      }
+    }
+    p.attributesGeneration = attributesGeneration;
+  }
+  return p.attributes;
+}
+
+void System::reportChange(const Node& node) {
+  if (allChanged) {
+    return;
+  } else if (changedNodes.size() == maxReportedChanges) {
+    reportAllChanged();
+  } else {
+    changedNodes.push_back(node);
+  }
+}
+
+void System::reportAllChanged() {
+  allChanged = true;
+  changedNodes.clear();
+  attributesGeneration = newGeneration();
+}
+
+quint64 System::getObjectsGeneration() const {
+  return objectsGeneration;
+}
+
+void System::reportObjectsChanged() {
+  objectsGeneration = newGeneration();
+}
+
+std::shared_ptr<System> System::fork() {
+  return nullptr;
+}
+
+void System::setSeed(const quint32) {}
+
+void System::syncMeasures() {}
+
+void System::setMetricRetention(Retention retention, size_t capacity) {
+  for (auto c : getCounts()) {
+    c->_history.setRetention(retention, capacity);
+  }
+  for (auto m : getMeasures()) {
+    m->_history.setRetention(retention, capacity);
+  }
+}
@@ -9,10 +9,13 @@
 #define AMOEBOTSIM_CORE_SYSTEM_H_
 
 #include <deque>
+#include <memory>
 #include <set>
+#include <vector>
 
 #include <QMutex>
 #include <QString>
+#include <QTextStream>
 
 #include "core/metric.h"
 #include "core/node.h"
@@ -43,6 +46,8 @@ class SystemIterator {
 
 class System {
  public:
+  System();
+
   // Signatures for functions which activate particles. Must be overridden by
   // any system subclasses; see amoebotsystem.h for more detailed documentation.
   virtual void activate() = 0;
@@ -66,6 +71,44 @@ class System {
   SystemIterator begin() const;
   SystemIterator end() const;
 
+  // Spatial queries. particleAt returns the particle whose head or tail
+  // occupies the given node, or nullptr if there is none. particlesInRegion
+  // (resp., objectsInRegion) appends the particles whose heads (resp., the
+  // objects) occupy nodes (x, y) with minY <= y <= maxY and minX <= x + y / 2
+  // <= maxX to result, i.e., those that are drawn inside a rectangle. By
+  // default, these check every particle or object; systems with a spatial
+  // index override them to take time proportional to the result.
+  virtual const Particle* particleAt(const Node& node) const;
+  virtual void particlesInRegion(int minY, int maxY, double minX, double maxX,
+                                 std::vector<const Particle*>& result) const;
+  virtual void objectsInRegion(int minY, int maxY, double minX, double maxX,
+                               std::vector<const Object*>& result) const;
+
+  // Change tracking, so views can redraw only what changed (see
+  // VisItem::paint). Systems report nodes near which particles or objects may
+  // have changed: every change is within changeRadius nodes of a reported
+  // node. takeChanges appends the nodes reported since its last call to result
+  // and returns true, or returns false if anything may have changed since then
+  // (e.g., because particles or objects were inserted or removed, or because
+  // too many nodes were reported in between); either way, it resets the
+  // reports. Subclasses must report every change they make, and mark the
+  // particles they change (see renderAttributes).
+  static constexpr int changeRadius = 3;
+  bool takeChanges(std::vector<Node>& result);
+
+  // Returns the appearance of the given particle of this system (see
+  // core/particle.h), calling its cosmetic functions only if the particle was
+  // marked as changed (see Particle::invalidateRenderAttributes) since they
+  // were last called, or if anything may have changed since then (as for
+  // takeChanges). It may be called from several threads at once for distinct
+  // particles.
+  const RenderAttributes& renderAttributes(const Particle& p) const;
+
+  // Returns a number that changes whenever objects may have been inserted into
+  // or removed from the system, and that no other system shares, so views can
+  // keep what they drew of the objects until it changes (see VisItem::paint).
+  quint64 getObjectsGeneration() const;
+
   // Various access function signatures for metrics (counts and measures). These
   // are pure virtual at this level; see amoebotsystem.h for their overrides.
   virtual const std::vector<Count*>& getCounts() const = 0;
@@ -73,14 +116,96 @@ class System {
   virtual Count& getCount(QString name) const = 0;
   virtual Measure& getMeasure(QString name) const = 0;
   virtual const QString metricsAsJSON() const = 0;
+  virtual void writeMetricsJSON(QTextStream& out) const = 0;
+
+  // Starts streaming all count and measure values to the given file as they
+  // are recorded (see core/metricswriter.h), replacing any previous stream; an
+  // empty path stops streaming. Returns whether the system is streaming. By
+  // default, systems do not support streaming and this returns false.
+  virtual bool streamMetrics(const QString filePath);
+
+  // Starts recording every particle movement to the given file (see
+  // core/moverecorder.h), replacing any previous log; an empty path stops
+  // recording. Returns whether the system is recording. By default, systems
+  // do not support move logs and this returns false.
+  virtual bool recordMoves(const QString filePath);
+
+  // Starts writing a snapshot of the positions of all particles and objects
+  // to the given file every everyRounds rounds (see core/snapshotwriter.h),
+  // replacing any previous snapshot stream; an empty path stops it. Returns
+  // whether the system is writing snapshots. By default, systems do not
+  // support snapshots and this returns false.
+  virtual bool recordSnapshots(const QString filePath, int everyRounds);
+
+  // Starts publishing the particles and current metric values of the system to
+  // the given memory-mapped file every everyRounds rounds, so other processes
+  // can read them while the simulation runs (see core/livestatepublisher.h),
+  // replacing any previous publisher; an empty path stops publishing. Returns
+  // whether the system is publishing. By default, systems do not support this
+  // and it returns false.
+  virtual bool publishLiveState(const QString filePath, int everyRounds);
+
+  // Saves the positions of the particles and objects of the system to the
+  // given file (see core/configuration.h), from which an algorithm can later be
+  // instantiated instead of generating its configuration. Returns whether it
+  // succeeded; by default, systems do not support this and it returns false.
+  virtual bool saveConfiguration(const QString filePath) const;
+
+  // Write the complete state of the system to a binary checkpoint file and
+  // restore it from one, respectively, so a run can be resumed later; both
+  // return whether they succeeded. By default, systems do not support
+  // checkpoints and these return false.
+  virtual bool saveCheckpoint(const QString filePath);
+  virtual bool loadCheckpoint(const QString filePath);
+
+  // Returns an independent copy of this system that continues from its current
+  // state, e.g., to branch one equilibrated system into several experiments,
+  // or nullptr if the system does not support forking (the default).
+  virtual std::shared_ptr<System> fork();
+
+  // Reseeds the random number generator of this system, e.g., so forks of one
+  // system continue differently. By default, systems are not random and this
+  // does nothing.
+  virtual void setSeed(const quint32 seed);
 
   virtual bool hasTerminated() const;
 
+  // Functions for evaluating measures off the simulation thread; see
+  // amoebotsystem.h. setAsyncMeasures enables or disables asynchronous
+  // evaluation and syncMeasures blocks until all measure histories are up to
+  // date. By default, measures are evaluated synchronously and these do nothing.
+  virtual void setAsyncMeasures(bool async);
+  virtual void syncMeasures();
+
+  // Applies the given retention policy to the histories of all counts and
+  // measures, bounding the memory they use over long runs; see
+  // core/metrichistory.h.
+  void setMetricRetention(Retention retention, size_t capacity);
+
  protected:
   // Checks whether the particle system forms one connected component.
   template<class ParticleContainer>
   static bool isConnected(const ParticleContainer& particles);
 
+  // Report changes for takeChanges. reportChange reports a node near which
+  // something changed, and reportAllChanged reports that anything may have.
+  void reportChange(const Node& node);
+  void reportAllChanged();
+
+  // Reports that objects may have been inserted or removed, in addition to
+  // reporting the changes themselves; see getObjectsGeneration.
+  void reportObjectsChanged();
+
+ private:
+  std::vector<Node> changedNodes;
+  bool allChanged;
+
+  // The generation of the render attribute cache; particles caching another
+  // one are stale.
+  quint64 attributesGeneration;
+
+  quint64 objectsGeneration;
+
  public:
   QMutex mutex;
 };
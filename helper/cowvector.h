@@ -0,0 +1,145 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines a sequence container whose copies share their elements copy-on-write.
+// The elements are stored in fixed-size chunks held by shared pointers, so
+// copying the container only copies one pointer per chunk, and modifying or
+// appending an element copies at most the one chunk it belongs to if that
+// chunk is still shared. Hence, the memory used by copies grows only with the
+// number of chunks in which they differ. A container must not be modified by
+// several threads at once, but distinct copies may be used by distinct threads.
+
+#ifndef AMOEBOTSIM_HELPER_COWVECTOR_H_
+#define AMOEBOTSIM_HELPER_COWVECTOR_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <QtGlobal>
+
+template <class T>
+class CowVector {
+public:
+    CowVector();
+
+    size_t size() const;
+    bool empty() const;
+
+    // Read access to the element at the given index and to the last element.
+    const T& operator[](size_t i) const;
+    const T& back() const;
+
+    // Write access to the element at the given index and to the last element;
+    // these copy the element's chunk if it is shared with another container.
+    T& mutableAt(size_t i);
+    T& mutableBack();
+
+    void push_back(const T& value);
+
+    // Removes all elements after the first n, or appends default-constructed
+    // elements until there are n.
+    void resize(size_t n);
+    void clear();
+
+private:
+    typedef std::vector<T> Chunk;
+    static const size_t chunkSize = 1024;
+
+    Chunk& detach(size_t chunk);
+
+    std::vector<std::shared_ptr<Chunk>> chunks;
+    size_t _size;
+};
+
+template <class T>
+CowVector<T>::CowVector()
+    : _size(0)
+{
+}
+
+template <class T>
+size_t CowVector<T>::size() const
+{
+    return _size;
+}
+
+template <class T>
+bool CowVector<T>::empty() const
+{
+    return _size == 0;
+}
+
+template <class T>
+const T& CowVector<T>::operator[](size_t i) const
+{
+    Q_ASSERT(i < _size);
+    return (*chunks[i / chunkSize])[i % chunkSize];
+}
+
+template <class T>
+const T& CowVector<T>::back() const
+{
+    return (*this)[_size - 1];
+}
+
+template <class T>
+T& CowVector<T>::mutableAt(size_t i)
+{
+    Q_ASSERT(i < _size);
+    return detach(i / chunkSize)[i % chunkSize];
+}
+
+template <class T>
+T& CowVector<T>::mutableBack()
+{
+    return mutableAt(_size - 1);
+}
+
+template <class T>
+void CowVector<T>::push_back(const T& value)
+{
+    if (_size % chunkSize == 0) {
+        chunks.push_back(std::make_shared<Chunk>());
+        chunks.back()->reserve(chunkSize);
+    }
+    detach(chunks.size() - 1).push_back(value);
+    ++_size;
+}
+
+template <class T>
+void CowVector<T>::resize(size_t n)
+{
+    while (_size < n) {
+        push_back(T());
+    }
+    if (n < _size) {
+        chunks.resize((n + chunkSize - 1) / chunkSize);
+        if (n % chunkSize != 0) {
+            detach(chunks.size() - 1).resize(n % chunkSize);
+        }
+        _size = n;
+    }
+}
+
+template <class T>
+void CowVector<T>::clear()
+{
+    chunks.clear();
+    _size = 0;
+}
+
+template <class T>
+typename CowVector<T>::Chunk& CowVector<T>::detach(size_t chunk)
+{
+    if (chunks[chunk].use_count() > 1) {
+        std::shared_ptr<Chunk> copy = std::make_shared<Chunk>();
+        copy->reserve(chunkSize);
+        copy->insert(copy->end(), chunks[chunk]->begin(), chunks[chunk]->end());
+        chunks[chunk] = copy;
+    }
+    return *chunks[chunk];
+}
+
+#endif // AMOEBOTSIM_HELPER_COWVECTOR_H_
@@ -0,0 +1,79 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines a chunked parallel reduction over the indices 0, ..., count - 1. The
+// indices are split into consecutive chunks of a fixed size that does not
+// depend on the number of threads. Every chunk is reduced sequentially starting
+// from the identity, the chunks are distributed over the global thread pool,
+// and the chunk results are combined in chunk order. Hence, the result is the
+// same on every machine and in every run, even for floating point sums.
+//
+// Measures reduce over particles with reduceParticles below. This header pulls
+// in QtConcurrent, so only the measures that use it should include it.
+
+#ifndef AMOEBOTSIM_HELPER_PARALLELREDUCE_H_
+#define AMOEBOTSIM_HELPER_PARALLELREDUCE_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include <QtConcurrent>
+
+// The default number of indices per chunk; reductions over fewer indices run
+// on the calling thread.
+const size_t defaultReduceChunkSize = 4096;
+
+// Returns combine(...combine(combine(identity, map(0)), map(1))..., map(count
+// - 1)), up to the chunked evaluation order described above. map is called
+// concurrently from several threads and must only read shared data; combine
+// must be associative and have identity as its neutral element.
+template <class T, class Map, class Combine>
+T parallelReduce(size_t count, const T& identity, Map map, Combine combine,
+    size_t chunkSize = defaultReduceChunkSize)
+{
+    auto reduceChunk = [&](size_t first, size_t last) {
+        T result = identity;
+        for (size_t i = first; i < last; ++i) {
+            result = combine(result, map(i));
+        }
+        return result;
+    };
+
+    const size_t numChunks = (count + chunkSize - 1) / chunkSize;
+    if (numChunks <= 1) {
+        return combine(identity, reduceChunk(0, count));
+    }
+
+    std::vector<size_t> chunks(numChunks);
+    std::vector<T> results(numChunks, identity);
+    for (size_t chunk = 0; chunk < numChunks; ++chunk) {
+        chunks[chunk] = chunk;
+    }
+    QtConcurrent::blockingMap(chunks, [&](const size_t& chunk) {
+        results[chunk] = reduceChunk(chunk * chunkSize,
+            std::min(count, (chunk + 1) * chunkSize));
+    });
+
+    T result = identity;
+    for (const T& chunkResult : results) {
+        result = combine(result, chunkResult);
+    }
+
+    return result;
+}
+
+// Applies map to every particle of the given random-access container (e.g.,
+// _system.particles or positions copied by Measure::capture) and combines the
+// results with combine, starting from identity, as parallelReduce does. Maps
+// that do much work per particle should pass a smaller chunk size.
+template <class ParticleContainer, class T, class Map, class Combine>
+T reduceParticles(const ParticleContainer& particles, const T& identity,
+    Map map, Combine combine, size_t chunkSize = defaultReduceChunkSize)
+{
+    return parallelReduce(particles.size(), identity,
+        [&](size_t i) { return map(particles[i]); }, combine, chunkSize);
+}
+
+#endif // AMOEBOTSIM_HELPER_PARALLELREDUCE_H_
@@ -4,4 +4,5 @@
 
 #include "helper/randomnumbergenerator.h"
 
-std::mt19937 RandomNumberGenerator::rng;
+std::mutex RandomNumberGenerator::seedsMutex;
+std::mt19937 RandomNumberGenerator::seeds;
@@ -2,34 +2,106 @@
  * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
  * notice can be found at the top of main/main.cpp. */
 
+// Defines the source of randomness of systems and particles. Every system owns
+// its own engine, which its particles share, so several systems (e.g., forks of
+// one system) draw independent sequences and can be seeded independently. The
+// engines of new systems are seeded from a sequence of seeds that is seeded
+// randomly, or by setNextSeeds to make runs reproducible.
+
 #ifndef AMOEBOTSIM_HELPER_RANDOMNUMBERGENERATOR_H_
 #define AMOEBOTSIM_HELPER_RANDOMNUMBERGENERATOR_H_
 
 #include <algorithm>
 #include <chrono>
+#include <memory>
+#include <mutex>
 #include <random>
+#include <sstream>
+#include <string>
 
 class RandomNumberGenerator
 {
 public:
+    // Tag for constructing a generator that shares another one's engine.
+    struct ShareEngine {};
+
+    // Constructs a generator with a new engine seeded from the sequence of
+    // seeds. The second constructor makes a generator with a new engine in the
+    // same state as the given generator's, so both continue identically until
+    // one of them is reseeded (e.g., for forks). The third constructor makes
+    // a generator that draws from the given generator's engine (e.g., for the
+    // particles of a system).
     RandomNumberGenerator();
+    RandomNumberGenerator(const RandomNumberGenerator& other);
+    RandomNumberGenerator(const RandomNumberGenerator& source, ShareEngine);
+
+    // Reseeds this generator's engine, shared with the generators drawing from
+    // it, e.g., to let forks of a system continue differently.
+    void setSeed(const uint32_t seed);
+
+    // Reseeds the sequence of seeds for the engines of generators constructed
+    // afterwards, so they are reproducible.
+    static void setNextSeeds(const uint32_t seed);
 
 protected:
-    static int randInt(const int from, const int toNotIncluding);
-    static int randDir();
-    static float randFloat(const float from, const float toNotIncluding);
-    static double randDouble(const double from, const double toNotIncluding);
-    static bool randBool(const double trueProb = 0.5);
+    // Draw from this generator's engine, which is shared state, so they are
+    // const.
+    int randInt(const int from, const int toNotIncluding) const;
+    int randDir() const;
+    float randFloat(const float from, const float toNotIncluding) const;
+    double randDouble(const double from, const double toNotIncluding) const;
+    bool randBool(const double trueProb = 0.5) const;
 
     template <class Iterator>
-    void shuffle(Iterator firxt, Iterator last);
+    void shuffle(Iterator firxt, Iterator last) const;
+
+    // Returns the complete state of this generator's engine, and restores such
+    // a state; setRngState returns false (leaving the engine unchanged) if the
+    // given string is not a valid state.
+    std::string rngState() const;
+    bool setRngState(const std::string& state);
 
 private:
-    static std::mt19937 rng;
+    static uint32_t nextSeed();
+
+    static std::mutex seedsMutex;
+    static std::mt19937 seeds;
+
+    std::shared_ptr<std::mt19937> rng;
 };
 
 inline RandomNumberGenerator::RandomNumberGenerator()
+    : rng(std::make_shared<std::mt19937>(nextSeed()))
 {
+}
+
+inline RandomNumberGenerator::RandomNumberGenerator(const RandomNumberGenerator& other)
+    : rng(std::make_shared<std::mt19937>(*other.rng))
+{
+}
+
+inline RandomNumberGenerator::RandomNumberGenerator(const RandomNumberGenerator& source,
+    ShareEngine)
+    : rng(source.rng)
+{
+}
+
+inline void RandomNumberGenerator::setSeed(const uint32_t seed)
+{
+    rng->seed(seed);
+}
+
+inline void RandomNumberGenerator::setNextSeeds(const uint32_t seed)
+{
+    // Draw a seed first so the one-time random seeding cannot replace ours.
+    nextSeed();
+    std::lock_guard<std::mutex> lock(seedsMutex);
+    seeds.seed(seed);
+}
+
+inline uint32_t RandomNumberGenerator::nextSeed()
+{
+    std::lock_guard<std::mutex> lock(seedsMutex);
     static bool initialized = false;
     if(!initialized) {
         uint32_t seed;
@@ -42,43 +114,63 @@ inline RandomNumberGenerator::RandomNumberGenerator()
                                                          std::numeric_limits<uint32_t>::max());
             seed = dist(device);
         }
-        rng.seed(seed);
+        seeds.seed(seed);
         initialized = true;
     }
+    return seeds();
 }
 
-inline int RandomNumberGenerator::randInt(const int from, const int toNotIncluding)
+inline int RandomNumberGenerator::randInt(const int from, const int toNotIncluding) const
 {
     std::uniform_int_distribution<int> dist(from, toNotIncluding - 1);
-    return dist(rng);
+    return dist(*rng);
 }
 
-inline int RandomNumberGenerator::randDir()
+inline int RandomNumberGenerator::randDir() const
 {
     return randInt(0, 6);
 }
 
-inline float RandomNumberGenerator::randFloat(const float from, const float toNotIncluding)
+inline float RandomNumberGenerator::randFloat(const float from, const float toNotIncluding) const
 {
     std::uniform_real_distribution<float> dist(from, toNotIncluding);
-    return dist(rng);
+    return dist(*rng);
 }
 
-inline double RandomNumberGenerator::randDouble(const double from, const double toNotIncluding)
+inline double RandomNumberGenerator::randDouble(const double from, const double toNotIncluding) const
 {
     std::uniform_real_distribution<double> dist(from, toNotIncluding);
-    return dist(rng);
+    return dist(*rng);
 }
 
-inline bool RandomNumberGenerator::randBool(const double trueProb)
+inline bool RandomNumberGenerator::randBool(const double trueProb) const
 {
     return (randFloat(0, 1) < trueProb);
 }
 
+inline std::string RandomNumberGenerator::rngState() const
+{
+    std::ostringstream out;
+    out << *rng;
+    return out.str();
+}
+
+inline bool RandomNumberGenerator::setRngState(const std::string& state)
+{
+    std::istringstream in(state);
+    std::mt19937 restored;
+    in >> restored;
+    if(in.fail()) {
+        return false;
+    }
+    *rng = restored;
+    return true;
+}
+
 template <class Iterator>
-void RandomNumberGenerator::shuffle(Iterator first, Iterator last)
+void RandomNumberGenerator::shuffle(Iterator first, Iterator last) const
 {
-    std::shuffle(first, last, rng);
+    std::shuffle(first, last, *rng);
 }
 
 #endif  // AMOEBOTSIM_HELPER_RANDOMNUMBERGENERATOR_H_
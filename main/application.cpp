@@ -13,7 +13,8 @@
 #include "ui/visitem.h"
 
 Application::Application(int argc, char *argv[])
-    : QGuiApplication(argc, argv) {
+    : QGuiApplication(argc, argv),
+      shownMetrics(1) {
   // Setup the parameter list model.
   parameterModel = new ParameterListModel();
   engine.rootContext()->setContextProperty("parameterModel", parameterModel);
@@ -24,9 +25,15 @@ Application::Application(int argc, char *argv[])
   auto qmlRoot = engine.rootObjects().first();
   auto vis = qmlRoot->findChild<VisItem*>();
   auto slider = qmlRoot->findChild<QObject*>("stepDurationSlider");
+  vis->setGovernor(&sim.getGovernor());
+  // The metrics panel is only updated when the simulator has published new
+  // metrics, which it reads without locking the system.
   connect(vis, &VisItem::beforeRendering,
           [this, qmlRoot](){
-            QMetaObject::invokeMethod(qmlRoot, "setMetrics", Q_ARG(QVariant, sim.metrics()));
+            const QVariant metrics = sim.metrics(&shownMetrics);
+            if (metrics.isValid()) {
+              QMetaObject::invokeMethod(qmlRoot, "setMetrics", Q_ARG(QVariant, metrics));
+            }
           }
   );
   connect(vis, &VisItem::inspectParticle,
@@ -57,7 +64,6 @@ Application::Application(int argc, char *argv[])
 
   // setup connections between GUI and Simulator
   connect(&sim, &Simulator::systemChanged, vis, &VisItem::systemChanged);
-  connect(&sim, &Simulator::saveScreenshot, vis, &VisItem::saveScreenshot);
   connect(qmlRoot, SIGNAL(start()), &sim, SLOT(start()));
   connect(qmlRoot, SIGNAL(stop()), &sim, SLOT(stop()));
   connect(qmlRoot, SIGNAL(step()), &sim, SLOT(step()));
@@ -74,6 +80,17 @@ Application::Application(int argc, char *argv[])
   );
   connect(vis, &VisItem::stepForParticleAt, &sim, &Simulator::stepForParticleAt);
   connect(slider, SIGNAL(stepDurationChanged(int)), &sim, SLOT(setStepDuration(int)));
+  connect(qmlRoot, SIGNAL(performanceTargetSelected(int)),
+          &sim, SLOT(setPerformanceTarget(int)));
+  connect(&performanceTimer, &QTimer::timeout,
+          [this, qmlRoot](){
+            const PerformanceGovernor& governor = sim.getGovernor();
+            QMetaObject::invokeMethod(qmlRoot, "setPerformance",
+                                      Q_ARG(QVariant, governor.framesPerSecond()),
+                                      Q_ARG(QVariant, governor.activationsPerSecond()));
+          }
+  );
+  performanceTimer.start(500);
   connect(&sim, &Simulator::stepDurationChanged,
           [slider](const int& ms){
             QMetaObject::invokeMethod(slider, "setStepDuration", Q_ARG(QVariant, QVariant(ms)));
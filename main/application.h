@@ -9,6 +9,7 @@
 
 #include <QGuiApplication>
 #include <QQmlApplicationEngine>
+#include <QTimer>
 
 #include "core/simulator.h"
 #include "script/scriptengine.h"
@@ -24,6 +25,14 @@ class Application : public QGuiApplication {
   Simulator sim;
   std::shared_ptr<ScriptEngine> scriptEngine;
   ParameterListModel* parameterModel;
+
+  // The sequence number of the metrics shown in the GUI; see
+  // Simulator::metrics.
+  quint64 shownMetrics;
+
+  // Periodically updates the overlay showing the achieved frames and
+  // activations per second; see core/performancegovernor.h.
+  QTimer performanceTimer;
 };
 
 #endif  // AMOEBOTSIM_MAIN_APPLICATION_H_
@@ -0,0 +1,31 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "main/headlessapplication.h"
+
+#include <cstdio>
+
+HeadlessApplication::HeadlessApplication(int& argc, char *argv[])
+    : QCoreApplication(argc, argv),
+      failed(false) {
+  auto log = [this](const QString msg, const bool isError) {
+    std::fprintf(isError ? stderr : stdout, "%s\n", msg.toLocal8Bit().constData());
+    failed = failed || isError;
+  };
+
+  for (Algorithm* alg : algList.getAlgs()) {
+    connect(alg, &Algorithm::log, log);
+    connect(alg, &Algorithm::setSystem, &sim, &Simulator::setSystem);
+  }
+
+  scriptEngine = std::make_shared<ScriptEngine>(sim, nullptr, &algList);
+  connect(scriptEngine.get(), &ScriptEngine::log, log);
+
+  sim.setStepDuration(0);
+}
+
+int HeadlessApplication::run(const QString scriptFilePath) {
+  scriptEngine->runScript(scriptFilePath);
+  return failed ? 1 : 0;
+}
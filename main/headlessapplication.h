@@ -0,0 +1,38 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines an application that runs a script without a window or an OpenGL
+// context, e.g., to run experiments or film simulations on a server without a
+// display. Log messages are written to the standard output, and errors to the
+// standard error. Screenshots are rendered on the CPU (see ui/rasterizer.h).
+
+#ifndef AMOEBOTSIM_MAIN_HEADLESSAPPLICATION_H_
+#define AMOEBOTSIM_MAIN_HEADLESSAPPLICATION_H_
+
+#include <memory>
+
+#include <QCoreApplication>
+#include <QString>
+
+#include "core/simulator.h"
+#include "script/scriptengine.h"
+#include "ui/algorithm.h"
+
+class HeadlessApplication : public QCoreApplication {
+  Q_OBJECT
+ public:
+  explicit HeadlessApplication(int& argc, char *argv[]);
+
+  // Runs the given script and returns the exit code of the application: 0 if
+  // no errors were logged, and 1 otherwise.
+  int run(const QString scriptFilePath);
+
+ protected:
+  Simulator sim;
+  AlgorithmList algList;
+  std::shared_ptr<ScriptEngine> scriptEngine;
+  bool failed;
+};
+
+#endif  // AMOEBOTSIM_MAIN_HEADLESSAPPLICATION_H_
@@ -17,9 +17,22 @@
  *
  * AmoebotSim is developed using Open Source Qt. */
 
+#include <QString>
+#include <QtGlobal>
+
 #include "application.h"
+#include "headlessapplication.h"
 
 int main(int argc, char *argv[]) {
+  // "AmoebotSim --headless script.js" runs the script without a window and
+  // exits (see main/headlessapplication.h).
+  for (int i = 1; i + 1 < argc; ++i) {
+    if (qstrcmp(argv[i], "--headless") == 0) {
+      HeadlessApplication app(argc, argv);
+      return app.run(QString::fromLocal8Bit(argv[i + 1]));
+    }
+  }
+
   Application app(argc, argv);
   return app.exec();
 }
@@ -36,6 +36,7 @@ ApplicationWindow {
   signal step()
   signal exportMetrics()
   signal focusOnCenterOfMass()
+  signal performanceTargetSelected(int target)
 
   function log(msg, isError) {
     fieldLayout.forceActiveFocus()
@@ -59,6 +60,11 @@ ApplicationWindow {
     metricList.model = metricInfo
   }
 
+  function setPerformance(framesPerSecond, activationsPerSecond) {
+    performanceText.text = Math.round(framesPerSecond) + " fps, "
+        + Math.round(activationsPerSecond) + " activations/s"
+  }
+
   function setResolution(_width, _height) {
     if (_width < appWindow.minimumWidth) {
       appWindow.width = appWindow.minimumWidth
@@ -125,6 +131,25 @@ ApplicationWindow {
     }
   }
 
+  A_Inspector {
+    id: performanceOverlay
+    visible: sidebar.visible
+    anchors.top: vis.top
+    anchors.right: sidebar.left
+    anchors.margins: 10
+    implicitWidth: performanceText.width + 20
+    height: performanceText.height + 20
+
+    Text {
+      id: performanceText
+      anchors.margins: 10
+      anchors.top: parent.top
+      anchors.left: parent.left
+      color: "#000"
+      text: ""
+    }
+  }
+
   Item {
     id: fieldLayout
     anchors.left: vis.left
@@ -297,6 +322,22 @@ ApplicationWindow {
       color: "transparent"
     }
 
+    ComboBox {
+      id: performanceTargetBox
+      objectName: "performanceTargetBox"
+      Layout.preferredWidth: parent.width
+      Layout.preferredHeight: 35
+      model: [ "Smooth view", "Max sim speed" ]
+
+      onCurrentIndexChanged: {
+        performanceTargetSelected(currentIndex)
+      }
+
+      style: ComboBoxStyle {
+        textColor: "black"
+      }
+    }
+
     RowLayout {
       id: stepDurationRow
       Layout.bottomMargin: 15
@@ -5,6 +5,7 @@
 #include "script/scriptengine.h"
 
 #include <QFile>
+#include <QJSValue>
 #include <QString>
 #include <QTextStream>
 
@@ -42,5 +43,9 @@ void ScriptEngine::runScript(const QString scriptFilePath) {
 
   scriptFile.close();
 
-  engine.evaluate(script);
+  const QJSValue result = engine.evaluate(script, scriptFilePath);
+  if (result.isError()) {
+    emit log(scriptFilePath + ":" + result.property("lineNumber").toString()
+             + ": " + result.toString(), true);
+  }
 }
@@ -4,12 +4,45 @@
 
 #include "script/scriptinterface.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include <QDateTime>
 #include <QFile>
+#include <QImage>
+#include <QPointF>
 #include <QTextStream>
 
 #include "alg/shapeformation.h"
+#include "core/metricswriter.h"
+#include "core/moverecorder.h"
 #include "core/node.h"
+#include "core/replaysystem.h"
+#include "core/snapshotwriter.h"
+#include "helper/randomnumbergenerator.h"
+#include "ui/filmwriter.h"
+
+namespace {
+
+// Writes the entries (or, if indices is true, their indices) of the given
+// history at positions first, first + stride, ... before last as doubles.
+template<class T>
+QByteArray historyRange(const MetricHistory<T>& history, size_t first,
+                        size_t last, size_t stride, bool indices) {
+  QByteArray buffer;
+  if (first < last) {
+    buffer.resize(static_cast<int>((last - first + stride - 1) / stride
+                                   * sizeof(double)));
+    double* out = reinterpret_cast<double*>(buffer.data());
+    for (size_t i = first; i < last; i += stride) {
+      *out++ = indices ? static_cast<double>(history.index(i))
+                       : static_cast<double>(history[i]);
+    }
+  }
+  return buffer;
+}
+
+}  // namespace
 
 ScriptInterface::ScriptInterface(ScriptEngine &engine, Simulator& sim,
                                  VisItem *vis)
@@ -58,6 +91,74 @@ void ScriptInterface::runUntilTermination() {
   sim.runUntilTermination();
 }
 
+void ScriptInterface::saveCheckpoint(QString filePath) {
+  if (!sim.saveCheckpoint(filePath)) {
+    log("could not save a checkpoint to " + filePath
+        + "; does the algorithm support checkpoints?", true);
+  }
+}
+
+void ScriptInterface::loadCheckpoint(QString filePath) {
+  if (!sim.loadCheckpoint(filePath)) {
+    log("could not load the checkpoint " + filePath
+        + " into the current instance", true);
+  }
+}
+
+void ScriptInterface::saveConfiguration(QString filePath) {
+  if (!sim.saveConfiguration(filePath)) {
+    log("could not save the configuration to " + filePath, true);
+  }
+}
+
+void ScriptInterface::fork(QString name) {
+  std::shared_ptr<System> forked = sim.forkSystem();
+  if (forked == nullptr) {
+    log("could not fork the current instance; does the algorithm support "
+        "forks?", true);
+  } else {
+    forks[name] = forked;
+  }
+}
+
+void ScriptInterface::resumeFork(QString name) {
+  auto it = forks.find(name);
+  if (it == forks.end()) {
+    log("no fork named " + name, true);
+    return;
+  }
+
+  // Resume a copy, so the stored fork stays unchanged for later resumes.
+  std::shared_ptr<System> forked = it->second->fork();
+  if (forked == nullptr) {
+    log("could not resume the fork " + name, true);
+  } else {
+    sim.setSystem(forked);
+  }
+}
+
+void ScriptInterface::setSeed(int seed) {
+  sim.getSystem()->setSeed(static_cast<quint32>(seed));
+  RandomNumberGenerator::setNextSeeds(static_cast<uint32_t>(seed));
+}
+
+void ScriptInterface::replay(QString filePath) {
+  auto replay = std::make_shared<ReplaySystem>(filePath);
+  if (!replay->isValid()) {
+    log("could not replay the move log " + filePath, true);
+  } else {
+    sim.setSystem(replay);
+  }
+}
+
+void ScriptInterface::seekReplay(int activation) {
+  if (activation < 0) {
+    log("activation index must be non-negative", true);
+  } else if (!sim.seekReplay(activation)) {
+    log("the current instance is not a replay", true);
+  }
+}
+
 int ScriptInterface::getNumParticles() {
   return sim.numParticles();
 }
@@ -72,35 +173,173 @@ void ScriptInterface::exportMetrics() {
 }
 
 QVariant ScriptInterface::getMetric(QString name, bool history) {
-  for (const auto& c : sim.getSystem()->getCounts()) {
-    if (c->_name == name) {
-      return history ? QVariant::fromValue(c->_history) : c->_value;
+  sim.getSystem()->syncMeasures();
+  Count* count;
+  Measure* measure;
+  if (!findMetric(name, count, measure)) {
+    return QVariant();
+  } else if (count != nullptr) {
+    if (!history) {
+      return QVariant(count->_value);
     }
-  }
-  for (const auto& m : sim.getSystem()->getMeasures()) {
-    if (m->_name == name) {
-      return history ? QVariant::fromValue(m->_history) : m->_history.back();
+    const auto values = count->_history.values();
+    return QVariant::fromValue(std::vector<double>(values.begin(),
+                                                   values.end()));
+  } else {
+    if (!history) {
+      return QVariant(measure->_value);
     }
+    const auto values = measure->_history.values();
+    return QVariant::fromValue(std::vector<double>(values.begin(),
+                                                   values.end()));
+  }
+}
+
+double ScriptInterface::getMetricLength(QString name) {
+  sim.getSystem()->syncMeasures();
+  Count* count;
+  Measure* measure;
+  if (!findMetric(name, count, measure)) {
+    return 0;
+  }
+  return (count != nullptr) ? count->_history.numRecorded()
+                            : measure->_history.numRecorded();
+}
+
+QByteArray ScriptInterface::getMetricRange(QString name, double start,
+                                           double end, int stride) {
+  return metricRange(name, start, end, stride, false);
+}
+
+QByteArray ScriptInterface::getMetricIndices(QString name, double start,
+                                             double end, int stride) {
+  return metricRange(name, start, end, stride, true);
+}
+
+void ScriptInterface::setAsyncMeasures(bool async) {
+  sim.setAsyncMeasures(async);
+}
+
+void ScriptInterface::streamMetrics(QString filePath) {
+  if (!sim.streamMetrics(filePath) && !filePath.isEmpty()) {
+    log("could not stream metrics to " + filePath, true);
+  }
+}
+
+void ScriptInterface::renderMetrics(const QString binaryPath,
+                                    const QString outPath) {
+  if (!MetricsWriter::render(binaryPath, outPath)) {
+    log("could not render metrics from " + binaryPath + " to " + outPath,
+        true);
+  }
+}
+
+void ScriptInterface::setMetricRetention(QString policy, int capacity) {
+  Retention retention;
+  if (policy == "full") {
+    retention = Retention::Full;
+  } else if (policy == "ring") {
+    retention = Retention::Ring;
+  } else if (policy == "downsample") {
+    retention = Retention::Downsample;
+  } else if (policy == "bucket") {
+    retention = Retention::Bucket;
+  } else {
+    log("unknown metric retention policy " + policy, true);
+    return;
+  }
+
+  if (retention != Retention::Full && capacity <= 0) {
+    log("metric retention capacity must be positive", true);
+    return;
+  }
+
+  sim.setMetricRetention(retention, static_cast<size_t>(capacity));
+}
+
+void ScriptInterface::recordMoves(QString filePath) {
+  if (!sim.recordMoves(filePath) && !filePath.isEmpty()) {
+    log("could not record moves to " + filePath, true);
+  }
+}
+
+void ScriptInterface::renderMoves(const QString binaryPath,
+                                  const QString outPath) {
+  if (!MoveRecorder::render(binaryPath, outPath)) {
+    log("could not render moves from " + binaryPath + " to " + outPath, true);
+  }
+}
+
+void ScriptInterface::recordSnapshots(QString filePath, int everyRounds) {
+  if (everyRounds <= 0) {
+    log("snapshot interval must be positive", true);
+  } else if (!sim.recordSnapshots(filePath, everyRounds)
+             && !filePath.isEmpty()) {
+    log("could not record snapshots to " + filePath, true);
+  }
+}
+
+int ScriptInterface::getNumSnapshots(const QString binaryPath) {
+  SnapshotReader reader(binaryPath);
+  if (!reader.isOpen()) {
+    log("could not read snapshots from " + binaryPath, true);
+    return 0;
+  }
+
+  return static_cast<int>(reader.size());
+}
+
+double ScriptInterface::getSnapshotRound(const QString binaryPath,
+                                         int index) {
+  SnapshotReader reader(binaryPath);
+  if (!reader.isOpen() || index < 0
+      || static_cast<quint64>(index) >= reader.size()) {
+    log("could not read snapshot " + QString::number(index) + " from "
+        + binaryPath, true);
+    return -1;
+  }
+
+  return reader.round(static_cast<quint64>(index));
+}
+
+void ScriptInterface::renderSnapshot(const QString binaryPath, int index,
+                                     const QString outPath) {
+  if (index < 0 || !SnapshotWriter::render(binaryPath, index, outPath)) {
+    log("could not render snapshot " + QString::number(index) + " from "
+        + binaryPath + " to " + outPath, true);
+  }
+}
+
+void ScriptInterface::publishLiveState(QString filePath, int everyRounds) {
+  if (everyRounds <= 0) {
+    log("publishing interval must be positive", true);
+  } else if (!sim.publishLiveState(filePath, everyRounds)
+             && !filePath.isEmpty()) {
+    log("could not publish live state to " + filePath, true);
   }
-  log("no metrics with given name exist", true);
-  return QVariant();
 }
 
 void ScriptInterface::setWindowSize(int width, int height) {
   if(vis != nullptr) {
     vis->setWindowSize(width, height);
+  } else {
+    headlessView.setViewportSize(width, height);
   }
 }
 
 void ScriptInterface::focusOn(int x, int y) {
   if (vis != nullptr) {
     vis->focusOn(Node(x, y));
+  } else {
+    headlessView.setFocusPos(QPointF(x + 0.5 * y, y * std::sqrt(3.0 / 4.0)));
   }
 }
 
 void ScriptInterface::setZoom(float zoom) {
   if(vis != nullptr) {
     vis->setZoom(zoom);
+  } else {
+    headlessView.setZoom(zoom);
   }
 }
 
@@ -110,32 +349,101 @@ void ScriptInterface::saveScreenshot(QString filePath) {
                QString::number(QDateTime::currentSecsSinceEpoch()) + ".png";
   }
 
-  sim.saveScreenshotSetup(filePath);
+  if (!renderView().save(filePath)) {
+    log("could not save a screenshot to " + filePath, true);
+  }
 }
 
-void ScriptInterface::filmSimulation(QString filePath, const int stepLimit) {
-  int fnameLen = 0;
-  int temp = stepLimit;
-  while (temp >= 10) {
-    ++fnameLen;
-    temp = temp % 10;
+void ScriptInterface::filmSimulation(QString filePath, const int stepLimit,
+                                     int framesPerSecond) {
+  if (framesPerSecond <= 0) {
+    log("frame rate must be positive", true);
+    return;
+  }
+
+  // Frame numbers are padded to the width of the last one, so the images of a
+  // PNG sequence sort in order.
+  const int digits = QString::number(std::max(stepLimit - 1, 0)).length();
+
+  // Frames are encoded and written in the background while the simulation
+  // keeps running; closing the film waits for the remaining frames.
+  FilmWriter film(filePath, framesPerSecond, digits);
+  if (!film.isOpen()) {
+    log("could not open film " + filePath, true);
+    return;
   }
 
   int i = 0;
   while(!sim.getSystem()->hasTerminated() && i < stepLimit) {
-    emit vis->beforeRendering();  // Updates GUI #rounds and #movements labels.
-    saveScreenshot(filePath + pad(i,fnameLen) + QString(".png"));
+    if (vis != nullptr) {
+      emit vis->beforeRendering();  // Updates GUI #rounds and #movements labels.
+    }
+    film.append(renderView());
     step();
     ++i;
   }
+
+  if (!film.close()) {
+    log("could not write all frames of film " + filePath, true);
+  }
 }
 
-QString ScriptInterface::pad(const int number, const int length) {
-  QString str = "" + QString::number(number);
+bool ScriptInterface::findMetric(const QString name, Count*& count,
+                                 Measure*& measure) {
+  const std::shared_ptr<System> system = sim.getSystem();
+  if (indexedSystem.lock() != system) {
+    metricIndex.clear();
+    for (const auto& c : system->getCounts()) {
+      metricIndex.emplace(c->_name, std::make_pair(c, nullptr));
+    }
+    for (const auto& m : system->getMeasures()) {
+      metricIndex.emplace(m->_name, std::make_pair(nullptr, m));
+    }
+    indexedSystem = system;
+  }
 
-  while(str.length() < length) {
-    str = QString("0") + str;
+  auto it = metricIndex.find(name);
+  if (it == metricIndex.end()) {
+    log("no metrics with given name exist", true);
+    return false;
   }
+  count = it->second.first;
+  measure = it->second.second;
+  return true;
+}
+
+QByteArray ScriptInterface::metricRange(QString name, double start, double end,
+                                        int stride, bool indices) {
+  sim.getSystem()->syncMeasures();
+  Count* count;
+  Measure* measure;
+  if (stride <= 0) {
+    log("stride must be > 0", true);
+    return QByteArray();
+  } else if (!findMetric(name, count, measure)) {
+    return QByteArray();
+  }
+
+  // Indices are passed as doubles, since script numbers cannot hold all
+  // 64-bit integers anyway.
+  const quint64 from = static_cast<quint64>(std::max(start, 0.0));
+  if (count != nullptr) {
+    const auto& history = count->_history;
+    const quint64 to = (end < 0) ? history.numRecorded()
+                                 : static_cast<quint64>(end);
+    return historyRange(history, history.position(from), history.position(to),
+                        stride, indices);
+  } else {
+    const auto& history = measure->_history;
+    const quint64 to = (end < 0) ? history.numRecorded()
+                                 : static_cast<quint64>(end);
+    return historyRange(history, history.position(from), history.position(to),
+                        stride, indices);
+  }
+}
 
-  return str;
+QImage ScriptInterface::renderView() {
+  View& view = (vis != nullptr) ? vis->getView() : headlessView;
+  return rasterizer.render(*sim.getSystem(), view.viewportSize(),
+                           view.focusPos(), view.zoom());
 }
@@ -7,11 +7,18 @@
 #ifndef AMOEBOTSIM_SCRIPT_SCRIPTINTERFACE_H_
 #define AMOEBOTSIM_SCRIPT_SCRIPTINTERFACE_H_
 
+#include <map>
+#include <memory>
+#include <utility>
+
+#include <QByteArray>
 #include <QObject>
 #include <QString>
 
 #include "core/simulator.h"
 #include "script/scriptengine.h"
+#include "ui/rasterizer.h"
+#include "ui/view.h"
 #include "ui/visitem.h"
 
 class ScriptInterface : public QObject {
@@ -33,41 +40,130 @@ class ScriptInterface : public QObject {
   // setStepDuration sets the simulator's delay between particle activations to
   // the given value; if this value is negative, an error is logged and the step
   // duration is set to 0. runUntilTermination runs the current algorithm
-  // instance until its hasTerminated function returns true.
+  // instance until its hasTerminated function returns true. saveCheckpoint
+  // writes the complete state of the current instance to a file, and
+  // loadCheckpoint restores it into an instance of the same algorithm created
+  // with the same parameters. saveConfiguration writes the positions of the
+  // particles and objects of the current instance to a file from which
+  // algorithms can be instantiated (see core/configuration.h). fork stores a
+  // copy of the current instance under the given name, and resumeFork replaces
+  // the current instance by a new copy of a stored one, so one stored fork can
+  // be resumed several times. setSeed reseeds the random number generator of
+  // the current instance, e.g., to let resumed forks diverge, and of the
+  // instances created afterwards.
+  // replay replaces the current instance by a replay of a move log (see
+  // recordMoves), which steps through the recorded activations, and
+  // seekReplay moves such a replay to the given activation index.
   void step();
   void setStepDuration(const int ms);
   void runUntilTermination();
+  void saveCheckpoint(QString filePath);
+  void loadCheckpoint(QString filePath);
+  void saveConfiguration(QString filePath);
+  void fork(QString name);
+  void resumeFork(QString name);
+  void setSeed(int seed);
+  void replay(QString filePath);
+  void seekReplay(int activation);
 
   // Simulator metrics commands. getNumParticles and getNumObjects return the
   // number of particles and objects in the given instance, respectively.
   // exportMetrics writes the metrics to JSON. See simulator.h for further
   // discussion. getMetric returns either the current value (history = false)
   // or the historical data (history = true) of the metric with parameter-
-  // defined name.
+  // defined name. setAsyncMeasures toggles whether measures are evaluated on
+  // background threads; getMetric and exportMetrics wait for pending results.
+  // streamMetrics starts writing all metric values to a binary file as they
+  // are recorded (an empty path stops it), and renderMetrics converts such a
+  // file to CSV or JSON. setMetricRetention bounds the memory used by metric
+  // histories with one of the policies "full", "ring", "downsample", or
+  // "bucket" and the given capacity (see core/metrichistory.h). recordMoves
+  // starts logging every particle movement to a binary file (an empty path
+  // stops it), and renderMoves converts such a log to CSV. recordSnapshots
+  // starts writing compressed snapshots of the configuration every given
+  // number of rounds to a binary file (an empty path stops it),
+  // getNumSnapshots and getSnapshotRound describe such a file, and
+  // renderSnapshot converts one of its snapshots to a configuration file.
+  // publishLiveState starts publishing the particles and metric values every
+  // given number of rounds to a memory-mapped file that other processes can
+  // read while the simulation runs (an empty path stops it).
+  //
+  // For analysis scripts that poll histories, getMetricLength returns the
+  // number of values the metric has recorded so far, and getMetricRange
+  // returns only the kept history entries recorded at indices in [start, end)
+  // (end = -1 for all), taking every stride-th one, as an ArrayBuffer of 64-bit
+  // floats (e.g., new Float64Array(getMetricRange(...))). getMetricIndices
+  // returns the indices of the same entries, which are consecutive unless the
+  // history is downsampled. Passing the previous length as start reads the new
+  // values only.
   int getNumParticles();
   int getNumObjects();
   void exportMetrics();
   QVariant getMetric(QString name, bool history = false);
+  double getMetricLength(QString name);
+  QByteArray getMetricRange(QString name, double start = 0, double end = -1,
+                            int stride = 1);
+  QByteArray getMetricIndices(QString name, double start = 0, double end = -1,
+                              int stride = 1);
+  void setAsyncMeasures(bool async);
+  void streamMetrics(QString filePath);
+  void renderMetrics(const QString binaryPath, const QString outPath);
+  void setMetricRetention(QString policy, int capacity = 0);
+  void recordMoves(QString filePath);
+  void renderMoves(const QString binaryPath, const QString outPath);
+  void recordSnapshots(QString filePath, int everyRounds = 1);
+  int getNumSnapshots(const QString binaryPath);
+  double getSnapshotRound(const QString binaryPath, int index);
+  void renderSnapshot(const QString binaryPath, int index,
+                      const QString outPath);
+  void publishLiveState(QString filePath, int everyRounds = 1);
 
   // Visualization commands. focusOn centers the window at the given (x,y) node.
-  // setZoom sets the zoom level of the window. saveScreenshot saves the current
-  // window as a .png in the specified location; if no filepath is provided, a
-  // default path is created that ensures no previous screenshots are
-  // overwritten. filmSimulation saves a series of screenshots to the specified
-  // location, up to the specified number of steps.
+  // setZoom sets the zoom level of the window. saveScreenshot renders the
+  // system as shown in the window to an image in the specified location on the
+  // CPU (see ui/rasterizer.h); if no filepath is provided, a default path is
+  // created that ensures no previous screenshots are overwritten.
+  // filmSimulation renders a screenshot before each of up to the specified
+  // number of steps into a film at the specified location (see
+  // ui/filmwriter.h): a .y4m or .avi video with the given frame rate, or
+  // numbered .png images otherwise. Frames are encoded in the background while
+  // the simulation keeps running. Without a window (see
+  // main/headlessapplication.h), these commands set up and render a view of
+  // their own.
   void setWindowSize(int width = 800, int height = 600);
   void focusOn(int x, int y);
   void setZoom(float zoom);
   void saveScreenshot(QString filePath = "");
-  void filmSimulation(QString filePath, const int stepLimit);
+  void filmSimulation(QString filePath, const int stepLimit,
+                      int framesPerSecond = 30);
 
  private:
   ScriptEngine& engine;
   Simulator& sim;
   VisItem* vis;
 
-  // Pads the given number with leading zeroes to achieve the specified length.
-  QString pad(const int number, const int length);
+  // The view rendered by saveScreenshot if there is no window, and the
+  // rasterizer rendering it.
+  View headlessView;
+  Rasterizer rasterizer;
+
+  // Forks stored by the fork command, by name.
+  std::map<QString, std::shared_ptr<System>> forks;
+
+  // Finds the count or the measure with the given name in the current
+  // instance, setting the other to nullptr; logs an error and returns false if
+  // there is none. Metrics are looked up in an index by name, which is rebuilt
+  // whenever the instance changes.
+  bool findMetric(const QString name, Count*& count, Measure*& measure);
+  std::weak_ptr<System> indexedSystem;
+  std::map<QString, std::pair<Count*, Measure*>> metricIndex;
+
+  // Implements getMetricRange (indices = false) and getMetricIndices.
+  QByteArray metricRange(QString name, double start, double end, int stride,
+                         bool indices);
+
+  // Renders the window's view, or headlessView if there is no window.
+  QImage renderView();
 };
 
 #endif  // AMOEBOTSIM_SCRIPT_SCRIPTINTERFACE_H_
@@ -68,6 +68,19 @@ void Algorithm::addParameter(QString parameter, QString defaultValue)
     _parameters.push_back(std::make_pair(parameter, defaultValue));
 }
 
+bool Algorithm::loadConfiguration(const QString filePath, Configuration& config)
+{
+    if (!config.load(filePath)) {
+        emit log("could not load configuration " + filePath, true);
+        return false;
+    } else if (config.particles.empty()) {
+        emit log("configuration " + filePath + " has no particles", true);
+        return false;
+    }
+
+    return true;
+}
+
 DiscoDemoAlg::DiscoDemoAlg()
     : Algorithm("Demo: Disco", "discodemo")
 {
@@ -138,14 +151,19 @@ CompressionAlg::CompressionAlg()
 {
     addParameter("# Particles", "100");
     addParameter("Lambda", "4.0");
+    addParameter("Configuration File", "");
 }
 
-void CompressionAlg::instantiate(const int numParticles, const double lambda)
+void CompressionAlg::instantiate(const int numParticles, const double lambda,
+    const QString configFile)
 {
-    if (numParticles <= 0) {
+    Configuration config;
+    if (configFile.isEmpty() && numParticles <= 0) {
         emit log("# particles must be > 0", true);
-    } else {
+    } else if (configFile.isEmpty()) {
         emit setSystem(std::make_shared<CompressionSystem>(numParticles, lambda));
+    } else if (loadConfiguration(configFile, config)) {
+        emit setSystem(std::make_shared<CompressionSystem>(config, lambda));
     }
 }
 
@@ -158,6 +176,7 @@ EnergyShapeAlg::EnergyShapeAlg()
     addParameter("Capacity", "10.0");
     addParameter("Demand", "5.0");
     addParameter("Transfer Rate", "1.0");
+    addParameter("Configuration File", "");
 }
 
 void EnergyShapeAlg::instantiate(const int numParticles,
@@ -165,13 +184,16 @@ void EnergyShapeAlg::instantiate(const int numParticles,
     const double holeProb,
     const double capacity,
     const double demand,
-    const double transferRate)
+    const double transferRate,
+    const QString configFile)
 {
-    if (numParticles <= 0) {
+    Configuration config;
+    if (configFile.isEmpty() && numParticles <= 0) {
         emit log("# particles must be > 0", true);
-    } else if (numEnergyRoots <= 0 || numEnergyRoots > numParticles) {
+    } else if (numEnergyRoots <= 0
+        || (configFile.isEmpty() && numEnergyRoots > numParticles)) {
         emit log("# energy roots must be in (0, #particles]", true);
-    } else if (holeProb < 0 || holeProb > 1) {
+    } else if (configFile.isEmpty() && (holeProb < 0 || holeProb > 1)) {
         emit log("holeProb in [0,1] required", true);
     } else if (capacity <= 0) {
         emit log("capacity must be > 0", true);
@@ -179,10 +201,17 @@ void EnergyShapeAlg::instantiate(const int numParticles,
         emit log("demand must be in (0, capacity]", true);
     } else if (transferRate <= 0) {
         emit log("transferRate must be > 0", true);
-    } else {
+    } else if (configFile.isEmpty()) {
         emit setSystem(std::make_shared<EnergyShapeSystem>(
             numParticles, numEnergyRoots, holeProb, capacity, demand,
             transferRate));
+    } else if (loadConfiguration(configFile, config)) {
+        if (numEnergyRoots > static_cast<int>(config.particles.size())) {
+            emit log("# energy roots must be in (0, #particles]", true);
+        } else {
+            emit setSystem(std::make_shared<EnergyShapeSystem>(
+                config, numEnergyRoots, capacity, demand, transferRate));
+        }
     }
 }
 
@@ -195,6 +224,7 @@ EnergySharingAlg::EnergySharingAlg()
     addParameter("Capacity", "10.0");
     addParameter("Demand", "5.0");
     addParameter("Transfer Rate", "1.0");
+    addParameter("Configuration File", "");
 }
 
 void EnergySharingAlg::instantiate(int numParticles,
@@ -202,11 +232,14 @@ void EnergySharingAlg::instantiate(int numParticles,
     const int usage,
     const double capacity,
     const double demand,
-    const double transferRate)
+    const double transferRate,
+    const QString configFile)
 {
-    if (numParticles <= 0) {
+    Configuration config;
+    if (configFile.isEmpty() && numParticles <= 0) {
         emit log("# particles must be > 0", true);
-    } else if (numEnergyRoots <= 0 || numEnergyRoots > numParticles) {
+    } else if (numEnergyRoots <= 0
+        || (configFile.isEmpty() && numEnergyRoots > numParticles)) {
         emit log("# energy roots must be in (0, #particles]", true);
     } else if (usage != 0 && usage != 1) {
         emit log("usage mode must be 0 or 1", true);
@@ -216,10 +249,18 @@ void EnergySharingAlg::instantiate(int numParticles,
         emit log("demand must be in (0, capacity]", true);
     } else if (transferRate <= 0) {
         emit log("transferRate must be > 0", true);
-    } else {
+    } else if (configFile.isEmpty()) {
         emit setSystem(std::make_shared<EnergySharingSystem>(
             numParticles, numEnergyRoots, usage, capacity, demand,
             transferRate));
+    } else if (loadConfiguration(configFile, config)) {
+        if (numEnergyRoots > static_cast<int>(config.particles.size())) {
+            emit log("# energy roots must be in (0, #particles]", true);
+        } else {
+            emit setSystem(std::make_shared<EnergySharingSystem>(
+                config, numEnergyRoots, usage, capacity, demand,
+                transferRate));
+        }
     }
 }
 
@@ -228,18 +269,22 @@ InfObjCoatingAlg::InfObjCoatingAlg()
 {
     addParameter("# Particles", "100");
     addParameter("Hole Prob.", "0.2");
+    addParameter("Configuration File", "");
 }
 
 void InfObjCoatingAlg::instantiate(const int numParticles,
-    const double holeProb)
+    const double holeProb, const QString configFile)
 {
-    if (numParticles <= 0) {
+    Configuration config;
+    if (configFile.isEmpty() && numParticles <= 0) {
         emit log("# particles must be > 0", true);
-    } else if (holeProb < 0 || holeProb > 1) {
+    } else if (configFile.isEmpty() && (holeProb < 0 || holeProb > 1)) {
         emit log("holeProb in [0,1] required", true);
-    } else {
+    } else if (configFile.isEmpty()) {
         emit setSystem(std::make_shared<InfObjCoatingSystem>(numParticles,
             holeProb));
+    } else if (loadConfiguration(configFile, config)) {
+        emit setSystem(std::make_shared<InfObjCoatingSystem>(config));
     }
 }
 
@@ -248,18 +293,22 @@ LeaderElectionAlg::LeaderElectionAlg()
 {
     addParameter("# Particles", "100");
     addParameter("Hole Prob.", "0.2");
+    addParameter("Configuration File", "");
 }
 
 void LeaderElectionAlg::instantiate(const int numParticles,
-    const double holeProb)
+    const double holeProb, const QString configFile)
 {
-    if (numParticles <= 0) {
+    Configuration config;
+    if (configFile.isEmpty() && numParticles <= 0) {
         emit log("# particles must be > 0", true);
-    } else if (holeProb < 0 || holeProb > 1) {
+    } else if (configFile.isEmpty() && (holeProb < 0 || holeProb > 1)) {
         emit log("holeProb in [0,1] required", true);
-    } else {
+    } else if (configFile.isEmpty()) {
         emit setSystem(std::make_shared<LeaderElectionSystem>(numParticles,
             holeProb));
+    } else if (loadConfiguration(configFile, config)) {
+        emit setSystem(std::make_shared<LeaderElectionSystem>(config));
     }
 }
 
@@ -269,15 +318,17 @@ ShapeFormationAlg::ShapeFormationAlg()
     addParameter("# Particles", "200");
     addParameter("Hole Prob.", "0.2");
     addParameter("Shape", "h");
+    addParameter("Configuration File", "");
 }
 
 void ShapeFormationAlg::instantiate(const int numParticles,
-    const double holeProb, const QString mode)
+    const double holeProb, const QString mode, const QString configFile)
 {
     std::set<QString> set = ShapeFormationSystem::getAcceptedModes();
-    if (numParticles <= 0) {
+    Configuration config;
+    if (configFile.isEmpty() && numParticles <= 0) {
         emit log("# particles must be > 0", true);
-    } else if (holeProb < 0 || holeProb > 1) {
+    } else if (configFile.isEmpty() && (holeProb < 0 || holeProb > 1)) {
         emit log("holeProb in [0,1] required", true);
     } else if (set.find(mode) == set.end()) {
         QString accepted = "";
@@ -288,9 +339,11 @@ void ShapeFormationAlg::instantiate(const int numParticles,
                 accepted = *it;
         }
         emit log("only accepted modes are: " + accepted, true);
-    } else {
+    } else if (configFile.isEmpty()) {
         emit setSystem(std::make_shared<ShapeFormationSystem>(numParticles,
             holeProb, mode));
+    } else if (loadConfiguration(configFile, config)) {
+        emit setSystem(std::make_shared<ShapeFormationSystem>(config, mode));
     }
 }
 
@@ -301,20 +354,25 @@ ShortcutBridgingAlg::ShortcutBridgingAlg()
     addParameter("Lambda", "4.0");
     addParameter("c", "1.5");
     addParameter("Shape", "0");
+    addParameter("Configuration File", "");
 };
 
-void ShortcutBridgingAlg::instantiate(const int numParticles, const double lambda, const double c, int shape)
+void ShortcutBridgingAlg::instantiate(const int numParticles, const double lambda, const double c, int shape,
+    const QString configFile)
 {
-    if (numParticles <= 0) {
+    Configuration config;
+    if (configFile.isEmpty() && numParticles <= 0) {
         emit log("# particles must be > 0", true);
     } else if (lambda < 0) {
         emit log("lambda must be >= 0", true);
     } else if (c < 1) {
         emit log("c must be >= 1", true);
-    } else if (shape < 0 || shape > 6) {
+    } else if (configFile.isEmpty() && (shape < 0 || shape > 6)) {
         emit log("shape must be 0<=shape<=6", true);
-    } else {
+    } else if (configFile.isEmpty()) {
         emit setSystem(std::make_shared<ShortcutBridgingSystem>(numParticles, lambda, c, static_cast<ShortcutBridgingSystem::Shape>(shape)));
+    } else if (loadConfiguration(configFile, config)) {
+        emit setSystem(std::make_shared<ShortcutBridgingSystem>(config, lambda, c));
     }
 }
 
@@ -324,18 +382,23 @@ SeparationAlg::SeparationAlg()
     addParameter("# Particles", "100");
     addParameter("Lambda", "4.0");
     addParameter("Kappa", "4.0");
+    addParameter("Configuration File", "");
 };
 
-void SeparationAlg::instantiate(const int numParticles, const double lambda, const double kappa)
+void SeparationAlg::instantiate(const int numParticles, const double lambda, const double kappa,
+    const QString configFile)
 {
-    if (numParticles <= 0) {
+    Configuration config;
+    if (configFile.isEmpty() && numParticles <= 0) {
         emit log("# particles must be > 0", true);
     } else if (lambda <= 0) {
         emit log("lambda must be > 0", true);
     } else if (kappa <= 0) {
         emit log("kappa must be > 0", true);
-    } else {
+    } else if (configFile.isEmpty()) {
         emit setSystem(std::make_shared<SeparationSystem>(numParticles, lambda, kappa));
+    } else if (loadConfiguration(configFile, config)) {
+        emit setSystem(std::make_shared<SeparationSystem>(config, lambda, kappa));
     }
 }
 
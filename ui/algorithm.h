@@ -13,6 +13,7 @@
 #include <QString>
 #include <QStringList>
 
+#include "core/configuration.h"
 #include "core/system.h"
 
 class Algorithm : public QObject {
@@ -36,6 +37,13 @@ public:
     // Adds a parameter to the algorithm of the given name and default value.
     void addParameter(QString parameter, QString defaultValue);
 
+protected:
+    // Loads the configuration file at the given path into config for an
+    // algorithm that is instantiated from it instead of generating its initial
+    // configuration; logs an error and returns false if the file cannot be
+    // loaded or contains no particles.
+    bool loadConfiguration(const QString filePath, Configuration& config);
+
 signals:
     void log(const QString msg, bool error = false);
     void setSystem(std::shared_ptr<System> system);
@@ -46,7 +54,10 @@ private:
     std::vector<std::pair<QString, QString>> _parameters;
 };
 
-/* Algorithm classes for handling the instantiation of specific algorithms */
+/* Algorithm classes for handling the instantiation of specific algorithms.
+ * Except for the demos, each algorithm takes an optional configuration file
+ * as its last parameter (see core/configuration.h), which replaces the
+ * generated initial configuration and the parameters describing it. */
 
 // Demo: Disco, a first tutorial.
 class DiscoDemoAlg : public Algorithm {
@@ -100,7 +111,8 @@ public:
     CompressionAlg();
 
 public slots:
-    void instantiate(const int numParticles = 100, const double lambda = 4.0);
+    void instantiate(const int numParticles = 100, const double lambda = 4.0,
+        const QString configFile = "");
 };
 
 // Energy Distribution + Hexagon Formation.
@@ -113,7 +125,8 @@ public:
 public slots:
     void instantiate(const int numParticles = 200, const int numEnergyRoots = 1,
         const double holeProb = 0.2, const double capacity = 10,
-        const double demand = 5, const double transferRate = 1);
+        const double demand = 5, const double transferRate = 1,
+        const QString configFile = "");
 };
 
 // Energy Distribution/Sharing.
@@ -126,7 +139,8 @@ public:
 public slots:
     void instantiate(int numParticles = 91, const int numEnergyRoots = 1,
         const int usage = 0, const double capacity = 10,
-        const double demand = 5, const double transferRate = 1);
+        const double demand = 5, const double transferRate = 1,
+        const QString configFile = "");
 };
 
 // Infinite Object Coating.
@@ -137,7 +151,8 @@ public:
     InfObjCoatingAlg();
 
 public slots:
-    void instantiate(const int numParticles = 100, const double holeProb = 0.2);
+    void instantiate(const int numParticles = 100, const double holeProb = 0.2,
+        const QString configFile = "");
 };
 
 // Leader Election.
@@ -148,7 +163,8 @@ public:
     LeaderElectionAlg();
 
 public slots:
-    void instantiate(const int numParticles = 100, const double holeProb = 0.2);
+    void instantiate(const int numParticles = 100, const double holeProb = 0.2,
+        const QString configFile = "");
 };
 
 // Basic Shape Formation.
@@ -160,7 +176,7 @@ public:
 
 public slots:
     void instantiate(const int numParticles = 200, const double holeProb = 0.2,
-        const QString mode = "h");
+        const QString mode = "h", const QString configFile = "");
 };
 
 // Shortcut Bridging algorithm
@@ -171,7 +187,8 @@ public:
     ShortcutBridgingAlg();
 
 public slots:
-    void instantiate(const int numParticles = 100, const double lambda = 4.0, const double c = 3 / 2, int shape = 0);
+    void instantiate(const int numParticles = 100, const double lambda = 4.0, const double c = 3 / 2, int shape = 0,
+        const QString configFile = "");
 };
 
 // Separation algorithm
@@ -182,7 +199,8 @@ public:
     SeparationAlg();
 
 public slots:
-    void instantiate(const int numParticles = 100, const double lambda = 4.0, const double kappa = 4.0);
+    void instantiate(const int numParticles = 100, const double lambda = 4.0, const double kappa = 4.0,
+        const QString configFile = "");
 };
 
 class AlgorithmList {
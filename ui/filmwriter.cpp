@@ -0,0 +1,381 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "ui/filmwriter.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QBuffer>
+#include <QMutexLocker>
+#include <QThread>
+#include <QtConcurrent>
+#include <QtEndian>
+
+namespace {
+
+// The queue holds at most this many frames per worker thread.
+const int queuedFramesPerThread = 2;
+
+const int jpegQuality = 90;
+
+// Layout of the AVI headers, which are followed by the frames: the offsets of
+// the main header, the stream header, and the "movi" list's fourcc.
+const int aviMainHeaderOffset = 32;
+const int aviStreamHeaderOffset = 108;
+const int aviMoviOffset = 220;
+const qint64 aviMaxSize = 0x7fffffff;
+
+// Appends the given fourcc or little-endian number to data.
+void putFourcc(QByteArray& data, const char* fourcc)
+{
+    data.append(fourcc, 4);
+}
+
+void put32(QByteArray& data, quint32 value)
+{
+    uchar bytes[4];
+    qToLittleEndian<quint32>(value, bytes);
+    data.append(reinterpret_cast<const char*>(bytes), 4);
+}
+
+void put16(QByteArray& data, quint16 value)
+{
+    uchar bytes[2];
+    qToLittleEndian<quint16>(value, bytes);
+    data.append(reinterpret_cast<const char*>(bytes), 2);
+}
+
+// Overwrites the little-endian number at the given offset of the file.
+bool patch32(QFile& file, qint64 offset, quint32 value)
+{
+    uchar bytes[4];
+    qToLittleEndian<quint32>(value, bytes);
+    return file.seek(offset) && file.write(reinterpret_cast<const char*>(bytes), 4) == 4;
+}
+
+} // namespace
+
+FilmWriter::FilmWriter(const QString filePath, int framesPerSecond, int digits)
+    : _format(Images)
+    , filePath(filePath)
+    , framesPerSecond(framesPerSecond)
+    , digits(digits)
+    , file(filePath)
+    , width(0)
+    , height(0)
+    , moviOffset(0)
+    , maxFrameSize(0)
+    , numAppended(0)
+    , numWritten(0)
+    , writing(false)
+    , ok(true)
+    , closed(false)
+{
+    if (filePath.endsWith(".y4m", Qt::CaseInsensitive)) {
+        _format = Y4m;
+    } else if (filePath.endsWith(".avi", Qt::CaseInsensitive)) {
+        _format = Avi;
+    }
+    if (_format != Images) {
+        file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    }
+    pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount()));
+}
+
+FilmWriter::~FilmWriter()
+{
+    close();
+}
+
+bool FilmWriter::isOpen() const
+{
+    return _format == Images || file.isOpen();
+}
+
+FilmWriter::Format FilmWriter::format() const
+{
+    return _format;
+}
+
+void FilmWriter::append(QImage&& frame)
+{
+    if (!isOpen() || closed) {
+        return;
+    }
+
+    QMutexLocker locker(&mutex);
+    const quint64 capacity = queuedFramesPerThread * pool.maxThreadCount();
+    while (numAppended - numWritten >= capacity) {
+        queueNotFull.wait(&mutex);
+    }
+    const quint64 number = numAppended++;
+    if (number == 0 && _format != Images) {
+        width = frame.width();
+        height = frame.height();
+        if (_format == Y4m) {
+            writeY4mHeader();
+        } else {
+            writeAviHeader();
+        }
+    }
+    locker.unlock();
+
+    const QImage image(std::move(frame));
+    QtConcurrent::run(&pool, [this, number, image]() {
+        QByteArray data;
+        const bool encodedOk = encode(number, image, data);
+        frameEncoded(number, std::move(data), encodedOk);
+    });
+}
+
+bool FilmWriter::close()
+{
+    if (closed) {
+        return ok;
+    }
+    closed = true;
+    if (!isOpen()) {
+        return false;
+    }
+
+    {
+        QMutexLocker locker(&mutex);
+        while (numWritten < numAppended) {
+            queueEmpty.wait(&mutex);
+        }
+    }
+    pool.waitForDone();
+
+    if (_format == Avi) {
+        finishAvi();
+    }
+    if (file.isOpen()) {
+        file.close();
+    }
+    return ok;
+}
+
+bool FilmWriter::encode(quint64 number, const QImage& frame,
+    QByteArray& data) const
+{
+    if (_format == Images) {
+        QString numberString = QString::number(number);
+        while (numberString.length() < digits) {
+            numberString = QString("0") + numberString;
+        }
+        return frame.save(filePath + numberString + QString(".png"));
+    }
+
+    const QImage image = ((frame.width() == width && frame.height() == height)
+                              ? frame
+                              : frame.scaled(width, height, Qt::IgnoreAspectRatio,
+                                    Qt::SmoothTransformation))
+                             .convertToFormat(QImage::Format_RGB32);
+    if (image.isNull()) {
+        return false;
+    }
+
+    if (_format == Avi) {
+        QBuffer buffer(&data);
+        return buffer.open(QIODevice::WriteOnly) && image.save(&buffer, "JPG", jpegQuality);
+    }
+
+    // Convert to full-range BT.601 YCbCr (as in JPEG), averaging the chroma
+    // of each 2 x 2 block of pixels.
+    const int chromaWidth = (width + 1) / 2;
+    const int chromaHeight = (height + 1) / 2;
+    data.resize(6 + width * height + 2 * chromaWidth * chromaHeight);
+    uchar* out = reinterpret_cast<uchar*>(data.data());
+    std::memcpy(out, "FRAME\n", 6);
+    uchar* lumaPlane = out + 6;
+    uchar* cbPlane = lumaPlane + width * height;
+    uchar* crPlane = cbPlane + chromaWidth * chromaHeight;
+    for (int y = 0; y < height; ++y) {
+        const QRgb* line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        for (int x = 0; x < width; ++x) {
+            const int r = qRed(line[x]), g = qGreen(line[x]), b = qBlue(line[x]);
+            lumaPlane[y * width + x] = static_cast<uchar>((77 * r + 150 * g + 29 * b + 128) >> 8);
+        }
+    }
+    for (int cy = 0; cy < chromaHeight; ++cy) {
+        const QRgb* lines[2] = {
+            reinterpret_cast<const QRgb*>(image.constScanLine(2 * cy)),
+            reinterpret_cast<const QRgb*>(image.constScanLine(std::min(2 * cy + 1, height - 1)))
+        };
+        for (int cx = 0; cx < chromaWidth; ++cx) {
+            const int x0 = 2 * cx, x1 = std::min(2 * cx + 1, width - 1);
+            int r = 0, g = 0, b = 0;
+            for (const QRgb* line : lines) {
+                r += qRed(line[x0]) + qRed(line[x1]);
+                g += qGreen(line[x0]) + qGreen(line[x1]);
+                b += qBlue(line[x0]) + qBlue(line[x1]);
+            }
+            // The sums are four times the averages; 128 is added as 4 * 32 * 256.
+            cbPlane[cy * chromaWidth + cx] = static_cast<uchar>((-43 * r - 85 * g + 128 * b + 4 * 32896) >> 10);
+            crPlane[cy * chromaWidth + cx] = static_cast<uchar>((128 * r - 107 * g - 21 * b + 4 * 32896) >> 10);
+        }
+    }
+    return true;
+}
+
+void FilmWriter::frameEncoded(quint64 number, QByteArray&& data, bool encodedOk)
+{
+    QMutexLocker locker(&mutex);
+    ok = ok && encodedOk;
+    encoded[number] = std::move(data);
+
+    // Only one thread writes at a time; it writes all frames that are next in
+    // order, including those encoded by other threads in the meantime.
+    if (writing) {
+        return;
+    }
+    writing = true;
+    while (!encoded.empty() && encoded.begin()->first == numWritten) {
+        const QByteArray next = std::move(encoded.begin()->second);
+        encoded.erase(encoded.begin());
+        locker.unlock();
+        const bool written = (_format == Images) || writeFrame(next);
+        locker.relock();
+        ok = ok && written;
+        ++numWritten;
+        queueNotFull.wakeAll();
+    }
+    writing = false;
+    if (numWritten == numAppended) {
+        queueEmpty.wakeAll();
+    }
+}
+
+void FilmWriter::writeY4mHeader()
+{
+    // Readers assume limited-range colors unless told otherwise.
+    const QString header = QString("YUV4MPEG2 W%1 H%2 F%3:1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n")
+                               .arg(width)
+                               .arg(height)
+                               .arg(framesPerSecond);
+    const QByteArray bytes = header.toLatin1();
+    ok = ok && file.write(bytes) == bytes.size();
+}
+
+void FilmWriter::writeAviHeader()
+{
+    // The frame counts and sizes are patched in by finishAvi.
+    QByteArray header;
+    putFourcc(header, "RIFF");
+    put32(header, 0);
+    putFourcc(header, "AVI ");
+
+    putFourcc(header, "LIST");
+    put32(header, 192);
+    putFourcc(header, "hdrl");
+    putFourcc(header, "avih");
+    put32(header, 56);
+    put32(header, 1000000 / framesPerSecond); // microseconds per frame
+    put32(header, 0); // maximum bytes per second
+    put32(header, 0); // padding granularity
+    put32(header, 0x10); // flags: has an index
+    put32(header, 0); // total frames
+    put32(header, 0); // initial frames
+    put32(header, 1); // streams
+    put32(header, 0); // suggested buffer size
+    put32(header, width);
+    put32(header, height);
+    for (int i = 0; i < 4; ++i) {
+        put32(header, 0);
+    }
+
+    putFourcc(header, "LIST");
+    put32(header, 116);
+    putFourcc(header, "strl");
+    putFourcc(header, "strh");
+    put32(header, 56);
+    putFourcc(header, "vids");
+    putFourcc(header, "MJPG");
+    put32(header, 0); // flags
+    put16(header, 0); // priority
+    put16(header, 0); // language
+    put32(header, 0); // initial frames
+    put32(header, 1); // scale
+    put32(header, framesPerSecond); // rate
+    put32(header, 0); // start
+    put32(header, 0); // length
+    put32(header, 0); // suggested buffer size
+    put32(header, 0xffffffff); // quality
+    put32(header, 0); // sample size
+    put16(header, 0);
+    put16(header, 0);
+    put16(header, width);
+    put16(header, height);
+    putFourcc(header, "strf");
+    put32(header, 40);
+    put32(header, 40);
+    put32(header, width);
+    put32(header, height);
+    put16(header, 1); // planes
+    put16(header, 24); // bits per pixel
+    putFourcc(header, "MJPG");
+    put32(header, width * height * 3);
+    for (int i = 0; i < 4; ++i) {
+        put32(header, 0);
+    }
+
+    putFourcc(header, "LIST");
+    put32(header, 0);
+    putFourcc(header, "movi");
+    Q_ASSERT(header.size() == aviMoviOffset + 4);
+
+    moviOffset = aviMoviOffset;
+    ok = ok && file.write(header) == header.size();
+}
+
+bool FilmWriter::writeFrame(const QByteArray& data)
+{
+    if (_format == Y4m) {
+        return file.write(data) == data.size();
+    }
+
+    const quint32 size = static_cast<quint32>(data.size());
+    const qint64 position = file.pos();
+    if (position + 8 + size + 1 + aviIndex.size() + 32 > aviMaxSize) {
+        return false;
+    }
+    QByteArray chunkHeader;
+    putFourcc(chunkHeader, "00dc");
+    put32(chunkHeader, size);
+    putFourcc(aviIndex, "00dc");
+    put32(aviIndex, 0x10); // keyframe
+    put32(aviIndex, static_cast<quint32>(position - moviOffset));
+    put32(aviIndex, size);
+    maxFrameSize = std::max(maxFrameSize, size);
+
+    bool written = file.write(chunkHeader) == chunkHeader.size()
+        && file.write(data) == data.size();
+    if (size % 2 == 1) {
+        written = written && file.write("\0", 1) == 1;
+    }
+    return written;
+}
+
+void FilmWriter::finishAvi()
+{
+    if (numAppended == 0) {
+        return;
+    }
+
+    const qint64 indexOffset = file.pos();
+    QByteArray index;
+    putFourcc(index, "idx1");
+    put32(index, aviIndex.size());
+    index.append(aviIndex);
+    const quint32 numFrames = static_cast<quint32>(aviIndex.size() / 16);
+    const bool finished = file.write(index) == index.size()
+        && patch32(file, 4, static_cast<quint32>(file.size() - 8))
+        && patch32(file, aviMainHeaderOffset + 16, numFrames)
+        && patch32(file, aviMainHeaderOffset + 28, maxFrameSize + 8)
+        && patch32(file, aviStreamHeaderOffset + 32, numFrames)
+        && patch32(file, aviStreamHeaderOffset + 36, maxFrameSize + 8)
+        && patch32(file, moviOffset - 4, static_cast<quint32>(indexOffset - moviOffset));
+    ok = ok && finished;
+}
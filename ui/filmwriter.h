@@ -0,0 +1,107 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines a writer that encodes the frames of a film (see
+// ScriptInterface::filmSimulation) on a pool of worker threads while the
+// simulation keeps running. Appending a frame only queues it; if encoding
+// falls behind by more than the capacity of the queue, appending waits for it
+// to catch up. Frames are encoded in parallel and written in order.
+//
+// The format is chosen by the extension of the path:
+//
+//   .y4m:    a YUV4MPEG2 video of uncompressed 4:2:0 frames (full-range
+//            BT.601 colors, declared by the XCOLORRANGE=FULL header tag),
+//            which ffmpeg and most players read directly.
+//   .avi:    an AVI video of JPEG-compressed frames (Motion JPEG) with an
+//            index, limited to 2 GB by the original AVI format.
+//   others:  numbered PNG images, whose paths are the given path followed by
+//            the frame number, padded with zeroes, and ".png".
+//
+// Videos have the size of their first frame; later frames of other sizes are
+// scaled to it.
+
+#ifndef AMOEBOTSIM_UI_FILMWRITER_H_
+#define AMOEBOTSIM_UI_FILMWRITER_H_
+
+#include <map>
+
+#include <QByteArray>
+#include <QFile>
+#include <QImage>
+#include <QMutex>
+#include <QString>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <QtGlobal>
+
+class FilmWriter {
+public:
+    enum Format {
+        Images,
+        Y4m,
+        Avi
+    };
+
+    // Opens a film at the given path with the given frame rate; frame numbers
+    // of images are padded to the given number of digits. Check isOpen() for
+    // success.
+    FilmWriter(const QString filePath, int framesPerSecond, int digits);
+
+    // Closes the film (see close()).
+    ~FilmWriter();
+
+    bool isOpen() const;
+    Format format() const;
+
+    // Queues the next frame for encoding; waits while the queue is full. This
+    // is meant to be called from a single (the simulation) thread.
+    void append(QImage&& frame);
+
+    // Waits until all frames are written and completes the video's headers
+    // and index. Returns whether all frames were written successfully.
+    bool close();
+
+private:
+    // Encodes the frame with the given number: images are saved directly,
+    // while video frames are encoded into data for writeFrame. Returns whether
+    // encoding succeeded.
+    bool encode(quint64 number, const QImage& frame, QByteArray& data) const;
+
+    // Writes the encoded frames that are next in order, if any, and frees
+    // their places in the queue; called whenever a frame has been encoded.
+    void frameEncoded(quint64 number, QByteArray&& data, bool ok);
+
+    // Video container support.
+    void writeY4mHeader();
+    void writeAviHeader();
+    void finishAvi();
+    bool writeFrame(const QByteArray& data);
+
+    Format _format;
+    QString filePath;
+    int framesPerSecond;
+    int digits;
+    QFile file;
+    int width;
+    int height;
+
+    // AVI bookkeeping: the offset of the "movi" list and, for each frame, its
+    // offset relative to it and its size.
+    qint64 moviOffset;
+    QByteArray aviIndex;
+    quint32 maxFrameSize;
+
+    QThreadPool pool;
+    QMutex mutex;
+    QWaitCondition queueNotFull;
+    QWaitCondition queueEmpty;
+    quint64 numAppended;
+    quint64 numWritten;
+    std::map<quint64, QByteArray> encoded;
+    bool writing;
+    bool ok;
+    bool closed;
+};
+
+#endif // AMOEBOTSIM_UI_FILMWRITER_H_
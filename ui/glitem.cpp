@@ -4,6 +4,7 @@
 
 #include "ui/glitem.h"
 
+#include <QElapsedTimer>
 #include <QQuickWindow>
 #include <QSurfaceFormat>
 
@@ -41,7 +42,10 @@ void GLItem::delegatePaint() {
   }
 
   emit beforeRendering();
+  QElapsedTimer paintTimer;
+  paintTimer.start();
   paint();
+  frameRendered(paintTimer.nsecsElapsed());
   emit afterRendering();
 }
 
@@ -62,3 +66,5 @@ int GLItem::width() const {
 int GLItem::height() const {
   return window()->devicePixelRatio() * window()->height();
 }
+
+void GLItem::frameRendered(qint64) {}
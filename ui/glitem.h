@@ -34,6 +34,10 @@ class GLItem : public QQuickItem {
   int width() const;
   int height() const;
 
+  // Called after every frame with the time paint took in nanoseconds, e.g., to
+  // adapt the frame rate to it. Does nothing by default.
+  virtual void frameRendered(qint64 paintNsecs);
+
  protected:
   QOpenGLFunctions_2_0* glfn;
 
@@ -91,25 +91,25 @@ void ParameterListModel::createSystem(QString algName)
     } else if (signature == "tokendemo") {
         dynamic_cast<TokenDemoAlg*>(alg)->instantiate(params[0].toInt(), params[1].toInt());
     } else if (signature == "compression") {
-        dynamic_cast<CompressionAlg*>(alg)->instantiate(params[0].toInt(), params[1].toDouble());
+        dynamic_cast<CompressionAlg*>(alg)->instantiate(params[0].toInt(), params[1].toDouble(), params[2]);
     } else if (signature == "energyshape") {
         dynamic_cast<EnergyShapeAlg*>(alg)->instantiate(params[0].toInt(), params[1].toInt(), params[2].toDouble(),
             params[3].toDouble(), params[4].toDouble(),
-            params[5].toDouble());
+            params[5].toDouble(), params[6]);
     } else if (signature == "energysharing") {
         dynamic_cast<EnergySharingAlg*>(alg)->instantiate(params[0].toInt(), params[1].toInt(), params[2].toInt(),
             params[3].toDouble(), params[4].toDouble(),
-            params[5].toDouble());
+            params[5].toDouble(), params[6]);
     } else if (signature == "infobjcoating") {
-        dynamic_cast<InfObjCoatingAlg*>(alg)->instantiate(params[0].toInt(), params[1].toDouble());
+        dynamic_cast<InfObjCoatingAlg*>(alg)->instantiate(params[0].toInt(), params[1].toDouble(), params[2]);
     } else if (signature == "leaderelection") {
-        dynamic_cast<LeaderElectionAlg*>(alg)->instantiate(params[0].toInt(), params[1].toDouble());
+        dynamic_cast<LeaderElectionAlg*>(alg)->instantiate(params[0].toInt(), params[1].toDouble(), params[2]);
     } else if (signature == "shapeformation") {
-        dynamic_cast<ShapeFormationAlg*>(alg)->instantiate(params[0].toInt(), params[1].toDouble(), params[2]);
+        dynamic_cast<ShapeFormationAlg*>(alg)->instantiate(params[0].toInt(), params[1].toDouble(), params[2], params[3]);
     } else if (signature == "shortcutbridging") {
-        dynamic_cast<ShortcutBridgingAlg*>(alg)->instantiate(params[0].toInt(), params[1].toDouble(), params[2].toDouble(), params[3].toInt());
+        dynamic_cast<ShortcutBridgingAlg*>(alg)->instantiate(params[0].toInt(), params[1].toDouble(), params[2].toDouble(), params[3].toInt(), params[4]);
     } else if (signature == "separation") {
-        dynamic_cast<SeparationAlg*>(alg)->instantiate(params[0].toInt(), params[1].toDouble(), params[2].toDouble());
+        dynamic_cast<SeparationAlg*>(alg)->instantiate(params[0].toInt(), params[1].toDouble(), params[2].toDouble(), params[3]);
     } else {
         Q_ASSERT(false); // An unrecognized signature has been entered.
     }
@@ -0,0 +1,266 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "ui/rasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <QMutexLocker>
+#include <QRect>
+#include <QtConcurrent>
+
+#include "core/object.h"
+#include "core/particle.h"
+#include "core/system.h"
+#include "ui/vispreferences.h"
+
+namespace {
+
+// Bands are this many rows high.
+const int bandHeight = 16;
+
+// Returns x * y / 255, rounded, for x, y in [0, 255].
+inline uint mul255(uint x, uint y)
+{
+    const uint t = x * y + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+} // namespace
+
+Rasterizer::Rasterizer()
+    : gridTexture(QImage(":/textures/grid.png").convertToFormat(QImage::Format_RGB32))
+    , particleTexture(QImage(":textures/particle.png")
+                          .convertToFormat(QImage::Format_ARGB32_Premultiplied))
+    , scaledZoom(0.0)
+    , spriteSize(0)
+    , dotSize(0)
+    , left(0.0)
+    , top(0.0)
+    , zoom(0.0)
+{
+}
+
+QImage Rasterizer::render(System& system, const QSize& size,
+    const QPointF& focusPos, double zoom)
+{
+    if (size.isEmpty() || zoom <= 0.0) {
+        return QImage();
+    }
+
+    scaleTextures(zoom);
+    const int width = size.width();
+    const int height = size.height();
+    this->zoom = zoom;
+    left = focusPos.x() - 0.5 * width / zoom;
+    top = focusPos.y() + 0.5 * height / zoom;
+    const double right = left + width / zoom;
+    const double bottom = top - height / zoom;
+
+    // The grid tile is one unit wide and the height of two triangles high.
+    static const double gridHeight = 2.0 * triangleHeight;
+    gridColumns.resize(width);
+    for (int x = 0; x < width; ++x) {
+        const double worldX = left + (x + 0.5) / zoom;
+        const double offset = worldX - std::floor(worldX);
+        gridColumns[x] = std::min(gridTile.width() - 1,
+            static_cast<int>(offset * gridTile.width()));
+    }
+    gridRows.resize(height);
+    for (int y = 0; y < height; ++y) {
+        const double period = (top - (y + 0.5) / zoom) / gridHeight;
+        const double offset = period - std::floor(period);
+        gridRows[y] = gridTile.height() - 1
+            - std::min(gridTile.height() - 1, static_cast<int>(offset * gridTile.height()));
+    }
+
+    // The system is only locked while the quads are collected.
+    for (auto& layer : layers) {
+        layer.clear();
+    }
+    {
+        QMutexLocker locker(&system.mutex);
+        const int minY = std::ceil((bottom - viewSlack) / triangleHeight);
+        const int maxY = std::floor((top + viewSlack) / triangleHeight);
+        visibleObjects.clear();
+        system.objectsInRegion(minY, maxY, left - viewSlack, right + viewSlack,
+            visibleObjects);
+        for (const Object* o : visibleObjects) {
+            addObject(*o);
+        }
+        visibleParticles.clear();
+        system.particlesInRegion(minY, maxY, left - viewSlack, right + viewSlack,
+            visibleParticles);
+        for (const Particle* p : visibleParticles) {
+            addParticle(*p, system.renderAttributes(*p));
+        }
+    }
+
+    // Sort the quads into the bands they overlap, keeping the order of the
+    // layers within each band.
+    bands.resize((height + bandHeight - 1) / bandHeight);
+    for (size_t i = 0; i < bands.size(); ++i) {
+        bands[i].top = static_cast<int>(i) * bandHeight;
+        bands[i].bottom = std::min(height, bands[i].top + bandHeight);
+        bands[i].quads.clear();
+    }
+    for (const auto& layer : layers) {
+        for (const Quad& quad : layer) {
+            const int quadSize = (quad.index < 0) ? dotSize : spriteSize;
+            if (quad.x >= width || quad.x + quadSize <= 0
+                || quad.y >= height || quad.y + quadSize <= 0) {
+                continue;
+            }
+            const int first = std::max(0, quad.y) / bandHeight;
+            const int last = std::min(height - 1, quad.y + quadSize - 1) / bandHeight;
+            for (int i = first; i <= last; ++i) {
+                bands[i].quads.push_back(&quad);
+            }
+        }
+    }
+
+    QImage image(size, QImage::Format_RGB32);
+    uchar* bits = image.bits();
+    const int bytesPerLine = image.bytesPerLine();
+    QtConcurrent::blockingMap(bands, [this, bits, bytesPerLine, width](Band& band) {
+        drawBand(band, bits, bytesPerLine, width);
+    });
+
+    return image;
+}
+
+void Rasterizer::scaleTextures(double zoom)
+{
+    if (zoom == scaledZoom) {
+        return;
+    }
+    scaledZoom = zoom;
+
+    gridTile = gridTexture.scaled(std::max(1, static_cast<int>(std::ceil(zoom))),
+        std::max(1, static_cast<int>(std::ceil(2.0 * triangleHeight * zoom))),
+        Qt::IgnoreAspectRatio, Qt::SmoothTransformation)
+                   .convertToFormat(QImage::Format_RGB32);
+
+    const double textureSide = particleTexture.width() * textureScale / texSize;
+    spriteSize = std::max(1, static_cast<int>(std::lround(2.0 * halfQuadSideLength * zoom)));
+    dotSize = std::max(1, static_cast<int>(std::lround(zoom)));
+    sprites.clear();
+    if (zoom < lodZoom) {
+        return;
+    }
+    for (int index = 0; index < numTextures; ++index) {
+        const QRect texture(std::lround(textureSide * (index % texSize)),
+            std::lround(particleTexture.height() - textureSide * (index / texSize + 1)),
+            std::lround(textureSide), std::lround(textureSide));
+        sprites.push_back(particleTexture.copy(texture)
+                              .scaled(spriteSize, spriteSize, Qt::IgnoreAspectRatio,
+                                  Qt::SmoothTransformation)
+                              .convertToFormat(QImage::Format_ARGB32_Premultiplied));
+    }
+}
+
+void Rasterizer::addObject(const Object& o)
+{
+    const int color = o._isTraversable ? 0xbfbfbf : 0x000000;
+    addQuad(Objects, (zoom < lodZoom) ? -1 : objectTexture, o._node, color, 255);
+}
+
+void Rasterizer::addParticle(const Particle& p, const RenderAttributes& attributes)
+{
+    if (zoom < lodZoom) {
+        const int headColor = attributes.headMarkColor;
+        addQuad(Bodies, -1, p.head, (headColor != -1) ? headColor : 0x000000, 255);
+        return;
+    }
+
+    const int headColor = attributes.headMarkColor;
+    if (headColor != -1) {
+        addQuad(Marks, markTextures + attributes.headMarkGlobalDir, p.head, headColor, 180);
+    }
+    if (p.globalTailDir != -1) {
+        const int tailColor = attributes.tailMarkColor;
+        if (tailColor > -1) {
+            addQuad(Marks, markTextures + attributes.tailMarkGlobalDir, p.tail(), tailColor, 180);
+        }
+    }
+
+    addQuad(Bodies, bodyTextures + p.globalTailDir, p.head, 0x000000, 255);
+
+    const auto& borderColors = attributes.borderColors;
+    for (unsigned int i = 0; attributes.borderMask >> i != 0; ++i) {
+        if (borderColors[i] != -1) {
+            addQuad(Borders, borderTextures + i, p.head, borderColors[i], 180);
+        }
+    }
+
+    const auto& borderPointColors = attributes.borderPointColors;
+    for (unsigned int i = 0; attributes.borderPointMask >> i != 0; ++i) {
+        if (borderPointColors[i] != -1) {
+            addQuad(BorderPoints, borderPointTextures + i, p.head, borderPointColors[i], 255);
+        }
+    }
+}
+
+void Rasterizer::addQuad(Layer layer, int index, const Node& node, int color,
+    int alpha)
+{
+    const double centerX = (node.x + 0.5 * node.y - left) * zoom;
+    const double centerY = (top - node.y * triangleHeight) * zoom;
+    const double halfSize = 0.5 * ((index < 0) ? dotSize : spriteSize);
+    layers[layer].push_back({static_cast<int>(std::lround(centerX - halfSize)),
+        static_cast<int>(std::lround(centerY - halfSize)), index,
+        qRgba(qRed(color), qGreen(color), qBlue(color), alpha)});
+}
+
+void Rasterizer::drawBand(Band& band, uchar* bits, int bytesPerLine,
+    int width) const
+{
+    for (int y = band.top; y < band.bottom; ++y) {
+        QRgb* line = reinterpret_cast<QRgb*>(bits + y * bytesPerLine);
+        const QRgb* gridLine = reinterpret_cast<const QRgb*>(gridTile.constScanLine(gridRows[y]));
+        for (int x = 0; x < width; ++x) {
+            line[x] = gridLine[gridColumns[x]];
+        }
+    }
+
+    for (const Quad* quad : band.quads) {
+        const int quadSize = (quad->index < 0) ? dotSize : spriteSize;
+        const int firstX = std::max(0, quad->x);
+        const int lastX = std::min(width, quad->x + quadSize);
+        const int firstY = std::max(band.top, quad->y);
+        const int lastY = std::min(band.bottom, quad->y + quadSize);
+
+        if (quad->index < 0) {
+            const QRgb color = quad->color | 0xff000000;
+            for (int y = firstY; y < lastY; ++y) {
+                QRgb* line = reinterpret_cast<QRgb*>(bits + y * bytesPerLine);
+                std::fill(line + firstX, line + lastX, color);
+            }
+            continue;
+        }
+
+        // Texels are multiplied by the color of the quad and blended over the
+        // image by their alpha, as OpenGL does in the window.
+        const uint r = qRed(quad->color), g = qGreen(quad->color),
+                   b = qBlue(quad->color), a = qAlpha(quad->color);
+        const QImage& sprite = sprites[quad->index];
+        for (int y = firstY; y < lastY; ++y) {
+            QRgb* line = reinterpret_cast<QRgb*>(bits + y * bytesPerLine);
+            const QRgb* texels = reinterpret_cast<const QRgb*>(sprite.constScanLine(y - quad->y));
+            for (int x = firstX; x < lastX; ++x) {
+                const QRgb texel = texels[x - quad->x];
+                if (qAlpha(texel) == 0) {
+                    continue;
+                }
+                const uint srcAlpha = mul255(qAlpha(texel), a);
+                const uint dstFactor = 255 - srcAlpha;
+                const QRgb dst = line[x];
+                line[x] = qRgb(mul255(mul255(qRed(texel), r), a) + mul255(qRed(dst), dstFactor),
+                    mul255(mul255(qGreen(texel), g), a) + mul255(qGreen(dst), dstFactor),
+                    mul255(mul255(qBlue(texel), b), a) + mul255(qBlue(dst), dstFactor));
+            }
+        }
+    }
+}
@@ -0,0 +1,119 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines a rasterizer that draws a system into an image on the CPU, looking
+// like the window (see ui/visitem.h) but without needing a window or an OpenGL
+// context, so screenshots and films can be rendered on servers without a
+// display. The grid, objects, and particles with their marks, borders, and
+// border points are drawn from the same textures as in the window, which are
+// scaled to the zoom level once and then blended texel by texel. The image is
+// drawn in parallel in bands of rows: the quads of the visible objects and
+// particles are first sorted into the bands they overlap, and every band then
+// draws its quads in the order of the layers of the window. When zoomed out
+// below the window's level of detail threshold, objects and particle heads
+// are drawn as dots of their (head mark) color instead.
+
+#ifndef AMOEBOTSIM_UI_RASTERIZER_H_
+#define AMOEBOTSIM_UI_RASTERIZER_H_
+
+#include <array>
+#include <vector>
+
+#include <QImage>
+#include <QPointF>
+#include <QRgb>
+#include <QSize>
+
+#include "core/node.h"
+
+class Object;
+class Particle;
+struct RenderAttributes;
+class System;
+
+class Rasterizer {
+public:
+    // Loads the grid and particle textures.
+    Rasterizer();
+
+    // Renders the given system as seen in a viewport of the given size in
+    // pixels, centered at the given world position and with the given zoom
+    // level (the number of pixels between adjacent nodes). The system is
+    // locked only while its visible objects and particles are collected.
+    // Returns a null image if the size is empty.
+    QImage render(System& system, const QSize& size, const QPointF& focusPos,
+        double zoom);
+
+private:
+    enum Layer {
+        Objects,
+        Marks,
+        Bodies,
+        Borders,
+        BorderPoints,
+        NumLayers
+    };
+
+    // A quad to draw: its top left pixel, the index of its texture in the
+    // particle texture (or -1 for a dot), and its color and alpha as a QRgb.
+    struct Quad {
+        int x;
+        int y;
+        int index;
+        QRgb color;
+    };
+
+    // A band of rows [top, bottom) of the image and the quads overlapping it.
+    struct Band {
+        int top;
+        int bottom;
+        std::vector<const Quad*> quads;
+    };
+
+    // Rescales the grid tile and the textures of the particle texture to the
+    // given zoom level, unless they already have it.
+    void scaleTextures(double zoom);
+
+    // Add the quads of the given object or particle (with its cached render
+    // attributes, see System::renderAttributes) in the same way as
+    // VisItem::fillObjects and friends; addQuad centers a quad at the given
+    // node.
+    void addObject(const Object& o);
+    void addParticle(const Particle& p, const RenderAttributes& attributes);
+    void addQuad(Layer layer, int index, const Node& node, int color,
+        int alpha);
+
+    // Draws the grid and the quads of the given band into the image with the
+    // given pixels, rows of the given length in bytes, and width.
+    void drawBand(Band& band, uchar* bits, int bytesPerLine, int width) const;
+
+    QImage gridTexture;
+    QImage particleTexture;
+
+    // The textures scaled to scaledZoom: the grid tile, one period of the grid
+    // wide and high, and a square sprite per texture of the particle texture,
+    // with premultiplied alpha.
+    double scaledZoom;
+    QImage gridTile;
+    int spriteSize;
+    std::vector<QImage> sprites;
+    int dotSize;
+
+    // The grid tile texel shown in each column and row of the current image.
+    std::vector<int> gridColumns;
+    std::vector<int> gridRows;
+
+    // The world position of the top left corner of the current image and its
+    // zoom level.
+    double left;
+    double top;
+    double zoom;
+
+    std::array<std::vector<Quad>, NumLayers> layers;
+    std::vector<Band> bands;
+    std::vector<const Object*> visibleObjects;
+    std::vector<const Particle*> visibleParticles;
+};
+
+#endif // AMOEBOTSIM_UI_RASTERIZER_H_
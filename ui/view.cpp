@@ -8,9 +8,10 @@
 
 #include <QMutexLocker>
 
-// Zoom preferences.
+// Zoom preferences. Zooming out beyond the level of detail threshold of VisItem
+// shows a density overview, so the minimum fits millions of particles.
 static constexpr double zoomInit = 16.0;
-static constexpr double zoomMin = 4.0;
+static constexpr double zoomMin = 0.05;
 static constexpr double zoomMax = 128.0;
 static constexpr double zoomAttenuation = 500.0;
 
@@ -44,6 +45,21 @@ double View::top() {
   return _focusPos.y() + halfZoomRec * _viewportHeight;
 }
 
+double View::zoom() {
+  QMutexLocker locker(&mutex);
+  return _zoom;
+}
+
+QSize View::viewportSize() {
+  QMutexLocker locker(&mutex);
+  return QSize(_viewportWidth, _viewportHeight);
+}
+
+QPointF View::focusPos() {
+  QMutexLocker locker(&mutex);
+  return _focusPos;
+}
+
 bool View::includes(const QPointF& headWorldPos) {
   QMutexLocker locker(&mutex);
   static constexpr double slack = 2.0;
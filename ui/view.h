@@ -7,6 +7,7 @@
 
 #include <QMutex>
 #include <QPointF>
+#include <QSize>
 
 class View {
  public:
@@ -17,6 +18,15 @@ class View {
   double bottom();
   double top();
 
+  // Returns the zoom level, i.e., the number of pixels per unit of distance
+  // between adjacent nodes.
+  double zoom();
+
+  // Return the size of the viewport in pixels and the world position at its
+  // center, respectively.
+  QSize viewportSize();
+  QPointF focusPos();
+
   bool includes(const QPointF& headWorldPos);
 
   void setViewportSize(int viewportWidth, int viewportHeight);
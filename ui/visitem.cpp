@@ -4,31 +4,71 @@
 
 #include "ui/visitem.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
 
+#include <QElapsedTimer>
 #include <QImage>
 #include <QMutexLocker>
 #include <QOpenGLFunctions_2_0>
 #include <QQuickWindow>
 #include <QRgb>
+#include <QThread>
+#include <QtConcurrent>
 
-// visualisation preferences
+#include "ui/vispreferences.h"
+
+// visualisation preferences (without a governor, see setGovernor)
 static constexpr float targetFramesPerSecond = 60.0f;
 
 // values derived from the preferences above
 static constexpr float targetFrameDuration = 1000.0f / targetFramesPerSecond;
 
-// height of a triangle in our equilateral triangular grid if the side length is 1
-static const double triangleHeight = sqrt(3.0 / 4.0);
+// below lodZoom (see ui/vispreferences.h), particles are summarized by density
+// tiles of this many pixels
+static constexpr double lodTilePixels = 3.0;
+
+// density tiles are counted in parallel in blocks of at least this many particles
+static constexpr size_t minParticlesPerBlock = 65536;
+
+// the geometry cache divides the world into tiles this many units wide and this
+// many rows of nodes high; tile borders lie between nodes
+static constexpr double tileWidth = 16.0;
+static constexpr int tileRows = 16;
+static constexpr double tileOffset = 0.25;
+
+// the object cache sorts objects into chunks of the world this many units wide
+// and this many rows of nodes high, with borders like those of the tiles
+static constexpr double objectChunkWidth = 64.0;
+static constexpr int objectChunkRows = 64;
 
 VisItem::VisItem(QQuickItem* parent)
     : GLItem(parent)
+    , vertexBuffer(0)
+    , objectBuffer(0)
+    , objectsGeneration(0)
+    , numDensityVertices(0)
+    , numBufferedVertices(0)
+    , tilesBuffered(false)
+    , governor(nullptr)
+    , lockWaitNsecs(0)
     , translating(false)
 {
     setAcceptedMouseButtons(Qt::LeftButton);
     renderTimer.start(targetFrameDuration);
 }
 
+View& VisItem::getView()
+{
+    return view;
+}
+
+void VisItem::setGovernor(PerformanceGovernor* governor)
+{
+    this->governor = governor;
+}
+
 void VisItem::systemChanged(std::shared_ptr<System> _system)
 {
     system = _system;
@@ -77,11 +117,6 @@ void VisItem::setZoom(double zoom)
     view.setZoom(zoom);
 }
 
-void VisItem::saveScreenshot(QString filePath)
-{
-    window()->grabWindow().save(filePath);
-}
-
 void VisItem::initialize()
 {
     gridTex = std::unique_ptr<QOpenGLTexture>(new QOpenGLTexture(QImage(":/textures/grid.png").mirrored()));
@@ -95,8 +130,16 @@ void VisItem::initialize()
     particleTex->bind();
     particleTex->generateMipMaps();
 
+    glfn->glGenBuffers(1, &vertexBuffer);
+    glfn->glGenBuffers(1, &objectBuffer);
+
     Q_ASSERT(window() != nullptr);
-    connect(&renderTimer, &QTimer::timeout, window(), &QQuickWindow::update);
+    connect(&renderTimer, &QTimer::timeout, window(), [this]() {
+        if (governor != nullptr) {
+            renderTimer.setInterval(governor->frameInterval());
+        }
+        window()->update();
+    });
 }
 
 void VisItem::paint()
@@ -118,10 +161,49 @@ void VisItem::paint()
     drawGrid();
 
     if (system != nullptr) {
-        QMutexLocker locker(&system->mutex);
+        // The system is only locked while the vertices are collected.
+        const double zoom = view.zoom();
+        const double bottom = view.bottom() - viewSlack;
+        const double top = view.top() + viewSlack;
+        const double minX = view.left() - viewSlack;
+        const double maxX = view.right() + viewSlack;
+        bool upload = true;
+        bool uploadObjects = false;
+        {
+            QElapsedTimer lockTimer;
+            lockTimer.start();
+            QMutexLocker locker(&system->mutex);
+            lockWaitNsecs = lockTimer.nsecsElapsed();
+            const bool dropped = dropChangedTiles();
+            if (zoom < lodZoom) {
+                densityVertices.clear();
+                fillDensity(minX, maxX, bottom, top, lodTilePixels / zoom);
+                visibleTiles.clear();
+                tilesBuffered = false;
+                visibleObjectRanges.clear();
+            } else {
+                const int minY = std::ceil(bottom / triangleHeight);
+                const int maxY = std::floor(top / triangleHeight);
+                if (system->getObjectsGeneration() != objectsGeneration) {
+                    fillObjects();
+                    objectsGeneration = system->getObjectsGeneration();
+                    uploadObjects = true;
+                }
+                findVisibleObjects(minY, maxY, minX, maxX);
+                const bool filled = fillTiles(minY, maxY, minX, maxX);
+                upload = dropped || filled || !tilesBuffered;
+                if (upload) {
+                    densityVertices.clear();
+                    visibleTiles.clear();
+                    for (const auto& entry : tiles) {
+                        visibleTiles.push_back(&entry.second);
+                    }
+                    tilesBuffered = true;
+                }
+            }
+        }
         particleTex->bind();
-        drawObjects();
-        drawParticles();
+        drawVertices(upload, uploadObjects);
     }
 }
 
@@ -129,6 +211,22 @@ void VisItem::deinitialize()
 {
     renderTimer.disconnect();
 
+    glfn->glDeleteBuffers(1, &vertexBuffer);
+    vertexBuffer = 0;
+    glfn->glDeleteBuffers(1, &objectBuffer);
+    objectBuffer = 0;
+    objectsGeneration = 0;
+    std::vector<Vertex>().swap(objectVertices);
+    objectChunks.clear();
+    std::vector<ObjectRange>().swap(visibleObjectRanges);
+    numDensityVertices = 0;
+    numBufferedVertices = 0;
+    tilesBuffered = false;
+    std::vector<Vertex>().swap(densityVertices);
+    tiles.clear();
+    std::vector<const Tile*>().swap(visibleTiles);
+    std::vector<const Particle*>().swap(visibleParticles);
+
     particleTex = nullptr;
     gridTex = nullptr;
 }
@@ -138,6 +236,14 @@ void VisItem::sizeChanged(int width, int height)
     view.setViewportSize(width, height);
 }
 
+void VisItem::frameRendered(qint64 paintNsecs)
+{
+    if (governor != nullptr) {
+        governor->frameRendered((paintNsecs - lockWaitNsecs) / 1e6);
+    }
+    lockWaitNsecs = 0;
+}
+
 void VisItem::setupCamera()
 {
     glfn->glMatrixMode(GL_MODELVIEW);
@@ -174,130 +280,389 @@ void VisItem::drawGrid()
     glfn->glEnd();
 }
 
-void VisItem::drawParticles()
+bool VisItem::dropChangedTiles()
 {
-    glfn->glBegin(GL_QUADS);
+    changedNodes.clear();
+    const bool tracked = system->takeChanges(changedNodes);
+    if (!tracked || tiledSystem.lock() != system) {
+        tiledSystem = system;
+        const bool dropped = !tiles.empty();
+        tiles.clear();
+        return dropped;
+    }
 
-    // Draw particle marks, then particles, then borders, then border points.
-    for (const Particle& p : *system) {
-        if (view.includes(nodeToWorldCoord(p.head))) {
-            drawMarks(p);
+    // Drop every tile that may hold a particle within the change radius of a
+    // changed node.
+    const int radius = System::changeRadius;
+    const size_t numTiles = tiles.size();
+    for (const Node& node : changedNodes) {
+        if (tiles.empty()) {
+            break;
         }
-    }
-    for (const Particle& p : *system) {
-        if (view.includes(nodeToWorldCoord(p.head))) {
-            drawParticle(p);
+        const double x = nodeToWorldCoord(node).x();
+        const int minRow = std::floor(double(node.y - radius) / tileRows);
+        const int maxRow = std::floor(double(node.y + radius) / tileRows);
+        const int minColumn = std::floor((x - radius + tileOffset) / tileWidth);
+        const int maxColumn = std::floor((x + radius + tileOffset) / tileWidth);
+        for (int row = minRow; row <= maxRow; ++row) {
+            for (int column = minColumn; column <= maxColumn; ++column) {
+                tiles.erase(std::make_pair(column, row));
+            }
         }
     }
-    for (const Particle& p : *system) {
-        if (view.includes(nodeToWorldCoord(p.head))) {
-            drawBorders(p);
+    return tiles.size() != numTiles;
+}
+
+bool VisItem::fillTiles(int minY, int maxY, double minX, double maxX)
+{
+    const int minRow = std::floor(double(minY) / tileRows);
+    const int maxRow = std::floor(double(maxY) / tileRows);
+    const int minColumn = std::floor((minX + tileOffset) / tileWidth);
+    const int maxColumn = std::floor((maxX + tileOffset) / tileWidth);
+    bool changed = false;
+
+    for (auto it = tiles.begin(); it != tiles.end();) {
+        const int column = it->first.first;
+        const int row = it->first.second;
+        if (column < minColumn || column > maxColumn || row < minRow || row > maxRow) {
+            it = tiles.erase(it);
+            changed = true;
+        } else {
+            ++it;
         }
     }
-    for (const Particle& p : *system) {
-        if (view.includes(nodeToWorldCoord(p.head))) {
-            drawBorderPoints(p);
+
+    for (int row = minRow; row <= maxRow; ++row) {
+        for (int column = minColumn; column <= maxColumn; ++column) {
+            const auto key = std::make_pair(column, row);
+            if (tiles.find(key) != tiles.end()) {
+                continue;
+            }
+            Tile& tile = tiles[key];
+            const int tileMinY = row * tileRows;
+            const double tileMinX = column * tileWidth - tileOffset;
+            fillParticles(tile.layers, tileMinY, tileMinY + tileRows - 1, tileMinX,
+                tileMinX + tileWidth);
+            changed = true;
         }
     }
 
-    glfn->glEnd();
+    return changed;
 }
 
-void VisItem::drawMarks(const Particle& p)
+void VisItem::fillObjects()
 {
-    // Draw head mark.
-    if (p.headMarkColor() != -1) {
-        auto pos = nodeToWorldCoord(p.head);
-        auto color = p.headMarkColor();
-        glfn->glColor4i(qRed(color) << 23, qGreen(color) << 23, qBlue(color) << 23, 180 << 23);
-        drawFromParticleTex(p.headMarkGlobalDir() + 8, pos);
+    // Sort the objects by their chunks, keyed by row first, so that the
+    // chunks of a row lie next to each other in the buffer.
+    typedef std::pair<std::pair<int, int>, const Object*> ChunkObject;
+    std::vector<ChunkObject> sorted;
+    sorted.reserve(system->getObjects().size());
+    for (const Object* o : system->getObjects()) {
+        const int row = std::floor(double(o->_node.y) / objectChunkRows);
+        const int column = std::floor((nodeToWorldCoord(o->_node).x() + tileOffset) / objectChunkWidth);
+        sorted.push_back(std::make_pair(std::make_pair(row, column), o));
+    }
+    std::sort(sorted.begin(), sorted.end(),
+        [](const ChunkObject& a, const ChunkObject& b) { return a.first < b.first; });
+
+    objectVertices.clear();
+    objectChunks.clear();
+    for (const ChunkObject& entry : sorted) {
+        ObjectRange& chunk = objectChunks.emplace_hint(objectChunks.end(), entry.first,
+            ObjectRange{objectVertices.size(), 0})->second;
+        const Object* o = entry.second;
+        fillFromParticleTex(objectVertices, objectTexture, nodeToWorldCoord(o->_node),
+            o->_isTraversable ? 0xbfbfbf : 0x000000, 255);
+        chunk.count = objectVertices.size() - chunk.first;
     }
+}
 
-    // Draw tail mark.
-    if (p.globalTailDir != -1 && p.tailMarkColor() > -1) {
-        auto pos = nodeToWorldCoord(p.tail());
-        auto color = p.tailMarkColor();
-        glfn->glColor4i(qRed(color) << 23, qGreen(color) << 23, qBlue(color) << 23, 180 << 23);
-        drawFromParticleTex(p.tailMarkGlobalDir() + 8, pos);
+void VisItem::findVisibleObjects(int minY, int maxY, double minX, double maxX)
+{
+    const int minRow = std::floor(double(minY) / objectChunkRows);
+    const int maxRow = std::floor(double(maxY) / objectChunkRows);
+    const int minColumn = std::floor((minX + tileOffset) / objectChunkWidth);
+    const int maxColumn = std::floor((maxX + tileOffset) / objectChunkWidth);
+
+    // The visible chunks of a row form one range of the buffer.
+    visibleObjectRanges.clear();
+    for (int row = minRow; row <= maxRow && !objectChunks.empty(); ++row) {
+        auto it = objectChunks.lower_bound(std::make_pair(row, minColumn));
+        if (it == objectChunks.end() || it->first.first != row || it->first.second > maxColumn) {
+            continue;
+        }
+        ObjectRange range = it->second;
+        for (++it; it != objectChunks.end() && it->first.first == row && it->first.second <= maxColumn; ++it) {
+            range.count += it->second.count;
+        }
+        visibleObjectRanges.push_back(range);
     }
 }
 
-void VisItem::drawParticle(const Particle& p)
+void VisItem::fillParticles(Layers& layers, int minY, int maxY, double minX,
+    double maxX)
 {
-    auto pos = nodeToWorldCoord(p.head);
-    glfn->glColor4f(0.0f, 0.0f, 0.0f, 1.0f);
-    drawFromParticleTex(p.globalTailDir + 1, pos);
+    visibleParticles.clear();
+    system->particlesInRegion(minY, maxY, minX, maxX, visibleParticles);
+    for (const Particle* p : visibleParticles) {
+        const RenderAttributes& attributes = system->renderAttributes(*p);
+        const QPointF headPos = nodeToWorldCoord(p->head);
+        fillMarks(layers, *p, attributes, headPos);
+        fillParticle(layers, *p, headPos);
+        fillBorders(layers, attributes, headPos);
+        fillBorderPoints(layers, attributes, headPos);
+    }
 }
 
-void VisItem::drawBorders(const Particle& p)
+void VisItem::fillMarks(Layers& layers, const Particle& p,
+    const RenderAttributes& attributes, const QPointF& headPos)
 {
-    auto pos = nodeToWorldCoord(p.head);
-    for (unsigned int i = 0; i < p.borderColors().size(); ++i) {
-        if (p.borderColors().at(i) != -1) {
-            auto color = p.borderColors().at(i);
-            glfn->glColor4i(qRed(color) << 23, qGreen(color) << 23, qBlue(color) << 23, 180 << 23);
-            drawFromParticleTex(i + 21, pos);
+    // Fill head mark.
+    const int headColor = attributes.headMarkColor;
+    if (headColor != -1) {
+        fillFromParticleTex(layers[Marks], markTextures + attributes.headMarkGlobalDir,
+            headPos, headColor, 180);
+    }
+
+    // Fill tail mark.
+    if (p.globalTailDir != -1) {
+        const int tailColor = attributes.tailMarkColor;
+        if (tailColor > -1) {
+            fillFromParticleTex(layers[Marks], markTextures + attributes.tailMarkGlobalDir,
+                nodeToWorldCoord(p.tail()), tailColor, 180);
         }
     }
 }
 
-void VisItem::drawBorderPoints(const Particle& p)
+void VisItem::fillParticle(Layers& layers, const Particle& p, const QPointF& headPos)
+{
+    fillFromParticleTex(layers[Bodies], bodyTextures + p.globalTailDir, headPos, 0x000000, 255);
+}
+
+void VisItem::fillBorders(Layers& layers, const RenderAttributes& attributes,
+    const QPointF& headPos)
 {
-    auto pos = nodeToWorldCoord(p.head);
-    for (unsigned int i = 0; i < p.borderPointColors().size(); ++i) {
-        if (p.borderPointColors().at(i) != -1) {
-            auto color = p.borderPointColors().at(i);
-            glfn->glColor4i(qRed(color) << 23, qGreen(color) << 23, qBlue(color) << 23, 255 << 23);
-            drawFromParticleTex(i + 15, pos);
+    // The mask skips the colors after the last one that is set.
+    const auto& colors = attributes.borderColors;
+    for (unsigned int i = 0; attributes.borderMask >> i != 0; ++i) {
+        if (colors[i] != -1) {
+            fillFromParticleTex(layers[Borders], borderTextures + i, headPos, colors[i], 180);
         }
     }
 }
 
-void VisItem::drawFromParticleTex(int index, const QPointF& pos)
+void VisItem::fillBorderPoints(Layers& layers,
+    const RenderAttributes& attributes, const QPointF& headPos)
 {
-    // These values are a consequence of how the particle texture was created. The
-    // expression (90.0f / 96.0f) is done to handle the conversion between 90 dpi
-    // and 96 dpi that Inkscape does when exporting the particle.svg as a .png.
-    static constexpr int texSize = 8;
-    static constexpr double invTexSize = (90.0 / 96.0) / texSize;
-    static constexpr double halfQuadSideLength = 256.0 / 220.0;
+    // The mask skips the colors after the last one that is set.
+    const auto& colors = attributes.borderPointColors;
+    for (unsigned int i = 0; attributes.borderPointMask >> i != 0; ++i) {
+        if (colors[i] != -1) {
+            fillFromParticleTex(layers[BorderPoints], borderPointTextures + i, headPos, colors[i], 255);
+        }
+    }
+}
 
-    const double column = index % texSize;
-    const double row = index / texSize;
-    const QPointF texOffset(invTexSize * column, invTexSize * row);
+void VisItem::fillFromParticleTex(std::vector<Vertex>& vertices, int index,
+    const QPointF& pos, int color, int alpha)
+{
 
-    glfn->glTexCoord2d(texOffset.x(), texOffset.y());
-    glfn->glVertex2d(pos.x() - halfQuadSideLength, pos.y() - halfQuadSideLength);
-    glfn->glTexCoord2d(texOffset.x() + invTexSize, texOffset.y());
-    glfn->glVertex2d(pos.x() + halfQuadSideLength, pos.y() - halfQuadSideLength);
-    glfn->glTexCoord2d(texOffset.x() + invTexSize, texOffset.y() + invTexSize);
-    glfn->glVertex2d(pos.x() + halfQuadSideLength, pos.y() + halfQuadSideLength);
-    glfn->glTexCoord2d(texOffset.x(), texOffset.y() + invTexSize);
-    glfn->glVertex2d(pos.x() - halfQuadSideLength, pos.y() + halfQuadSideLength);
+    static constexpr double invTexSize = textureScale / texSize;
+
+    const GLfloat s = invTexSize * (index % texSize);
+    const GLfloat t = invTexSize * (index / texSize);
+    const GLfloat left = pos.x() - halfQuadSideLength;
+    const GLfloat right = pos.x() + halfQuadSideLength;
+    const GLfloat bottom = pos.y() - halfQuadSideLength;
+    const GLfloat top = pos.y() + halfQuadSideLength;
+    const GLubyte r = qRed(color), g = qGreen(color), b = qBlue(color);
+    const GLubyte a = alpha;
+
+    vertices.push_back({left, bottom, s, t, r, g, b, a});
+    vertices.push_back({right, bottom, s + GLfloat(invTexSize), t, r, g, b, a});
+    vertices.push_back({right, top, s + GLfloat(invTexSize), t + GLfloat(invTexSize), r, g, b, a});
+    vertices.push_back({left, top, s, t + GLfloat(invTexSize), r, g, b, a});
 }
 
-void VisItem::drawObjects()
+void VisItem::fillDensity(double minX, double maxX, double minY, double maxY,
+    double tileSize)
 {
-    glfn->glBegin(GL_QUADS);
-
-    std::deque<Object*> objects = system->getObjects();
-    for (auto t : objects) {
-        drawObject(*t);
+    const int numColumns = std::max(1, static_cast<int>(std::ceil((maxX - minX) / tileSize)));
+    const int numRows = std::max(1, static_cast<int>(std::ceil((maxY - minY) / tileSize)));
+    const size_t numTiles = static_cast<size_t>(numColumns) * numRows;
+    auto tileAt = [=](const Node& node) -> int {
+        const QPointF pos = nodeToWorldCoord(node);
+        const int column = std::floor((pos.x() - minX) / tileSize);
+        const int row = std::floor((pos.y() - minY) / tileSize);
+        return (0 <= column && column < numColumns && 0 <= row && row < numRows)
+            ? row * numColumns + column
+            : -1;
+    };
+
+    // Count the particles block by block; the objects go to the first block.
+    const size_t numParticles = system->size();
+    const int numBlocks = std::max(1, std::min(QThread::idealThreadCount(),
+        static_cast<int>(numParticles / minParticlesPerBlock)));
+    densityBlocks.resize(numBlocks);
+    for (int i = 0; i < numBlocks; ++i) {
+        densityBlocks[i].first = numParticles * i / numBlocks;
+        densityBlocks[i].last = numParticles * (i + 1) / numBlocks;
+    }
+    auto countBlock = [this, numTiles, &tileAt](DensityBlock& block) {
+        block.tiles.assign(numTiles, DensityTile{0, 0, 0});
+        for (size_t i = block.first; i < block.last; ++i) {
+            const Particle& p = system->at(static_cast<int>(i));
+            const int tile = tileAt(p.head);
+            if (tile != -1) {
+                const int color = system->renderAttributes(p).headMarkColor;
+                addToTile(block.tiles[tile], (color == -1) ? 0x000000 : color, 1, 1);
+            }
+        }
+        if (&block == &densityBlocks.front()) {
+            for (const Object* o : system->getObjects()) {
+                const int tile = tileAt(o->_node);
+                if (tile != -1) {
+                    addToTile(block.tiles[tile], o->_isTraversable ? 0xbfbfbf : 0x000000, 1, 1);
+                }
+            }
+        }
+    };
+    if (numBlocks > 1) {
+        QtConcurrent::blockingMap(densityBlocks, countBlock);
+    } else {
+        countBlock(densityBlocks.front());
     }
 
-    glfn->glEnd();
+    // Merge the blocks into the first one and draw its occupied tiles, whose
+    // opacity grows with the fraction of their area covered by nodes.
+    std::vector<DensityTile>& tiles = densityBlocks.front().tiles;
+    for (int i = 1; i < numBlocks; ++i) {
+        const std::vector<DensityTile>& blockTiles = densityBlocks[i].tiles;
+        for (size_t tile = 0; tile < numTiles; ++tile) {
+            if (blockTiles[tile].count > 0) {
+                addToTile(tiles[tile], blockTiles[tile].color, blockTiles[tile].count,
+                    blockTiles[tile].votes);
+            }
+        }
+    }
+    const double nodesPerTile = tileSize * tileSize / triangleHeight;
+    std::vector<Vertex>& vertices = densityVertices;
+    for (size_t tile = 0; tile < numTiles; ++tile) {
+        if (tiles[tile].count == 0) {
+            continue;
+        }
+        const GLfloat left = minX + tileSize * (tile % numColumns);
+        const GLfloat bottom = minY + tileSize * (tile / numColumns);
+        const GLfloat right = left + tileSize;
+        const GLfloat top = bottom + tileSize;
+        const int color = tiles[tile].color;
+        const GLubyte r = qRed(color), g = qGreen(color), b = qBlue(color);
+        const GLubyte a = 64 + 191 * std::min(1.0, tiles[tile].count / nodesPerTile);
+        vertices.push_back({left, bottom, 0, 0, r, g, b, a});
+        vertices.push_back({right, bottom, 0, 0, r, g, b, a});
+        vertices.push_back({right, top, 0, 0, r, g, b, a});
+        vertices.push_back({left, top, 0, 0, r, g, b, a});
+    }
 }
 
-void VisItem::drawObject(const Object& t)
+void VisItem::addToTile(DensityTile& tile, int color, quint32 count,
+    quint32 votes)
 {
-    auto pos = nodeToWorldCoord(t._node);
-    if (t._isTraversable) {
-        glfn->glColor4d(0.75, 0.75, 0.75, 1.0);
+    tile.count += count;
+    if (tile.votes == 0 || tile.color == color) {
+        tile.color = color;
+        tile.votes += votes;
+    } else if (tile.votes >= votes) {
+        tile.votes -= votes;
     } else {
-        glfn->glColor4d(0.0, 0.0, 0.0, 1.0);
+        tile.color = color;
+        tile.votes = votes - tile.votes;
+    }
+}
+
+void VisItem::drawVertices(bool upload, bool uploadObjects)
+{
+    if (uploadObjects) {
+        // The objects are only uploaded again once they change.
+        glfn->glBindBuffer(GL_ARRAY_BUFFER, objectBuffer);
+        glfn->glBufferData(GL_ARRAY_BUFFER, objectVertices.size() * sizeof(Vertex),
+            objectVertices.data(), GL_STATIC_DRAW);
+        glfn->glBindBuffer(GL_ARRAY_BUFFER, 0);
+        std::vector<Vertex>().swap(objectVertices);
+    }
+    if (upload) {
+        numDensityVertices = densityVertices.size();
+        numBufferedVertices = numDensityVertices;
+        for (const Tile* tile : visibleTiles) {
+            for (const auto& layer : tile->layers) {
+                numBufferedVertices += layer.size();
+            }
+        }
+    }
+    if (numBufferedVertices == 0 && visibleObjectRanges.empty()) {
+        return;
     }
 
-    drawFromParticleTex(39, pos);
+    glfn->glEnableClientState(GL_VERTEX_ARRAY);
+    glfn->glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glfn->glEnableClientState(GL_COLOR_ARRAY);
+    auto setPointers = [this]() {
+        glfn->glVertexPointer(2, GL_FLOAT, sizeof(Vertex),
+            reinterpret_cast<const void*>(offsetof(Vertex, x)));
+        glfn->glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex),
+            reinterpret_cast<const void*>(offsetof(Vertex, s)));
+        glfn->glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex),
+            reinterpret_cast<const void*>(offsetof(Vertex, r)));
+    };
+
+    // Objects lie below everything else.
+    if (!visibleObjectRanges.empty()) {
+        glfn->glBindBuffer(GL_ARRAY_BUFFER, objectBuffer);
+        setPointers();
+        for (const ObjectRange& range : visibleObjectRanges) {
+            glfn->glDrawArrays(GL_QUADS, static_cast<GLint>(range.first),
+                static_cast<GLsizei>(range.count));
+        }
+    }
+
+    glfn->glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    if (upload && numBufferedVertices > 0) {
+        // Orphan the previous frame's buffer so the driver need not wait for
+        // it, then upload the density tiles and the layers in drawing order.
+        glfn->glBufferData(GL_ARRAY_BUFFER, numBufferedVertices * sizeof(Vertex), nullptr,
+            GL_STREAM_DRAW);
+        size_t offset = 0;
+        auto append = [this, &offset](const std::vector<Vertex>& vertices) {
+            if (!vertices.empty()) {
+                glfn->glBufferSubData(GL_ARRAY_BUFFER, offset * sizeof(Vertex),
+                    vertices.size() * sizeof(Vertex), vertices.data());
+                offset += vertices.size();
+            }
+        };
+        append(densityVertices);
+        for (int layer = 0; layer < NumLayers; ++layer) {
+            for (const Tile* tile : visibleTiles) {
+                append(tile->layers[layer]);
+            }
+        }
+    }
+
+    setPointers();
+
+    // Density tiles are drawn without the particle texture.
+    if (numDensityVertices > 0) {
+        glfn->glDisable(GL_TEXTURE_2D);
+        glfn->glDrawArrays(GL_QUADS, 0, static_cast<GLsizei>(numDensityVertices));
+        glfn->glEnable(GL_TEXTURE_2D);
+    }
+    if (numBufferedVertices > numDensityVertices) {
+        glfn->glDrawArrays(GL_QUADS, static_cast<GLsizei>(numDensityVertices),
+            static_cast<GLsizei>(numBufferedVertices - numDensityVertices));
+    }
+    glfn->glDisableClientState(GL_COLOR_ARRAY);
+    glfn->glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glfn->glDisableClientState(GL_VERTEX_ARRAY);
+    glfn->glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 QPointF VisItem::nodeToWorldCoord(const Node& node)
@@ -335,10 +700,11 @@ void VisItem::mousePressEvent(QMouseEvent* e)
             translating = false;
             auto clickedNode = worldCoordToNode(windowCoordToWorldCoord(e->localPos()));
             QString text = "";
-            for (const auto& p : *system) {
-                if (p.head == clickedNode || (p.isExpanded() && p.tail() == clickedNode)) {
-                    text = p.inspectionText();
-                    break;
+            if (system != nullptr) {
+                QMutexLocker locker(&system->mutex);
+                const Particle* p = system->particleAt(clickedNode);
+                if (p != nullptr) {
+                    text = p->inspectionText();
                 }
             }
             while (text.endsWith('\n')) {
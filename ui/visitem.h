@@ -5,7 +5,11 @@
 #ifndef AMOEBOTSIM_UI_VISITEM_H_
 #define AMOEBOTSIM_UI_VISITEM_H_
 
+#include <array>
+#include <map>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include <QMouseEvent>
 #include <QOpenGLTexture>
@@ -17,6 +21,7 @@
 #include "core/node.h"
 #include "core/object.h"
 #include "core/particle.h"
+#include "core/performancegovernor.h"
 #include "core/system.h"
 #include "ui/glitem.h"
 #include "ui/view.h"
@@ -27,6 +32,14 @@ class VisItem : public GLItem {
  public:
   explicit VisItem(QQuickItem* parent = nullptr);
 
+  // Returns the view of the system shown in the window.
+  View& getView();
+
+  // Lets the given governor choose the frame rate, and reports the time each
+  // frame takes to draw to it (not counting waiting for the system's lock).
+  // Without a governor, frames are drawn at a fixed rate.
+  void setGovernor(PerformanceGovernor* governor);
+
  signals:
   void stepForParticleAt(Node node);
   void inspectParticle(QString text);
@@ -37,7 +50,6 @@ class VisItem : public GLItem {
   void setWindowSize(int width, int height);
   void focusOn(Node node);
   void setZoom(double zoom);
-  void saveScreenshot(QString filePath);
 
  protected slots:
   virtual void initialize();
@@ -46,17 +58,110 @@ class VisItem : public GLItem {
   virtual void sizeChanged(int width, int height);
 
  protected:
+  virtual void frameRendered(qint64 paintNsecs);
+
   void setupCamera();
 
   void drawGrid();
-  void drawParticles();
-  void drawMarks(const Particle& p);
-  void drawParticle(const Particle& p);
-  void drawBorders(const Particle& p);
-  void drawBorderPoints(const Particle& p);
-  void drawFromParticleTex(int index, const QPointF& pos);
-  void drawObjects();
-  void drawObject(const Object& t);
+
+  // Particles are drawn from one interleaved vertex array with a single draw
+  // call (plus one for density tiles, if any). The array holds the density
+  // tiles (untextured, see fillDensity) followed by layers, which are drawn in
+  // this order: particle marks, particles, borders, and border points. Objects
+  // are drawn before them from a vertex buffer of their own (see
+  // fillObjects).
+  enum Layer {
+    Marks, Bodies, Borders, BorderPoints, NumLayers
+  };
+  struct Vertex {
+    GLfloat x, y;
+    GLfloat s, t;
+    GLubyte r, g, b, a;
+  };
+  typedef std::array<std::vector<Vertex>, NumLayers> Layers;
+
+  // Geometry cache. The world is divided into tiles, and the layers of the
+  // particles whose heads lie in a tile are kept until the system reports a
+  // change near it (see System::takeChanges) or it leaves the view.
+  // A frame only fills the visible tiles that are missing, so its cost is
+  // proportional to the activity since the last frame instead of the number
+  // of visible particles, and if no tile was filled or dropped, the vertex
+  // buffer of the last frame is drawn again without uploading anything.
+  // dropChangedTiles drops the tiles the system reports changes in and
+  // returns whether it dropped any; fillTiles fills the missing tiles in the
+  // given part of the world, drops all others, and returns whether it
+  // changed any. Both require the system to be locked.
+  struct Tile {
+    Layers layers;
+  };
+  bool dropChangedTiles();
+  bool fillTiles(int minY, int maxY, double minX, double maxX);
+
+  // Object cache. Objects never move, so the vertices of all objects of the
+  // system are filled and uploaded to a static vertex buffer only when objects
+  // are inserted or removed (see System::getObjectsGeneration), sorted into
+  // chunks of the world so that each frame only draws the chunks in view, in
+  // one draw call per row of chunks. fillObjects fills the vertices and
+  // chunks of all objects of the system, which must be locked, and
+  // findVisibleObjects finds the ranges of the buffer that hold the objects
+  // in the given part of the world. Neither the CPU nor the upload cost of a
+  // frame depends on the number of objects.
+  struct ObjectRange {
+    size_t first;
+    size_t count;
+  };
+  void fillObjects();
+  void findVisibleObjects(int minY, int maxY, double minX, double maxX);
+
+  // Functions for filling layers with the particles of the system in the
+  // given region, which must be locked. They are found through the spatial
+  // queries of the system (see System::particlesInRegion), so filling takes
+  // time proportional to the number of particles in it. Particles are drawn
+  // from their cached render attributes (see System::renderAttributes).
+  void fillParticles(Layers& layers, int minY, int maxY, double minX,
+                     double maxX);
+  void fillMarks(Layers& layers, const Particle& p,
+                 const RenderAttributes& attributes, const QPointF& headPos);
+  void fillParticle(Layers& layers, const Particle& p, const QPointF& headPos);
+  void fillBorders(Layers& layers, const RenderAttributes& attributes,
+                   const QPointF& headPos);
+  void fillBorderPoints(Layers& layers, const RenderAttributes& attributes,
+                        const QPointF& headPos);
+  void fillFromParticleTex(std::vector<Vertex>& vertices, int index,
+                           const QPointF& pos, int color, int alpha);
+
+  // Level of detail. When zoomed out so far that particles are only a few
+  // pixels wide, fillDensity fills the density tiles instead of drawing the
+  // objects and particles: the given part of the world is divided into square
+  // tiles of the given side length, and each tile containing objects or
+  // particle heads is drawn in the color most of them have (their head mark
+  // color, or black for unmarked particles), the more opaque the more densely
+  // it is occupied. Blocks of particles are counted in parallel, each into
+  // its own tiles, which are then merged; colors are chosen by a majority
+  // vote, which can be merged in constant time per tile.
+  struct DensityTile {
+    quint32 count;
+    int color;
+    quint32 votes;
+  };
+  struct DensityBlock {
+    size_t first;
+    size_t last;
+    std::vector<DensityTile> tiles;
+  };
+  void fillDensity(double minX, double maxX, double minY, double maxY,
+                   double tileSize);
+
+  // Adds count objects or particles to a density tile, which vote for the
+  // given color with the given number of votes (Boyer-Moore majority vote).
+  static void addToTile(DensityTile& tile, int color, quint32 count,
+                        quint32 votes);
+
+  // Uploads the objects to the object buffer if uploadObjects is true and the
+  // density tiles and the layers of the visible tiles to the vertex buffer
+  // unless upload is false, and draws the visible objects and the vertex
+  // buffer.
+  void drawVertices(bool upload, bool uploadObjects);
 
   static QPointF nodeToWorldCoord(const Node& node);
   static Node worldCoordToNode(const QPointF& worldCord);
@@ -69,8 +174,26 @@ class VisItem : public GLItem {
  protected:
   std::unique_ptr<QOpenGLTexture> gridTex;
   std::unique_ptr<QOpenGLTexture> particleTex;
+  GLuint vertexBuffer;
+  GLuint objectBuffer;
+  quint64 objectsGeneration;
+  std::vector<Vertex> objectVertices;
+  std::map<std::pair<int, int>, ObjectRange> objectChunks;
+  std::vector<ObjectRange> visibleObjectRanges;
+  size_t numDensityVertices;
+  size_t numBufferedVertices;
+  bool tilesBuffered;
+  std::vector<Vertex> densityVertices;
+  std::map<std::pair<int, int>, Tile> tiles;
+  std::vector<const Tile*> visibleTiles;
+  std::weak_ptr<System> tiledSystem;
+  std::vector<Node> changedNodes;
+  std::vector<const Particle*> visibleParticles;
+  std::vector<DensityBlock> densityBlocks;
 
   QTimer renderTimer;
+  PerformanceGovernor* governor;
+  qint64 lockWaitNsecs;
 
   View view;
   QPointF lastMousePos;
@@ -0,0 +1,43 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines the drawing preferences and the layout of the particle texture that
+// VisItem (drawing the window) and Rasterizer (drawing screenshots and film
+// frames) share, so both draw a system the same way.
+
+#ifndef AMOEBOTSIM_UI_VISPREFERENCES_H_
+#define AMOEBOTSIM_UI_VISPREFERENCES_H_
+
+#include <cmath>
+
+// height of a triangle in our equilateral triangular grid if the side length is 1
+static const double triangleHeight = std::sqrt(3.0 / 4.0);
+
+// objects and particle heads at most this far outside of the view are drawn
+static constexpr double viewSlack = 2.0;
+
+// below this zoom level (in pixels between adjacent nodes), particles are too
+// small to show details
+static constexpr double lodZoom = 3.0;
+
+// The particle texture holds texSize x texSize textures, counted from its bottom
+// left corner, each of which is drawn as a quad of side length
+// 2 * halfQuadSideLength. These values are a consequence of how the texture was
+// created; textureScale handles the conversion between 90 dpi and 96 dpi that
+// Inkscape does when exporting the particle.svg as a .png.
+static constexpr int texSize = 8;
+static constexpr int numTextures = 40;
+static constexpr double textureScale = 90.0 / 96.0;
+static constexpr double halfQuadSideLength = 256.0 / 220.0;
+
+// indices of the first texture of each kind; bodies are indexed by their global
+// tail direction (-1 if contracted), marks by their direction, and borders and
+// border points by their index
+static constexpr int bodyTextures = 1;
+static constexpr int markTextures = 8;
+static constexpr int borderPointTextures = 15;
+static constexpr int borderTextures = 21;
+static constexpr int objectTexture = 39;
+
+#endif  // AMOEBOTSIM_UI_VISPREFERENCES_H_